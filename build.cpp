@@ -13,151 +13,764 @@ using namespace ncz;
 #define ENTRY_POINT "source/main.cpp"
 
 // you can bootstrap the build system with this command:
-// WINDOWS: clang -std=c++17 -Wall -Wextra -Wpedantic -Werror -g -nostdinc++ -fno-rtti -fno-exceptions -ldbghelp -Xlinker /INCREMENTAL:NO -Xlinker /NOLOGO -Xlinker /NOIMPLIB -Xlinker /NODEFAULTLIB:msvcrt.lib -o build.exe build.cpp
+// WINDOWS: clang -std=c++17 -Wall -Wextra -Wpedantic -Werror -g -nostdinc++ -fno-rtti -fno-exceptions -ldbghelp -lws2_32 -Xlinker /INCREMENTAL:NO -Xlinker /NOLOGO -Xlinker /NOIMPLIB -Xlinker /NODEFAULTLIB:msvcrt.lib -o build.exe build.cpp
 // POSIX: clang -std=c++17 -Wall -Wextra -Wpedantic -Werror -g -nostdinc++ -fno-rtti -fno-exceptions -o build.out build.cpp
 // after that you just have to run build.exe
+//
+// flags:
+// --watch    keep running and rebuild whatever is affected when something in SRC_DIR changes
+// --restart  together with --watch: run the game and restart it after every native rebuild
+// --unity=N  compile the raylib units as N unity files instead of one object per unit
+// --pch      precompile ncz.hpp and raylib.cpp (and with it raylib.h) once for the application
+// --trace    report how long every compiled unit spent parsing and generating code (clang -ftime-trace)
+// --raylib=M how the game links raylib: archive (a static library), thin (an archive that only refers
+//            to the objects, the default on POSIX) or objects (no archive, link the objects directly)
+// --profile=P the native build profile: debug-asan (the default), release, release-lto, pgo-instrument,
+//            pgo-use (which first builds pgo-instrument and plays it to learn from) or headless (release
+//            without a window or a gpu, it plays itself at a fixed frame time as fast as it can)
+// --remote[=A,B,...] compile on workers: the sources are preprocessed here and compiled by the
+//            workers at the given addresses, or by a pool of local workers if there are none.
+//            Objects are cached by content in TMP_DIR/compile-cache.
+// --compile-worker=A serve compiles for --remote on A, unix:<path> or tcp:<host>:<port> (the host
+//            can be * to take jobs from other machines, only do that on a network you trust)
+// --bench[=BASELINE] instead of the game, build source/bench.cpp optimized against the raylib of the
+//            release profile and run it. The results go to OUT_DIR/bench.json, and with a BASELINE
+//            (an earlier bench.json) whatever got slower makes the build fail.
 
-bool BuildDependencies();
-bool BuildApplication();
+bool ScanSources();
+bool Build();
+bool RunBench(cstr baseline);
+bool Watch(bool restart);
+
+// every file in SRC_DIR, kept around (in the crt allocator) for as long as we are running
+List<cstr> sources {};
+
+// build layout, set by the flags above
+u32  unityGroups = 0; // 0 means one object per raylib unit
+bool usePch      = false;
+bool timeTrace   = false;
+bool bench       = false;
+
+// --remote: the addresses of the workers, the flag that hands them to a compile, and our own
+// binary, which the compiles run as (build.out --compile=A,B -- clang ...)
+List<cstr> compileWorkers {};
+cstr       compileFlag = nullptr;
+cstr       buildExe    = nullptr;
+List<Process> localWorkers {};
+#define LOCAL_WORKERS     2
+#define COMPILE_JOBS_DIR  TMP_DIR NCZ_PATH_SEP "compile-jobs"
+#define COMPILE_CACHE_DIR TMP_DIR NCZ_PATH_SEP "compile-cache"
+bool StartLocalWorkers();
+void StopLocalWorkers();
+
+enum class Raylib_Link { ARCHIVE, THIN, OBJECTS };
+#ifdef _WIN32
+Raylib_Link raylibLink = Raylib_Link::ARCHIVE; // NOTE: link.exe can not read thin archives
+#else
+Raylib_Link raylibLink = Raylib_Link::THIN;
+#endif//_WIN32
 
 #ifdef _WIN32
-#define NATIVE_EXE OUT_DIR NCZ_PATH_SEP PROJECT_NAME ".exe"
+#define EXE ".exe"
 #define DEBUGGER "remedybg"
 #else
-#define NATIVE_EXE OUT_DIR NCZ_PATH_SEP PROJECT_NAME
+#define EXE ""
 #define DEBUGGER "gf"
 #endif // _WIN32
 #define WEB_EXE OUT_DIR NCZ_PATH_SEP PROJECT_NAME ".html"
 
+// these live in the folder of the profile
+#ifndef _WIN32
+#define RAYLIB_LIB "libraylib.a"
+#else
+#define RAYLIB_LIB "raylib.lib"
+#endif//_WIN32
+#define RAYLIB_LAYOUT "raylib_layout.txt"
+
+#define PGO_DIR    TMP_DIR NCZ_PATH_SEP "pgo"
+#define PGO_DATA   PGO_DIR NCZ_PATH_SEP PROJECT_NAME ".profdata"
+#define PGO_FRAMES "3600" // how long the game plays itself (main.cpp --autoplay) to collect the profile
+
+// The native build profiles. The flags go to every native compile, raylib and the game alike, and
+// every profile builds in its own TMP_DIR/name folder, so switching between them does not throw
+// away the objects of the others.
+struct Profile {
+    cstr        name      = nullptr;
+    cstr        exe       = nullptr; // the game, in OUT_DIR
+    Array<cstr> flags     = {};
+    Array<cstr> linkFlags = {};
+    cstr        training  = nullptr; // name of the profile built first and played, the profile this one uses comes from it
+    bool        headless  = false;   // raylib's PLATFORM_HEADLESS instead of glfw
+};
+
+NCZ_STATIC_ARRAY_LITERAL(cstr, debug_flags,           "-g", "-fsanitize=address");
+NCZ_STATIC_ARRAY_LITERAL(cstr, debug_link_flags,      "-fsanitize=address");
+NCZ_STATIC_ARRAY_LITERAL(cstr, release_flags,         "-O2", "-DNDEBUG");
+// NOTE: link time optimization needs a linker that reads llvm bitcode, that is lld
+NCZ_STATIC_ARRAY_LITERAL(cstr, lto_flags,             "-O2", "-DNDEBUG", "-flto=thin");
+NCZ_STATIC_ARRAY_LITERAL(cstr, lto_link_flags,        "-O2", "-flto=thin", "-fuse-ld=lld");
+NCZ_STATIC_ARRAY_LITERAL(cstr, instrument_flags,      "-O2", "-DNDEBUG", "-fprofile-instr-generate");
+NCZ_STATIC_ARRAY_LITERAL(cstr, instrument_link_flags, "-fprofile-instr-generate");
+NCZ_STATIC_ARRAY_LITERAL(cstr, pgo_flags,             "-O2", "-DNDEBUG", "-flto=thin", "-fprofile-instr-use=" PGO_DATA);
+
+Profile profiles[] = {
+    { "debug-asan",     PROJECT_NAME EXE,                   debug_flags,      debug_link_flags,      nullptr          },
+    { "release",        PROJECT_NAME "-release" EXE,        release_flags,    {},                    nullptr          },
+    { "release-lto",    PROJECT_NAME "-release-lto" EXE,    lto_flags,        lto_link_flags,        nullptr          },
+    { "pgo-instrument", PROJECT_NAME "-pgo-instrument" EXE, instrument_flags, instrument_link_flags, nullptr          },
+    { "pgo-use",        PROJECT_NAME "-pgo" EXE,            pgo_flags,        lto_link_flags,        "pgo-instrument" },
+    { "headless",       PROJECT_NAME "-headless" EXE,       release_flags,    {},                    nullptr,          true },
+};
+
+// NOTE: profiles are always named, never picked by their place in the table, so rows can be added
+// or reordered
+Profile *FindProfile(cstr name) {
+    for (auto &it : profiles) if (strcmp(it.name, name) == 0) return &it;
+    return nullptr;
+}
+
+Profile *nativeProfile = FindProfile("debug-asan");
+
+// what everything that links raylib needs from the system
+#ifdef _WIN32
+NCZ_STATIC_ARRAY_LITERAL(cstr, system_link_flags,
+    "-Xlinker", "/INCREMENTAL:NO",
+    "-Xlinker", "/NOLOGO",
+    "-Xlinker", "/NOIMPLIB",
+    "-Xlinker", "/NODEFAULTLIB:msvcrt.lib",
+    "-ldbghelp", "-lwinmm", "-lgdi32", "-luser32", "-lshell32"
+);
+#else
+NCZ_STATIC_ARRAY_LITERAL(cstr, system_link_flags, "-lm");
+#endif//_WIN32
+
+cstr NativeExe(Profile *profile) { return SPrint(OUT_DIR NCZ_PATH_SEP, profile->exe).data; }
+cstr Platform(Profile *profile)  { return profile->headless ? "-DPLATFORM_HEADLESS" : "-DPLATFORM_DESKTOP"; }
+
+// Splits the comma separated addresses of --remote and --compile
+void ParseWorkers(cstr list, List<cstr> *workers) {
+    while (*list) {
+        cstr comma = strchr(list, ',');
+        usize count = comma ? static_cast<usize>(comma - list) : strlen(list);
+        if (count) Push(workers, static_cast<cstr>(SPrint(String { count, const_cast<char*>(list) }).data));
+        list += comma ? count + 1 : count;
+    }
+}
+
 int main(int argc, cstr *argv) {
+    // NOTE: the build runs itself as compile workers and for every remote compile, those come
+    // first so that they do not all check whether build.cpp has to be rebuilt
+    context.allocator = NCZ_TEMP;
+    if (argc == 2 && strncmp(argv[1], "--compile-worker=", 17) == 0) {
+        context.logger.label = "worker";
+        return ServeCompiles(argv[1] + 17, COMPILE_JOBS_DIR) ? 0 : 1;
+    }
+    if (argc > 3 && strncmp(argv[1], "--compile=", 10) == 0 && strcmp(argv[2], "--") == 0) {
+        context.logger.label = "compile";
+        Remote_Compile_Options options {};
+        ParseWorkers(argv[1] + 10, &compileWorkers);
+        options.workers  = compileWorkers;
+        options.cacheDir = COMPILE_CACHE_DIR;
+        return CompileRemotely({ static_cast<usize>(argc - 3), argv + 3 }, options) ? 0 : 1;
+    }
+    
     NCZ_CPP_FILE_IS_SCRIPT(argc, argv);
     context.logger.label = "build";
-    context.allocator    = NCZ_TEMP;
+    buildExe = GetProgramPath(argv[0]); // argv[0] is only a name when it came from the PATH
+    
+    bool watch = false, restart = false, remote = false;
+    cstr baseline = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if      (strcmp(argv[i], "--watch")   == 0) watch   = true;
+        else if (strcmp(argv[i], "--restart") == 0) restart = true;
+        else if (strcmp(argv[i], "--pch")     == 0) usePch    = true;
+        else if (strcmp(argv[i], "--trace")   == 0) timeTrace = true;
+        else if (strcmp(argv[i], "--raylib=archive") == 0) raylibLink = Raylib_Link::ARCHIVE;
+        else if (strcmp(argv[i], "--raylib=thin")    == 0) raylibLink = Raylib_Link::THIN;
+        else if (strcmp(argv[i], "--raylib=objects") == 0) raylibLink = Raylib_Link::OBJECTS;
+        else if (strcmp(argv[i], "--remote") == 0) remote = true;
+        else if (strncmp(argv[i], "--remote=", 9) == 0) {
+            remote = true;
+            ParseWorkers(argv[i] + 9, &compileWorkers);
+        }
+        else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            nativeProfile = FindProfile(argv[i] + 10);
+            if (!nativeProfile) {
+                LogError("unknown profile ", argv[i] + 10, ", pick one of debug-asan, release, release-lto, pgo-instrument, pgo-use or headless");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (strncmp(argv[i], "--bench=", 8) == 0) {
+            bench    = true;
+            baseline = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--unity=", 8) == 0) {
+            unityGroups = static_cast<u32>(strtoul(argv[i] + 8, nullptr, 10));
+            if (!unityGroups) {
+                LogError("--unity needs a number of groups, like --unity=2");
+                return 1;
+            }
+        }
+        else {
+            LogError("unknown flag ", argv[i]);
+            return 1;
+        }
+    }
+    if (bench && watch) {
+        LogError("--bench runs once, it does not go with --watch");
+        return 1;
+    }
+    if (remote && !compileWorkers.count && !StartLocalWorkers()) return 1;
+    if (watch) {
+        bool ok = Watch(restart);
+        StopLocalWorkers();
+        return ok ? 0 : 1;
+    }
     
-    #ifdef  BUILD_NATIVE
-    NCZ_ASSERT(BuildDependencies());
-    #endif//BUILD_NATIVE
-    NCZ_ASSERT(BuildApplication());
+    NCZ_ASSERT(ScanSources());
+    bool built = Build();
+    StopLocalWorkers();
+    NCZ_ASSERT(built);
     
-    RunCmd(/*DEBUGGER,*/NATIVE_EXE);
+    if (bench) return RunBench(baseline) ? 0 : 1;
+    RunCmd(/*DEBUGGER,*/NativeExe(nativeProfile));
     // RunCmd("chromium", WEB_EXE);
     return 0;
 }
 
-NCZ_STATIC_ARRAY_LITERAL(cstr, raylib_units,
-    "raudio", "rcore", "rglfw", "rmodels", "rshapes", "rtext", "rtextures", "utils"
-);
+// --remote without addresses: LOCAL_WORKERS worker processes on unix sockets in TMP_DIR. They
+// compile nothing a local build would not, but they run the same code workers on other machines
+// do, and a watch keeps them (and the cache) around between rebuilds.
+bool StartLocalWorkers() {
+    if (!CreateFolder(TMP_DIR)) return false;
+    for (u32 i = 0; i < LOCAL_WORKERS; ++i) {
+        NCZ_PUSH_STATE(context.allocator, crtAllocator);
+        cstr socket  = SPrint(TMP_DIR NCZ_PATH_SEP "worker-", static_cast<u64>(i), ".sock").data;
+        cstr address = SPrint("unix:", socket).data;
+        cstr args[]  = { buildExe, SPrint("--compile-worker=", address).data };
+        remove(socket);
+        auto [worker, ok] = RunCommandAsync({ 2, args }, false);
+        if (!ok) return false;
+        Push(&localWorkers, worker);
+        Push(&compileWorkers, address);
+    }
+    
+    // NOTE: not strictly needed, a compile that can not reach a worker compiles locally
+    for (u32 tries = 0; tries < 100; ++tries) {
+        bool listening = true;
+        for (cstr address : compileWorkers) listening = listening && GetFileInfo(address + 5).value.exists;
+        if (listening) break;
+        for (cstr address : compileWorkers) ForgetFileInfo(address + 5);
+        SleepNs(10000000);
+    }
+    return true;
+}
 
-bool BuildDependencies() {
-    NCZ_PUSH_STATE(context.logger.label, "build raylib");
-    List<cstr> cc {};
-    List<cstr> ar {};
+void StopLocalWorkers() {
+    for (Process worker : localWorkers) Kill(worker);
+    localWorkers.count = 0;
+}
+
+bool ScanSources() {
+    NCZ_PUSH_STATE(context.allocator, crtAllocator);
+    for (cstr source : sources) Dispose(const_cast<char*>(source));
+    sources.count = 0;
+    return TraverseFolder(SRC_DIR, [&](String path, File_Type type) {
+        if (type == File_Type::FILE) Push(&sources, CopyCstr(path.data));
+        return true;
+    });
+}
+
+bool IsSource(cstr path) {
+    for (cstr source : sources) if (strcmp(source, path) == 0) return true;
+    return false;
+}
+
+// The sources and the file info cache stay resident between rebuilds, and the watcher tells the
+// cache which files changed, so a rebuild only stats what it has to and only rebuilds what is
+// affected: raylib objects (and the archive) for raylib changes, the native and web builds for
+// everything in SRC_DIR.
+bool Watch(bool restart) {
+    File_Watcher watcher {};
+    if (!WatchFolder(&watcher, SRC_DIR)) return false;
+    if (!ScanSources()) return false;
     
-    Append(&cc, "clang", "-std=c11", "-nostdlib", "-Wno-everything",
-              "-I./source/raylib/external/glfw/include",
-              "-DPLATFORM_DESKTOP", "-g", "-c");
-    
-    Append(&ar, "llvm-ar", "crs",
-        #ifndef _WIN32
-        TMP_DIR NCZ_PATH_SEP "libraylib.a"
-        #else
-        TMP_DIR NCZ_PATH_SEP "raylib.lib"
-        #endif//_WIN32
-    );
-    
-    List<Process>  procs     {};
-    String_Builder inputPath {};
-    for (cstr unit: raylib_units) {
-        inputPath.count = 0;
-        Print(&inputPath, "./source/raylib/"_str, unit, ".c\0"_str);
-        --inputPath.count; // so that AsCstr()'s assertion does not fail;
+    Process game = 0;
+    // NOTE: the loop only ends when watching fails, the game should not outlive it
+    NCZ_DEFER(if (game) Kill(game));
+    for (;;) {
+        u64 start   = GetTimeNs();
+        cstr exe     = NativeExe(nativeProfile);
+        u64  oldTime = GetFileInfo(exe).value.mtime;
+        if (Build()) {
+            Log("build finished in ", (GetTimeNs() - start) / 1000000, " ms");
+            bool rebuilt = GetFileInfo(exe).value.mtime != oldTime;
+            if (restart && (rebuilt || !game)) {
+                if (game) Kill(game);
+                auto [proc, ok] = RunCommandAsync({1, &exe});
+                game = ok ? proc : 0;
+            }
+        }
         
-        cstr objectFile = SPrint(TMP_DIR NCZ_PATH_SEP, unit, ".o"_str).data;
-        Push(&ar, objectFile);
+        Log("watching " SRC_DIR " for changes...");
+        Reset(&context.temporaryStorage);
+        auto [changes, ok] = WaitForChanges(&watcher);
+        if (!ok) return false;
         
-        if (!NeedsUpdate(objectFile, inputPath.data)) continue;
+        bool rescan = false;
+        for (cstr change : changes) {
+            Log("changed: ", change);
+            // created or deleted files change the list of sources
+            rescan = rescan || !IsSource(change) || !GetFileInfo(change).value.exists;
+        }
+        if (rescan && !ScanSources()) return false;
+    }
+}
+
+// Writes data to path unless the file already holds exactly that, so generated files only look
+// changed to NeedsUpdate when their content actually changed. The write is atomic, a build that is
+// interrupted never leaves a half written file with a fresh modification time behind.
+bool WriteIfChanged(cstr path, String data) {
+    Write_Options options {};
+    options.atomic = true;
+    if (!GetFileInfo(path).value.exists) return WriteFile(path, data, options);
+    auto [old, ok] = ReadFile(path);
+    if (ok && old.count == data.count && memcmp(old.data, data.data, data.count) == 0) return true;
+    return WriteFile(path, data, options);
+}
+
+// clang -ftime-trace writes a chrome trace per unit, its "Total Frontend" and "Total Backend"
+// events sum up how long the unit spent parsing and generating code
+u64 TraceDuration(cstr trace, cstr eventName) {
+    cstr name = strstr(trace, TPrint("\"name\":\"", eventName, "\"").data);
+    if (!name) return 0;
+    cstr event = name;
+    while (event > trace && *event != '{') --event;
+    cstr dur = strstr(event, "\"dur\":");
+    if (!dur || dur > name) return 0;
+    return strtoull(dur + 6, nullptr, 10);
+}
+
+void ReportTimeTrace(cstr unit, cstr tracePath) {
+    String_Builder trace {};
+    if (!ReadFile(&trace, tracePath)) return;
+    Push(&trace, '\0');
+    u64 frontend = TraceDuration(trace.data, "Total Frontend");
+    u64 backend  = TraceDuration(trace.data, "Total Backend");
+    Log(unit, ": parse ", frontend / 1000, " ms, codegen ", backend / 1000, " ms");
+}
+
+cstr TracePath(cstr name) {
+    return SPrint(TMP_DIR NCZ_PATH_SEP, name, ".json").data;
+}
+
+void AddTimeTrace(Build_Target *target) {
+    if (!timeTrace) return;
+    cstr flag = SPrint("-ftime-trace=", TracePath(target->name)).data;
+    Push(&target->command, flag);
+}
+
+// NOTE: target costs are rough guesses in milliseconds, only how they compare to each other
+// matters: they decide what starts first when there are more targets than processors.
+#define COMPILE_C_COST   1000
+#define COMPILE_PCH_COST 1500
+#define COMPILE_APP_COST 2500
+#define LINK_COST        500
+#define STEP_COST        100
+
+// the order matters for unity files: rcore.c compiles rlgl (so the define has to go before the
+// next unit includes rlgl.h), and rmodels.c has to come after rtextures.c because m3d.h only
+// brings its own copy of stb_image when it was not included yet.
+NCZ_STATIC_ARRAY_LITERAL(cstr, raylib_units,
+    "raudio", "rcore", "utils", "rshapes", "rtextures", "rtext", "rmodels"
+);
+// glfw pulls in X11 and windows.h, whose Font, Rectangle, CloseWindow, ... clash with raylib,
+// so rglfw is always compiled on its own.
+#define RAYLIB_PLATFORM_UNIT "rglfw"
+
+// Targets of a profile are called profile/name, that is also where their files go in TMP_DIR
+cstr ProfileTargetName(Profile *profile, cstr name) {
+    return SPrint(profile->name, NCZ_PATH_SEP, name).data;
+}
+
+cstr ProfilePath(Profile *profile, cstr file) {
+    return SPrint(TMP_DIR NCZ_PATH_SEP, profile->name, NCZ_PATH_SEP, file).data;
+}
+
+// Gives a compile the flags of the profile, and makes it wait for the pgo profile if it uses one
+void AddProfileFlags(Build_Target *target, Profile *profile) {
+    Extend(&target->command, profile->flags);
+    if (profile->training) Push(&target->inputs, PGO_DATA);
+}
+
+// Adds the target for one raylib object, the object goes into the inputs of user (the archive, or
+// the link when the objects are linked directly)
+Build_Target *AddRaylibObject(Build_Graph *graph, Profile *profile, Build_Target *user, cstr unit, cstr source) {
+    cstr object = ProfilePath(profile, SPrint(unit, ".o").data);
+    auto target = AddTarget(graph, ProfileTargetName(profile, unit));
+    target->cost = COMPILE_C_COST;
+    Push(&target->inputs,  source);
+    Push(&target->outputs, object);
+    Append(&target->command, "clang", "-std=c11", "-nostdlib", "-Wno-everything",
+                             "-I./source/raylib/external/glfw/include", Platform(profile));
+    AddProfileFlags(target, profile);
+    Append(&target->command, "-c", source, "-o", object);
+    AddTimeTrace(target);
+    Push(&user->inputs, object);
+    return target;
+}
+
+// Generates the unity files for --unity=N: the units are split into N groups, in order. The files
+// are the same for every profile, so they stay in TMP_DIR.
+bool AddRaylibUnityObjects(Build_Graph *graph, Profile *profile, Build_Target *user) {
+    u32 groups = unityGroups < raylib_units.count ? unityGroups : static_cast<u32>(raylib_units.count);
+    for (u32 group = 0, unit = 0; group < groups; ++group) {
+        cstr name   = SPrint("raylib_unity_", static_cast<u64>(group)).data;
+        cstr source = SPrint(TMP_DIR NCZ_PATH_SEP, name, ".c").data;
+        auto target = AddRaylibObject(graph, profile, user, name, source);
         
-        Append(&cc, AsCstr(inputPath), "-o", objectFile);
-            auto [proc, ok] = RunCommandAsync(cc);
-            if (!ok) return false;
-            Push(&procs, proc);
-        cc.count -= 3;
+        String_Builder text {};
+        Write(&text, "// generated by build.cpp\n"_str);
+        u32 end = static_cast<u32>((group + 1) * raylib_units.count / groups);
+        for (; unit < end; ++unit) {
+            Print(&text, "#include \"../source/raylib/", raylib_units.data[unit], ".c\"\n");
+            if (strcmp(raylib_units.data[unit], "rcore") == 0) Write(&text, "#undef RLGL_IMPLEMENTATION\n"_str);
+            cstr input = SPrint("./source/raylib/", raylib_units.data[unit], ".c").data;
+            Push(&target->inputs, input);
+            target->cost += COMPILE_C_COST;
+        }
+        if (!WriteIfChanged(source, { text.count, text.data })) return false;
     }
+    return true;
+}
+
+// Only the objects that changed go into an archive that already exists, llvm-ar replaces them and
+// updates the symbol index. A thin archive only holds the paths of its objects, so updating it
+// does not copy any object code at all.
+// The archive target's first input is the layout file, the rest are the objects
+bool ArchiveRaylib(void *data) {
+    auto archive = static_cast<Build_Target*>(data);
+    cstr path    = archive->outputs[0];
+    auto [lib, ok] = GetFileInfo(path);
+    if (!ok) return false;
+    // a new layout starts from an empty archive, so that objects of the old one do not stick around
+    bool fresh = !lib.exists || GetFileInfo(archive->inputs[0]).value.mtime > lib.mtime;
+    if (fresh) remove(path);
     
-    if (!Wait(procs)) return false;
-    if (procs.count)  return RunCommandSync(ar);
+    List<cstr> ar {};
+    Append(&ar, "llvm-ar", raylibLink == Raylib_Link::THIN ? "rcsT" : "rcs", path);
+    for (usize i = 1; i < archive->inputs.count; ++i) {
+        if (fresh || GetFileInfo(archive->inputs[i]).value.mtime > lib.mtime) Push(&ar, archive->inputs[i]);
+    }
+    return RunCommandSync(ar);
+}
+
+// Adds raylib to the inputs and the command of link
+bool AddRaylibTargets(Build_Graph *graph, Profile *profile, Build_Target *link) {
+    Build_Target *user = link;
+    usize objects = link->inputs.count;
+    if (raylibLink != Raylib_Link::OBJECTS) {
+        // the archive has to start over when the layout changes, even if the objects of the new
+        // layout are older than it
+        cstr layout = ProfilePath(profile, RAYLIB_LAYOUT);
+        cstr lib    = ProfilePath(profile, RAYLIB_LIB);
+        cstr kind   = raylibLink == Raylib_Link::THIN ? "thin" : "regular";
+        if (!WriteIfChanged(layout, TPrint("unity groups: ", static_cast<u64>(unityGroups), ", archive: ", kind))) return false;
+        user = AddTarget(graph, ProfileTargetName(profile, "raylib"));
+        user->cost = STEP_COST;
+        user->proc = ArchiveRaylib;
+        user->data = user;
+        Push(&user->inputs,  layout);
+        Push(&user->outputs, lib);
+        Push(&link->inputs,  lib);
+        cstr folder = SPrint("-L", ProfilePath(profile, "")).data;
+        Append(&link->command, folder, "-lraylib");
+    }
+    
+    // NOTE: without a window there is no glfw to build
+    if (!profile->headless) AddRaylibObject(graph, profile, user, RAYLIB_PLATFORM_UNIT, "./source/raylib/" RAYLIB_PLATFORM_UNIT ".c");
+    if (unityGroups) {
+        if (!AddRaylibUnityObjects(graph, profile, user)) return false;
+    } else {
+        for (cstr unit : raylib_units) {
+            AddRaylibObject(graph, profile, user, unit, SPrint("./source/raylib/", unit, ".c").data);
+        }
+    }
+    if (user == link) {
+        for (usize i = objects; i < link->inputs.count; ++i) Push(&link->command, link->inputs[i]);
+    }
     return true;
 }
 
-bool BuildApplication() {
-    NCZ_PUSH_STATE(context.logger.label, "build application");
+// Everything ENTRY_POINT includes before its own code. It barely changes, but it is most of what
+// the compiler has to parse (raylib.h, and all of ncz), so --pch precompiles it once.
+static const char pchHeader[] =
+    "// generated by build.cpp\n"
+    "#define NCZ_IMPLEMENTATION\n"
+    "#include \"math.h\"\n"
+    "#include \"../source/nczlib/ncz.hpp\"\n"
+    "#include \"../source/raylib/raylib.cpp\"\n";
+#define PCH_HEADER TMP_DIR NCZ_PATH_SEP "app_pch.hpp"
+
+// clang only accepts a precompiled header that was built with the same flags as the file that
+// uses it, that is why every build (web, each native profile) gets its own
+bool AddPrecompiledHeader(Build_Graph *graph, Build_Target *app, Array<cstr> flags) {
+    if (!WriteIfChanged(PCH_HEADER, { sizeof(pchHeader) - 1, const_cast<char*>(pchHeader) })) return false;
     
-    List<cstr> sources {};
-    bool ok = TraverseFolder(SRC_DIR, [&](String path, File_Type type) {
-        if (type == File_Type::FILE) Push(&sources, CopyCstr(path.data));
-        return true;
-    });
+    cstr name = SPrint(app->name, "_pch").data;
+    cstr pch  = SPrint(TMP_DIR NCZ_PATH_SEP, name, ".pch").data;
+    auto target = AddTarget(graph, name);
+    target->cost = COMPILE_PCH_COST;
+    Append(&target->inputs, PCH_HEADER, "source/nczlib/ncz.hpp", "source/raylib/raylib.cpp", "source/raylib/raylib.h");
+    Push(&target->outputs, pch);
+    Push(&target->command, "clang");
+    Extend(&target->command, flags);
+    Append(&target->command, "-x", "c++-header", PCH_HEADER, "-o", pch);
+    AddTimeTrace(target);
+    
+    Push(&app->inputs, pch);
+    Append(&app->command, "-include-pch", pch);
+    return true;
+}
+
+// Plays the instrumented game (main.cpp --autoplay) and merges what it recorded into the profile
+bool TrainPgoProfile(void *data) {
+    auto training = static_cast<Build_Target*>(data);
+    if (!CreateFolder(PGO_DIR)) return false;
+    // NOTE: every run writes its own file (%p is the process id), the ones of earlier trainings
+    // have to go or they would end up in the new profile
+    auto isRaw = [](cstr name) { usize n = strlen(name); return n > 8 && strcmp(name + n - 8, ".profraw") == 0; };
+    auto [old, ok] = ReadFolder(PGO_DIR);
     if (!ok) return false;
+    for (cstr name : old) if (isRaw(name)) remove(TPrint(PGO_DIR NCZ_PATH_SEP, name).data);
     
-    List<cstr> cmd {};
-#ifdef  BUILD_NATIVE
-    if (NeedsUpdate(NATIVE_EXE, sources)) {
-        Log("Building native");
-        cmd.count = 0;
-        Append(&cmd,
-            "clang", NCZ_CFLAGS, "-fsanitize=address",
-            ENTRY_POINT, "-o", NATIVE_EXE, "-DPLATFORM_DESKTOP",
-            "-I./source/raylib/external/glfw/include",
-            "-L" TMP_DIR NCZ_PATH_SEP, "-lraylib"
-        );
-    #ifdef _WIN32
-        Append(&cmd,
-            "-D_CRT_SECURE_NO_WARNINGS",
-            "-Xlinker", "/INCREMENTAL:NO",
-            "-Xlinker", "/NOLOGO",
-            "-Xlinker", "/NOIMPLIB",
-            "-Xlinker", "/NODEFAULTLIB:msvcrt.lib",
-            "-ldbghelp", "-lwinmm", "-lgdi32", "-luser32", "-lshell32"
-        );
-    #endif
-    
-        if (!RunCommandSync(cmd)) return false;
+    if (!SetEnvironment("LLVM_PROFILE_FILE", PGO_DIR NCZ_PATH_SEP "game-%p.profraw")) return false;
+    bool played = RunCmd(training->inputs[0], "--autoplay=" PGO_FRAMES);
+    SetEnvironment("LLVM_PROFILE_FILE", nullptr);
+    if (!played) return false;
+    
+    List<cstr> merge {};
+    Append(&merge, "llvm-profdata", "merge", "-o", PGO_DATA);
+    auto [raw, found] = ReadFolder(PGO_DIR);
+    if (!found) return false;
+    for (cstr name : raw) {
+        cstr path = SPrint(PGO_DIR NCZ_PATH_SEP, name).data;
+        if (isRaw(name)) Push(&merge, path);
     }
-#endif//BUILD_NATIVE
+    return RunCommandSync(merge);
+}
 
-#ifdef  BUILD_WEB
-    if (NeedsUpdate(WEB_EXE, sources)) {
-        Log("Building web");
-        cmd.count = 0;
-        Append(&cmd, "clang", NCZ_CSTD, "-Os",
-                    ENTRY_POINT, "-o", TMP_DIR NCZ_PATH_SEP PROJECT_NAME ".wasm",
-                    "--target=wasm32-wasi", "--sysroot=temporary/wasi-sysroot",
-                    "-nodefaultlibs", "-lc", "-lwasi-emulated-mman",
-                    "-DPLATFORM_WEB", "-DNCZ_NO_OS", "-D_WASI_EMULATED_MMAN",
-                    "-Wl,--allow-undefined", "-Wl,--export-all");
-        if (!RunCommandSync(cmd)) return false;
-        
-        String_Builder out {};
-        auto [wasm_bin, ok] = ReadFile(TMP_DIR NCZ_PATH_SEP PROJECT_NAME ".wasm");
-        if (!ok) return false;
-        
-        // embed raylib and wasm application into html
-        Write(&out, "<script>\n"_str);
-            Write(&out, "const wasm_binary = new Uint8Array([\n"_str);
-            constexpr const u64 CHUNK = 32;
-            for (u64 i = 0, c = 0; i < wasm_bin.count; ++i, ++c) {
-                Print(&out, static_cast<u8>(wasm_bin[i]), ","_str);
-                if (c == CHUNK) { Print(&out, "\n"_str); c = 0; }
-            }
-            Write(&out, "\n]);\n"_str);
-            if (!ReadFile(&out, "source/raylib/raylib.js")) return false;
-        Write(&out, "</script>\n"_str);
-        
-        if (!ReadFile(&out, "source/index.html")) return false;
-        // Log(String{out.data, out.count});
-        return WriteFile(WEB_EXE, { out.count, out.data });
+bool AddNativeTargets(Build_Graph *graph, Profile *profile) {
+    if (!CreateFolder(ProfilePath(profile, ""))) return false;
+    if (profile->training) {
+        Profile *trainer = FindProfile(profile->training);
+        if (!trainer) {
+            LogError("profile ", profile->name, " trains with ", profile->training, ", which is not a profile");
+            return false;
+        }
+        if (!AddNativeTargets(graph, trainer)) return false;
+        auto training = AddTarget(graph, "pgo_training");
+        training->cost = STEP_COST;
+        training->proc = TrainPgoProfile;
+        training->data = training;
+        Push(&training->inputs,  NativeExe(trainer));
+        Push(&training->outputs, PGO_DATA);
     }
-#endif//BUILD_WEB
+    
+    List<cstr> flags {};
+    Append(&flags, NCZ_CSTD, "-Wall", "-Wextra", "-Wpedantic", "-Werror", Platform(profile),
+                   "-I./source/raylib/external/glfw/include");
+#ifdef _WIN32
+    Push(&flags, "-D_CRT_SECURE_NO_WARNINGS");
+#endif
+    Extend(&flags, profile->flags);
+    cstr object = ProfilePath(profile, PROJECT_NAME ".o");
+    cstr exe    = NativeExe(profile);
+    
+    // NOTE: compiling and linking are separate targets, so that compiling the game does not have to
+    // wait for raylib, only the link does
+    auto native = AddTarget(graph, ProfileTargetName(profile, "native"));
+    native->cost = COMPILE_APP_COST;
+    Extend(&native->inputs, sources);
+    if (profile->training) Push(&native->inputs, PGO_DATA);
+    Push(&native->outputs, object);
+    Push(&native->command, "clang");
+    Extend(&native->command, flags);
+    if (usePch && !AddPrecompiledHeader(graph, native, flags)) return false;
+    AddTimeTrace(native);
+    Append(&native->command, "-c", ENTRY_POINT, "-o", object);
+    
+    auto link = AddTarget(graph, ProfileTargetName(profile, "link"));
+    link->cost = LINK_COST;
+    Push(&link->inputs,  object);
+    Push(&link->outputs, exe);
+    Push(&link->command, "clang");
+    Extend(&link->command, profile->linkFlags);
+    Append(&link->command, object, "-o", exe);
+    if (!AddRaylibTargets(graph, profile, link)) return false;
+    Extend(&link->command, system_link_flags);
+    return true;
+}
+
+#define BENCH_EXE  OUT_DIR NCZ_PATH_SEP PROJECT_NAME "-bench" EXE
+#define BENCH_JSON OUT_DIR NCZ_PATH_SEP "bench.json"
+
+// The benchmarks, with the raylib ones, built like the release profile builds the game. They are
+// one unit that is only built when asked for, so compiling and linking are one command.
+bool AddBenchTargets(Build_Graph *graph) {
+    Profile *profile = FindProfile("release");
+    if (!profile) {
+        LogError("the benchmarks build like the release profile, which is missing");
+        return false;
+    }
+    if (!CreateFolder(ProfilePath(profile, ""))) return false;
+    auto target = AddTarget(graph, ProfileTargetName(profile, "bench"));
+    target->cost = COMPILE_APP_COST;
+    Extend(&target->inputs, sources);
+    Push(&target->outputs, BENCH_EXE);
+    Push(&target->command, "clang");
+    Append(&target->command, NCZ_CSTD, "-Wall", "-Wextra", "-Wpedantic", "-Werror",
+                             "-DBENCH_RAYLIB", "-DPLATFORM_DESKTOP");
+#ifdef _WIN32
+    Push(&target->command, "-D_CRT_SECURE_NO_WARNINGS");
+#endif
+    Extend(&target->command, profile->flags);
+    Append(&target->command, "./source/bench.cpp", "-o", BENCH_EXE);
+    if (!AddRaylibTargets(graph, profile, target)) return false;
+    Extend(&target->command, system_link_flags);
+    return true;
+}
+
+bool RunBench(cstr baseline) {
+    List<cstr> command {};
+    Append(&command, BENCH_EXE, "--json=" BENCH_JSON);
+    if (baseline) Push(&command, static_cast<cstr>(SPrint("--compare=", baseline).data));
+    if (!RunCommandSync(command)) return false;
+    Log("wrote ", BENCH_JSON, ", keep it around and build with --bench=<it> to compare later runs against it");
+    return true;
+}
+
+#define WEB_WASM TMP_DIR NCZ_PATH_SEP PROJECT_NAME ".wasm"
+
+// Embeds raylib and the wasm application into the html. The wasm goes in as a base64 string,
+// which is a third bigger than the binary (a decimal array literal is about four times bigger)
+// and is decoded natively by the browser instead of being parsed as javascript. Everything is
+// streamed into the html, so this never holds more than a buffer's worth of it in memory. The
+// stream is atomic: a page that is reloaded while this runs gets the previous build, not half of it.
+bool EmbedWasm(void *) {
+    u64 start = GetTimeNs();
+    Stream out {};
+    Write_Options options {};
+    options.atomic = true;
+    if (!OpenStream(&out, WEB_EXE, options)) return false;
+    
+    Write(&out, "<script>\n"_str);
+        Write(&out, "const wasm_base64 = \""_str);
+        u64 payload = out.written + out.buffer.count;
+        SetEncoding(&out, Stream_Encoding::BASE64);
+        CopyFileToStream(&out, WEB_WASM);
+        SetEncoding(&out, Stream_Encoding::NONE);
+        payload = out.written + out.buffer.count - payload;
+        Write(&out, "\";\n"_str);
+        Write(&out,
+            "const wasm_binary = Uint8Array.fromBase64 ? Uint8Array.fromBase64(wasm_base64) : (() => {\n"
+            "    const text = atob(wasm_base64), bytes = new Uint8Array(text.length);\n"
+            "    for (let i = 0; i < text.length; ++i) bytes[i] = text.charCodeAt(i);\n"
+            "    return bytes;\n"
+            "})();\n"_str);
+        CopyFileToStream(&out, "source/raylib/raylib.js");
+    Write(&out, "</script>\n"_str);
+    CopyFileToStream(&out, "source/index.html");
+    if (!CloseStream(&out)) return false;
+    
+    Log("embedded ", GetFileInfo(WEB_WASM).value.size / 1024, " KB of wasm as ", payload / 1024,
+        " KB of base64 in ", (GetTimeNs() - start) / 1000, " us");
+    return true;
+}
 
+bool AddWebTargets(Build_Graph *graph) {
+    List<cstr> flags {};
+    // NOTE: -msimd128 is for the batched collision checks in raylib.cpp, every browser of the last few years has it
+    Append(&flags, NCZ_CSTD, "-Os", "-msimd128",
+                   "--target=wasm32-wasi", "--sysroot=temporary/wasi-sysroot",
+                   "-DPLATFORM_WEB", "-DNCZ_NO_OS", "-D_WASI_EMULATED_MMAN");
+    
+    auto web = AddTarget(graph, "web");
+    web->cost = COMPILE_APP_COST;
+    Extend(&web->inputs, sources);
+    Push(&web->outputs, WEB_WASM);
+    Push(&web->command, "clang");
+    Extend(&web->command, flags);
+    if (usePch && !AddPrecompiledHeader(graph, web, flags)) return false;
+    AddTimeTrace(web);
+    Append(&web->command, ENTRY_POINT, "-o", WEB_WASM,
+                          "-nodefaultlibs", "-lc", "-lwasi-emulated-mman",
+                          "-Wl,--allow-undefined", "-Wl,--export-all");
+    
+    auto html = AddTarget(graph, "html");
+    html->cost = STEP_COST;
+    html->proc = EmbedWasm;
+    Append(&html->inputs, WEB_WASM, "source/raylib/raylib.js", "source/index.html");
+    Push(&html->outputs, WEB_EXE);
+    return true;
+}
+
+// Every command and step of the last build, with how long it took and how much memory it needed,
+// open it in ui.perfetto.dev or chrome://tracing to see what the build waited on
+#define JOB_TRACE TMP_DIR NCZ_PATH_SEP "build_trace.json"
+
+// The whole build as one graph: ncz figures out what is out of date and runs everything that does
+// not wait on something else at the same time, so the web build and the game overlap with the
+// raylib objects and only the native link has to wait for raylib.
+bool Build() {
+    StartJobTrace();
+    NCZ_DEFER(WriteJobTrace(JOB_TRACE));
+    Build_Graph graph {};
+    if (bench) {
+        if (!AddBenchTargets(&graph)) return false;
+    } else {
+#ifdef  BUILD_NATIVE
+        if (!AddNativeTargets(&graph, nativeProfile)) return false;
+#endif//BUILD_NATIVE
+#ifdef  BUILD_WEB
+        if (!AddWebTargets(&graph)) return false;
+#endif//BUILD_WEB
+    }
+    
+    // NOTE: a remote compile spends part of its time preprocessing here and the rest waiting on a
+    // worker, twice as many at a time keeps both sides busy
+    u32 jobs = 0;
+    if (compileWorkers.count) {
+        if (!compileFlag) {
+            String_Builder flag {};
+            flag.allocator = crtAllocator;
+            Write(&flag, "--compile=");
+            for (usize i = 0; i < compileWorkers.count; ++i) Print(&flag, i ? "," : "", compileWorkers[i]);
+            Push(&flag, '\0');
+            compileFlag = flag.data;
+        }
+        for (auto target : graph.targets) {
+            if (!CanCompileRemotely(target->command)) continue;
+            List<cstr> command {};
+            Append(&command, buildExe, compileFlag, static_cast<cstr>("--"));
+            Extend(&command, target->command);
+            target->command = command;
+        }
+        jobs = 2 * GetProcessorCount();
+    }
+    
+    // both application targets look at every source, stat them all up front in one go
+    if (!PrefetchFileInfo(sources, GetProcessorCount())) return false;
+    if (!RunBuildGraph(&graph, jobs)) return false;
+    
+    if (timeTrace) {
+        for (auto target : graph.targets) {
+            // NOTE: links and steps have no trace
+            cstr trace = TracePath(target->name);
+            ForgetFileInfo(trace);
+            if (target->ran && GetFileInfo(trace).value.exists) ReportTimeTrace(target->name, trace);
+        }
+    }
     return true;
-}
\ No newline at end of file
+}
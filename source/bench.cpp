@@ -0,0 +1,923 @@
+#define NCZ_IMPLEMENTATION
+#include "nczlib/ncz.hpp"
+#ifdef BENCH_RAYLIB
+#include "raylib/raylib.cpp"
+namespace rl {
+    #include "raylib/rlgl.h"
+}
+#endif//BENCH_RAYLIB
+#include "balls.hpp"
+using namespace ncz;
+
+// build.out --bench builds the benchmarks with the raylib of the release profile and runs them all,
+// or by hand without the raylib ones:
+// POSIX: clang -std=c++17 -nostdinc++ -fno-rtti -fno-exceptions -O2 -o temporary/bench source/bench.cpp && ./temporary/bench
+//
+// usage: bench [--json=PATH] [--compare=BASELINE] [--threshold=PERCENT] [GROUP...]
+// GROUPs are the names in benchGroups below, all of them run by default. --json writes what went
+// through Bench to PATH, --compare warns about everything that got slower than in BASELINE (a file
+// --json wrote) by more than PERCENT (10 by default) and then exits with 1.
+// It also exits with 1, before writing anything, when a check of a benchmark got a wrong answer.
+
+#define BENCH_DIR "temporary" NCZ_PATH_SEP "bench-data"
+
+// every result of Bench, for --json and --compare
+List<Bench_Result> results { {}, 0, crtAllocator };
+// NOTE: some benchmarks also check that the fast code gets the same answer as the simple one, a
+// wrong answer fails the run, however fast it was
+bool checksFailed = false;
+
+void Record(Bench_Result result) {
+    Log(result);
+    result.name = SPrint(result.name).data; // NOTE: most names are in temporary storage, which the next bench resets
+    Push(&results, result);
+}
+
+// Runs f a couple of times and returns the fastest run in nanoseconds
+template <typename F>
+u64 Measure(u32 runs, F f) {
+    u64 best = ~0ull;
+    for (u32 i = 0; i < runs; ++i) {
+        Reset(&context.temporaryStorage);
+        u64 start = GetTimeNs();
+        f();
+        u64 elapsed = GetTimeNs() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+void Report(cstr name, u64 ns, u64 items) {
+    Log(name, ": ", ns / 1000, " us (", items, " entries, ", items ? ns / items : 0, " ns each)");
+}
+
+// 100 folders * 10 sub folders * 100 files = 100k files
+bool MakeWalkTree(cstr root) {
+    if (GetFileInfo(root).value.exists) return true;
+    Log("creating ", root, ", this takes a moment...");
+    for (u32 i = 0; i < 100; ++i) {
+        for (u32 j = 0; j < 10; ++j) {
+            NCZ_SAVE_STATE(context.temporaryStorage.mark);
+            cstr folder = TPrint(root, NCZ_PATH_SEP, (u64) i, NCZ_PATH_SEP, (u64) j).data;
+            if (!CreateFolder(folder)) return false;
+            for (u32 k = 0; k < 100; ++k) {
+                if (!WriteFile(TPrint(folder, NCZ_PATH_SEP, (u64) k, ".c").data, ""_str)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// what TraverseFolder used to do: readdir, then stat every entry by its full path
+u64 WalkWithStat(String_Builder *path) {
+    auto [children, ok] = ReadFolder(path->data);
+    NCZ_ASSERT(ok);
+
+    u64 count = 0;
+    usize base = path->count;
+    for (cstr child : children) {
+        if (strcmp(".", child) == 0 || strcmp("..", child) == 0) continue;
+        path->count = base;
+        Print(path, NCZ_PATH_SEP, child);
+        Push(path, '\0');
+        path->count -= 1;
+
+        count += 1;
+        auto [type, ok] = GetFileType(path->data);
+        NCZ_ASSERT(ok);
+        if (type == File_Type::FOLDER) count += WalkWithStat(path);
+    }
+    path->count = base;
+    return count;
+}
+
+void BenchWalkFolder() {
+    cstr root = BENCH_DIR NCZ_PATH_SEP "walk";
+    NCZ_ASSERT(MakeWalkTree(root));
+
+    u64 count = 0;
+    u64 ns = Measure(5, [&]() {
+        ClearFileInfoCache();
+        NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+        String_Builder path {};
+        Write(&path, root);
+        Push(&path, '\0');
+        path.count -= 1;
+        count = WalkWithStat(&path);
+    });
+    Report("readdir + stat          ", ns, count);
+
+    for (u32 threads = 1; threads <= GetProcessorCount(); threads *= 2) {
+        Walk_Options options {};
+        options.threads = threads;
+        ns = Measure(5, [&]() {
+            NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+            count = WalkFolder(root, options).value.count;
+        });
+        Report(TPrint("WalkFolder (", (u64) threads, " threads)").data, ns, count);
+    }
+}
+
+// what build.cpp used to do to embed the wasm: a decimal array literal, one Print per byte
+void WriteDecimalArray(String_Builder *out, String data) {
+    constexpr const u64 CHUNK = 32;
+    for (u64 i = 0, c = 0; i < data.count; ++i, ++c) {
+        Print(out, static_cast<u8>(data[i]), ","_str);
+        if (c == CHUNK) { Print(out, "\n"_str); c = 0; }
+    }
+}
+
+void BenchEmbed() {
+    // about the size of a wasm build of the game, random bytes compress and encode like code does
+    String data { 4 << 20, static_cast<char*>(Allocate(4 << 20, crtAllocator)) };
+    NCZ_DEFER(Dispose(data.data, crtAllocator));
+    u64 seed = 0x2545F4914F6CDD1Dull;
+    for (usize i = 0; i < data.count; ++i) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        data.data[i] = static_cast<char>(seed);
+    }
+    
+    usize size = 0;
+    u64 ns = Measure(5, [&]() {
+        String_Builder out {};
+        out.allocator = NCZ_TEMP;
+        WriteDecimalArray(&out, data);
+        size = out.count;
+    });
+    Report(TPrint("decimal array (", size / 1024, " KB)").data, ns, data.count);
+    
+    ns = Measure(5, [&]() {
+        String_Builder out {};
+        out.allocator = NCZ_TEMP;
+        WriteBase64(&out, data);
+        size = out.count;
+    });
+    Report(TPrint("WriteBase64   (", size / 1024, " KB)").data, ns, data.count);
+}
+
+// packaging an asset bundle: a few big files concatenated into one, whole files in memory vs streamed
+void BenchPackage() {
+    cstr asset  = BENCH_DIR NCZ_PATH_SEP "asset.bin";
+    cstr bundle = BENCH_DIR NCZ_PATH_SEP "bundle.bin";
+    constexpr const usize SIZE = 32 << 20, COUNT = 4;
+    if (GetFileInfo(asset).value.size != SIZE) {
+        String data { SIZE, static_cast<char*>(Allocate(SIZE, crtAllocator)) };
+        for (usize i = 0; i < SIZE; ++i) data.data[i] = static_cast<char>(i * 2654435761u >> 24);
+        NCZ_ASSERT(CreateFolder(BENCH_DIR) && WriteFile(asset, data));
+        Dispose(data.data, crtAllocator);
+    }
+    
+    u64 ns = Measure(3, [&]() {
+        String_Builder out {};
+        out.allocator = NCZ_TEMP;
+        for (usize i = 0; i < COUNT; ++i) NCZ_ASSERT(ReadFile(&out, asset));
+        NCZ_ASSERT(WriteFile(bundle, { out.count, out.data }));
+    });
+    Report("ReadFile + WriteFile    ", ns, COUNT);
+    
+    ns = Measure(3, [&]() {
+        Stream out {};
+        NCZ_ASSERT(OpenStream(&out, bundle));
+        for (usize i = 0; i < COUNT; ++i) CopyFileToStream(&out, asset);
+        NCZ_ASSERT(CloseStream(&out));
+    });
+    Report("CopyFileToStream        ", ns, COUNT);
+}
+
+// loading a folder of assets: one ReadFile per file (what raylib's LoadFileData does) vs one batch
+void BenchReadFiles() {
+    cstr root = BENCH_DIR NCZ_PATH_SEP "assets";
+    constexpr const u32 COUNT = 2000;
+    List<cstr> paths {};
+    for (u32 i = 0; i < COUNT; ++i) {
+        cstr path = SPrint(root, NCZ_PATH_SEP, (u64) i, ".bin").data;
+        Push(&paths, path);
+    }
+    if (!GetFileInfo(paths[COUNT - 1]).value.exists) {
+        Log("creating ", root, ", this takes a moment...");
+        NCZ_ASSERT(CreateFolder(root));
+        // 1 to 64 KB, textures and sounds of a small game
+        static char data[64 << 10];
+        for (usize i = 0; i < sizeof(data); ++i) data[i] = static_cast<char>(i * 2654435761u >> 24);
+        for (u32 i = 0; i < COUNT; ++i) {
+            usize size = 1024 + (i * 2654435761u) % (sizeof(data) - 1024);
+            NCZ_ASSERT(WriteFile(paths[i], { size, data }));
+        }
+    }
+    
+    u64 bytes = 0;
+    u64 ns = Measure(5, [&]() {
+        NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+        bytes = 0;
+        for (cstr path : paths) {
+            auto [data, ok] = ReadFile(path);
+            NCZ_ASSERT(ok);
+            bytes += data.count;
+        }
+    });
+    Report(TPrint("ReadFile one by one (", bytes >> 20, " MB)").data, ns, COUNT);
+    
+    List<File_Request> requests {};
+    for (cstr path : paths) {
+        File_Request request {};
+        request.path = path;
+        Push(&requests, request);
+    }
+    File_Batch_Options options {};
+    options.allowRing = false;
+    ns = Measure(5, [&]() {
+        NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+        NCZ_ASSERT(ReadFiles(requests, options));
+    });
+    Report("ReadFiles, threads        ", ns, COUNT);
+    
+    options.allowRing = true;
+    ns = Measure(5, [&]() {
+        NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+        NCZ_ASSERT(ReadFiles(requests, options));
+    });
+    Report("ReadFiles, io_uring       ", ns, COUNT);
+    
+    // only the stats, what a build does to find out what is out of date
+    ns = Measure(5, [&]() {
+        ClearFileInfoCache();
+        NCZ_ASSERT(PrefetchFileInfo(paths));
+    });
+    Report("PrefetchFileInfo          ", ns, COUNT);
+    
+    for (auto &request : requests) request.read = false;
+    ns = Measure(5, [&]() {
+        NCZ_ASSERT(ReadFiles(requests, options));
+    });
+    Report("ReadFiles stat, io_uring  ", ns, COUNT);
+}
+
+// a pass over a big array (what image processing and mesh generation look like), and how much a
+// task costs on its own
+static void CountTask(void *data) { __atomic_add_fetch(static_cast<u64*>(data), 1, __ATOMIC_RELAXED); }
+
+void BenchTasks() {
+    constexpr const usize COUNT = 16 << 20;
+    Array<f32> values { COUNT, static_cast<f32*>(Allocate(COUNT * sizeof(f32), crtAllocator)) };
+    NCZ_DEFER(Dispose(values.data, crtAllocator));
+    for (usize i = 0; i < COUNT; ++i) values.data[i] = static_cast<f32>(i & 1023);
+    auto shade = [](f32 &x) { x = x * 0.5f + 1.0f; x = x * x / (x + 1.0f); };
+    
+    u64 ns = Measure(5, [&]() { for (auto &x : values) shade(x); });
+    Report("for loop                ", ns, COUNT);
+    
+    Task_Pool pool {};
+    NCZ_ASSERT(StartTaskPool(&pool));
+    ns = Measure(5, [&]() { ParallelFor(&pool, values, shade); });
+    Report(TPrint("ParallelFor (", static_cast<u64>(pool.count), " threads)").data, ns, COUNT);
+    
+    constexpr const u32 TASKS = 100000;
+    u64 done = 0;
+    ns = Measure(5, [&]() {
+        for (u32 i = 0; i < TASKS; ++i) AddTask(&pool, CountTask, &done);
+        WaitForTasks(&pool);
+    });
+    Report("AddTask + WaitForTasks  ", ns, TASKS);
+    StopTaskPool(&pool);
+}
+
+// the hand offs between threads that a game has: everybody updating shared state under a lock, a
+// thread waking another one and waiting for the answer, a stream of items to a loader or audio thread
+struct Sync_Bench {
+    Mutex       mutex;
+    u64         counter;
+    u64         count;
+    Semaphore   ping, pong;
+    Spsc_Queue<u64> spsc;
+    Mpmc_Queue<u64> mpmc;
+    Event_Count notEmpty, notFull;
+    u64         sum;
+};
+
+static void LockLoop(void *data) {
+    auto bench = static_cast<Sync_Bench*>(data);
+    for (u64 i = 0; i < bench->count; ++i) {
+        Lock(&bench->mutex);
+        bench->counter += 1;
+        Unlock(&bench->mutex);
+    }
+}
+
+static void PongLoop(void *data) {
+    auto bench = static_cast<Sync_Bench*>(data);
+    for (u64 i = 0; i < bench->count; ++i) { Wait(&bench->ping); Post(&bench->pong); }
+}
+
+// NOTE: the queue loops sleep on the event counts when they cannot go on, spinning on a full or
+// empty queue would measure the scheduler instead once there are more threads than processors
+template <typename Q>
+static void PushItems(Sync_Bench *bench, Q *queue, u64 count) {
+    for (u64 i = 1; i <= count; ++i) {
+        while (!Push(queue, i)) {
+            u32 key = PrepareWait(&bench->notFull);
+            if (!Push(queue, i)) { CommitWait(&bench->notFull, key); continue; }
+            break;
+        }
+        Notify(&bench->notEmpty);
+    }
+}
+
+template <typename Q>
+static void PopItems(Sync_Bench *bench, Q *queue, u64 count) {
+    u64 sum = 0;
+    for (u64 i = 0; i < count; ++i) {
+        u64 item;
+        while (!Pop(queue, &item)) {
+            u32 key = PrepareWait(&bench->notEmpty);
+            if (!Pop(queue, &item)) { CommitWait(&bench->notEmpty, key); continue; }
+            break;
+        }
+        Notify(&bench->notFull);
+        sum += item;
+    }
+    __atomic_add_fetch(&bench->sum, sum, __ATOMIC_RELAXED);
+}
+
+static void SpscConsumer(void *data) {
+    auto bench = static_cast<Sync_Bench*>(data);
+    PopItems(bench, &bench->spsc, bench->count);
+}
+static void MpmcProducer(void *data) {
+    auto bench = static_cast<Sync_Bench*>(data);
+    PushItems(bench, &bench->mpmc, bench->count);
+}
+static void MpmcConsumer(void *data) {
+    auto bench = static_cast<Sync_Bench*>(data);
+    PopItems(bench, &bench->mpmc, bench->count);
+}
+
+void BenchSync() {
+    Sync_Bench bench {};
+    for (u32 threads = 1; threads <= 4; threads *= 2) {
+        bench.count = 1000000 / threads;
+        u64 ns = Measure(3, [&]() {
+            Result<Thread> workers[4];
+            for (u32 i = 0; i < threads; ++i) workers[i] = StartThread(LockLoop, &bench);
+            for (u32 i = 0; i < threads; ++i) JoinThread(workers[i].value);
+        });
+        Report(TPrint("Lock + Unlock (", (u64) threads, " threads)").data, ns, bench.count * threads);
+    }
+    
+    bench.count = 20000;
+    u64 ns = Measure(3, [&]() {
+        auto thread = StartThread(PongLoop, &bench);
+        for (u64 i = 0; i < bench.count; ++i) { Post(&bench.ping); Wait(&bench.pong); }
+        JoinThread(thread.value);
+    });
+    Report("Semaphore ping pong     ", ns, bench.count);
+    
+    bench.count = 4000000;
+    InitQueue(&bench.spsc, 1024, crtAllocator);
+    ns = Measure(3, [&]() {
+        bench.sum = 0;
+        auto thread = StartThread(SpscConsumer, &bench);
+        PushItems(&bench, &bench.spsc, bench.count);
+        JoinThread(thread.value);
+    });
+    NCZ_ASSERT(bench.sum == bench.count * (bench.count + 1) / 2);
+    Report("Spsc_Queue 1 -> 1       ", ns, bench.count);
+    Release(&bench.spsc);
+    
+    bench.count = 1000000;
+    InitQueue(&bench.mpmc, 1024, crtAllocator);
+    ns = Measure(3, [&]() {
+        bench.sum = 0;
+        Result<Thread> workers[4];
+        for (u32 i = 0; i < 2; ++i) workers[i] = StartThread(MpmcProducer, &bench);
+        for (u32 i = 2; i < 4; ++i) workers[i] = StartThread(MpmcConsumer, &bench);
+        for (u32 i = 0; i < 4; ++i) JoinThread(workers[i].value);
+    });
+    NCZ_ASSERT(bench.sum == bench.count * (bench.count + 1));
+    Report("Mpmc_Queue 2 -> 2       ", ns, 2 * bench.count);
+    Release(&bench.mpmc);
+}
+
+// what a zone costs, with the profiler off and on, and what collecting them at the end of a frame costs
+void BenchProfiler() {
+    constexpr const u32 FRAMES = 100, ZONES = 4000;
+    u64 zoneNs = 0, collectNs = 0;
+    auto frames = [&]() {
+        zoneNs = collectNs = 0;
+        for (u32 f = 0; f < FRAMES; ++f) {
+            u64 start = GetTimeNs();
+            for (u32 z = 0; z < ZONES / 2; ++z) {
+                NCZ_ZONE("outer");
+                NCZ_ZONE("inner");
+            }
+            u64 middle = GetTimeNs();
+            EndProfileFrame();
+            zoneNs    += middle - start;
+            collectNs += GetTimeNs() - middle;
+        }
+    };
+    frames();
+    Report("NCZ_ZONE, profiler off  ", zoneNs, FRAMES * ZONES);
+    
+    StartProfiler();
+    u64 bestZone = ~0ull, bestCollect = ~0ull;
+    for (u32 run = 0; run < 5; ++run) {
+        frames();
+        if (zoneNs < bestZone) bestZone = zoneNs;
+        if (collectNs < bestCollect) bestCollect = collectNs;
+    }
+    auto frame = GetProfileFrame();
+    NCZ_ASSERT(frame && frame->zones.count == ZONES && !frame->dropped);
+    Report("NCZ_ZONE                ", bestZone, FRAMES * ZONES);
+    Report("EndProfileFrame         ", bestCollect, FRAMES * ZONES);
+    StopProfiler();
+}
+
+// The ones below go through Bench, with the processor's counters where linux lets us have them
+
+// the memory of a frame: the pool that temporary storage is, against asking malloc for every piece
+void BenchAllocation() {
+    constexpr const u32 COUNT = 1000;
+    Bench_Options options {};
+    options.items = COUNT;
+    Pool pool = {32 * 1024, crtAllocator};
+    Get(&pool, 1); // the first block, so the mark we go back to points into it
+    Reset(&pool);
+    usize sizes[] = { 16, 256 };
+    for (usize size : sizes) {
+        Record(Bench(TPrint("Get ", static_cast<u64>(size), " B from a Pool").data, [&]() {
+            auto mark = pool.mark;
+            for (u32 i = 0; i < COUNT; ++i) static_cast<u8*>(Get(&pool, size))[0] = 1;
+            pool.mark = mark;
+        }, options));
+        Record(Bench(TPrint("Allocate + Dispose ", static_cast<u64>(size), " B").data, [&]() {
+            void *pieces[COUNT];
+            for (u32 i = 0; i < COUNT; ++i) static_cast<u8*>(pieces[i] = Allocate(size, crtAllocator))[0] = 1;
+            for (u32 i = 0; i < COUNT; ++i) Dispose(pieces[i], crtAllocator);
+        }, options));
+    }
+    // NOTE: Reset fills every block with 0xcd, so it costs as much as the pool ever grew to
+    Bench_Options once {};
+    Record(Bench("Get 256 KB + Reset", [&]() {
+        for (u32 i = 0; i < COUNT; ++i) Get(&pool, 256);
+        Reset(&pool);
+    }, once));
+    Release(&pool);
+}
+
+// growing lists: one item at a time from nothing, into room made up front, and in chunks
+void BenchLists() {
+    constexpr const u32 COUNT = 10000;
+    Bench_Options options {};
+    options.items = COUNT;
+    Record(Bench("Push, growing from empty", [&]() {
+        List<u32> xs {};
+        xs.allocator = NCZ_TEMP;
+        for (u32 i = 0; i < COUNT; ++i) Push(&xs, i);
+    }, options));
+    Record(Bench("Push after Reserve", [&]() {
+        List<u32> xs {};
+        xs.allocator = NCZ_TEMP;
+        Reserve(&xs, COUNT);
+        for (u32 i = 0; i < COUNT; ++i) Push(&xs, i);
+    }, options));
+    u32 chunk[100];
+    for (u32 i = 0; i < 100; ++i) chunk[i] = i;
+    Record(Bench("Extend by 100", [&]() {
+        List<u32> xs {};
+        xs.allocator = NCZ_TEMP;
+        for (u32 i = 0; i < COUNT / 100; ++i) Extend(&xs, Array<u32> { 100, chunk });
+    }, options));
+}
+
+// what logging and every TPrint do
+void BenchStringBuilder() {
+    constexpr const u32 COUNT = 1000;
+    Bench_Options options {};
+    options.items = COUNT;
+    Record(Bench("Print of a u64", [&]() {
+        String_Builder sb {};
+        sb.allocator = NCZ_TEMP;
+        for (u32 i = 0; i < COUNT; ++i) Print(&sb, static_cast<u64>(i) * 2654435761u);
+    }, options));
+    Record(Bench("Print of a negative s64", [&]() {
+        String_Builder sb {};
+        sb.allocator = NCZ_TEMP;
+        for (u32 i = 0; i < COUNT; ++i) Print(&sb, -static_cast<s64>(i) * 31);
+    }, options));
+    Record(Bench("Print of strings", [&]() {
+        String_Builder sb {};
+        sb.allocator = NCZ_TEMP;
+        for (u32 i = 0; i < COUNT; ++i) Print(&sb, "entity ", "player"_str, "\n");
+    }, options));
+    Record(Bench("Write one char at a time", [&]() {
+        String_Builder sb {};
+        sb.allocator = NCZ_TEMP;
+        for (u32 i = 0; i < COUNT; ++i) Push(&sb, static_cast<char>('a' + i % 26));
+    }, options));
+}
+
+// the walk of the tree BenchWalkFolder made, the way build.cpp scans SRC_DIR
+void BenchTraverseFolder() {
+    cstr root = BENCH_DIR NCZ_PATH_SEP "walk";
+    NCZ_ASSERT(MakeWalkTree(root));
+    u64 count = 0;
+    TraverseFolder(root, [&](String, File_Type) { count += 1; return true; });
+    Bench_Options options {};
+    options.items = count;
+    options.minRuns = 5;
+    Record(Bench("TraverseFolder", [&]() {
+        ClearFileInfoCache();
+        NCZ_ASSERT(TraverseFolder(root, [](String, File_Type) { return true; }));
+    }, options));
+}
+
+// a tick of the balls of main.cpp (integrate, bounce off the screen edges, collide with the paddle),
+// per ball, with as many balls as a couple of caches hold
+void BenchBalls() {
+    constexpr const u64 COUNTS[] = { 1000, 10000, 100000 };
+    for (u64 count : COUNTS) {
+        Balls balls {};
+        InitBalls(&balls, count, 18);
+        u32 seed = 1;
+        auto random = [&](f32 max) { seed = seed * 1664525 + 1013904223; return (seed >> 8) * (max / (1 << 24)); };
+        for (u64 i = 0; i < count; ++i) AddBall(&balls, 18 + random(1164), 18 + random(784), random(1800) - 900, random(1800) - 900);
+        
+        Bench_Options options {};
+        options.items = count;
+        auto result = Bench(TPrint("balls tick, ", count, " balls").data, [&]() {
+            RememberBalls(&balls);
+            IntegrateBalls(&balls, 1.0f / 60.0f);
+            BounceBalls(&balls, { 0, 0, 1200, 900 });
+            CollideBalls(&balls, { 540, 828, 120, 24 });
+        }, options);
+        Record(result);
+        char rate[32];
+        snprintf(rate, sizeof(rate), "%.0f", 1e6 / result.ns.median);
+        Log("    ", rate, " balls/ms");
+        Release(&balls.store);
+    }
+}
+
+// finding which of 10k moving circles touch, with a spatial grid and by testing every pair
+static int CompareGridPairs(const void *a, const void *b) {
+    auto x = static_cast<const Grid_Pair*>(a), y = static_cast<const Grid_Pair*>(b);
+    if (x->a != y->a) return x->a < y->a ? -1 : 1;
+    return x->b < y->b ? -1 : x->b > y->b;
+}
+
+void BenchBroadPhase() {
+    constexpr const u64 COUNT  = 10000;
+    constexpr const f32 RADIUS = 4;
+    constexpr const Ball_Box BOUNDS = { 0, 0, 2400, 1800 };
+    Balls balls {};
+    InitBalls(&balls, COUNT, RADIUS);
+    u32 seed = 1;
+    auto random = [&](f32 max) { seed = seed * 1664525 + 1013904223; return (seed >> 8) * (max / (1 << 24)); };
+    for (u64 i = 0; i < COUNT; ++i) AddBall(&balls, RADIUS + random(2392), RADIUS + random(1792), random(600) - 300, random(600) - 300);
+    
+    // NOTE: the narrow phase is what CheckCollisionCircles does, without raylib to link
+    auto touch = [&](u32 a, u32 b) {
+        f32 dx = balls.x[a] - balls.x[b], dy = balls.y[a] - balls.y[b];
+        return dx*dx + dy*dy <= (2 * RADIUS) * (2 * RADIUS);
+    };
+    Spatial_Grid grid {};
+    InitSpatialGrid(&grid, 2 * RADIUS);
+    List<Grid_Box>  boxes {};
+    List<Grid_Pair> pairs {};
+    Reserve(&boxes, COUNT);
+    boxes.count = COUNT;
+    auto gridTouching = [&]() {
+        for (u32 i = 0; i < COUNT; ++i) boxes.data[i] = { balls.x[i] - RADIUS, balls.y[i] - RADIUS, balls.x[i] + RADIUS, balls.y[i] + RADIUS };
+        BuildSpatialGrid(&grid, boxes);
+        pairs.count = 0;
+        FindGridPairs(&grid, &pairs);
+        u64 touching = 0;
+        for (usize i = 0; i < pairs.count; ++i) touching += touch(pairs.data[i].a, pairs.data[i].b);
+        return touching;
+    };
+    auto bruteTouching = [&]() {
+        u64 touching = 0;
+        for (u32 a = 0; a < COUNT; ++a) {
+            for (u32 b = a + 1; b < COUNT; ++b) touching += touch(a, b);
+        }
+        return touching;
+    };
+    auto move = [&]() {
+        IntegrateBalls(&balls, 1.0f / 60.0f);
+        BounceBalls(&balls, BOUNDS);
+    };
+    
+    // NOTE: the pairs themselves are compared, not how many there are, so a pair found twice cannot
+    // make up for one that was missed
+    u64 fromGrid = gridTouching(), found = pairs.count;
+    List<Grid_Pair> touching {}, expected {};
+    for (usize i = 0; i < pairs.count; ++i) if (touch(pairs.data[i].a, pairs.data[i].b)) Push(&touching, pairs.data[i]);
+    qsort(touching.data, touching.count, sizeof(Grid_Pair), CompareGridPairs);
+    for (u32 a = 0; a < COUNT; ++a) {
+        for (u32 b = a + 1; b < COUNT; ++b) if (touch(a, b)) Push(&expected, Grid_Pair { a, b });
+    }
+    if (touching.count != expected.count || memcmp(touching.data, expected.data, touching.count * sizeof(Grid_Pair)) != 0) {
+        LogError("the grid found ", touching.count, " touching circles, testing every pair ", expected.count, ", and they are not the same");
+        checksFailed = true;
+    }
+    Log("    ", fromGrid, " pairs of the ", COUNT, " circles touch, of ", found, " the grid found");
+    Dispose(touching.data, touching.allocator);
+    Dispose(expected.data, expected.allocator);
+    
+    Bench_Options options {};
+    options.items = COUNT;
+    // NOTE: both add up what they found, so the compiler cannot drop the work
+    found = 0;
+    auto grided = Bench("broad phase, spatial grid, 10000 circles", [&]() { move(); found += gridTouching(); }, options);
+    Record(grided);
+    auto brute  = Bench("broad phase, every pair, 10000 circles", [&]() { move(); found += bruteTouching(); }, options);
+    Record(brute);
+    char speedup[32];
+    snprintf(speedup, sizeof(speedup), "%.1f", brute.ns.median / grided.ns.median);
+    Log("    the grid is ", speedup, " times faster (", found, " touching in all runs)");
+    
+    Dispose(boxes.data, boxes.allocator);
+    Dispose(pairs.data, pairs.allocator);
+    Release(&grid);
+    Release(&balls.store);
+}
+
+#ifdef BENCH_RAYLIB
+// what loading and generating textures does on the cpu, per pixel (copying the image included)
+void BenchImages() {
+    constexpr const int SIZE = 1024;
+    rl::Image source = rl::GenImageGradientLinear(SIZE, SIZE, 45, rl::RED, rl::BLUE);
+    Bench_Options options {};
+    options.items = SIZE * SIZE;
+    Record(Bench("GenImageGradientLinear", [&]() { rl::UnloadImage(rl::GenImageGradientLinear(SIZE, SIZE, 45, rl::RED, rl::BLUE)); }, options));
+    Record(Bench("GenImagePerlinNoise", [&]() { rl::UnloadImage(rl::GenImagePerlinNoise(SIZE, SIZE, 0, 0, 4)); }, options));
+    Record(Bench("GenImageCellular", [&]() { rl::UnloadImage(rl::GenImageCellular(SIZE, SIZE, 64)); }, options));
+    Record(Bench("ImageFormat RGBA8 -> R5G6B5", [&]() {
+        rl::Image image = rl::ImageCopy(source);
+        rl::ImageFormat(&image, rl::PIXELFORMAT_UNCOMPRESSED_R5G6B5);
+        rl::UnloadImage(image);
+    }, options));
+    Record(Bench("ImageResize to half the size", [&]() {
+        rl::Image image = rl::ImageCopy(source);
+        rl::ImageResize(&image, SIZE / 2, SIZE / 2);
+        rl::UnloadImage(image);
+    }, options));
+    rl::Image sprite = rl::GenImageCellular(SIZE / 4, SIZE / 4, 16);
+    Record(Bench("ImageDraw a tinted quarter", [&]() {
+        rl::Image image = rl::ImageCopy(source);
+        for (int i = 0; i < 16; ++i) {
+            f32 x = static_cast<f32>(i % 4 * SIZE / 4), y = static_cast<f32>(i / 4 * SIZE / 4);
+            rl::ImageDraw(&image, sprite, { 0, 0, SIZE / 4, SIZE / 4 }, { x, y, SIZE / 4, SIZE / 4 }, rl::GRAY);
+        }
+        rl::UnloadImage(image);
+    }, options));
+    rl::UnloadImage(sprite);
+    
+    // NOTE: noise compresses about like the textures of a game do, a gradient far better
+    rl::Image noise = rl::GenImagePerlinNoise(SIZE / 2, SIZE / 2, 0, 0, 4);
+    int bytes = rl::GetPixelDataSize(noise.width, noise.height, noise.format);
+    Bench_Options perByte {};
+    perByte.items = static_cast<u64>(bytes);
+    Record(Bench("CompressData, per byte", [&]() {
+        int size = 0;
+        rl::MemFree(rl::CompressData(static_cast<u8*>(noise.data), bytes, &size));
+    }, perByte));
+    rl::UnloadImage(noise);
+    rl::UnloadImage(source);
+}
+
+// rasterizing the glyphs of a font, per glyph, from a font of the system (there is none in the repo)
+void BenchFonts() {
+    cstr fonts[] = {
+        "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+        "/System/Library/Fonts/Supplemental/Arial.ttf",
+        "C:/Windows/Fonts/arial.ttf",
+    };
+    cstr path = nullptr;
+    for (cstr font : fonts) if (!path && GetFileInfo(font).value.exists) path = font;
+    if (!path) {
+        Log("no font found, skipping LoadFontData");
+        return;
+    }
+    auto [file, ok] = ReadFile(path);
+    NCZ_ASSERT(ok);
+    constexpr const int GLYPHS = 95; // the ascii ones, what LoadFont does without codepoints
+    Bench_Options options {};
+    options.items = GLYPHS;
+    Record(Bench("LoadFontData 32px", [&]() {
+        rl::GlyphInfo *glyphs = rl::LoadFontData(reinterpret_cast<u8*>(file.data), static_cast<int>(file.count), 32, nullptr, GLYPHS, rl::FONT_DEFAULT);
+        rl::UnloadFontData(glyphs, GLYPHS);
+    }, options));
+}
+
+// raylib's collision checks of one shape against 10000, batched and one call at a time. The calls
+// one at a time are the reference, the masks of both have to be the same.
+void BenchCollisions() {
+    constexpr const int COUNT = 10000, ALL = 1000;
+    u32 seed = 1;
+    auto random = [&](f32 max) { seed = seed * 1664525 + 1013904223; return (seed >> 8) * (max / (1 << 24)); };
+    List<rl::Vector2>   centers {};
+    List<f32>           radii   {};
+    List<rl::Rectangle> recs    {};
+    for (int i = 0; i < COUNT; ++i) {
+        Push(&centers, rl::Vector2 { random(1200), random(900) });
+        Push(&radii, 2 + random(18));
+        Push(&recs, rl::Rectangle { random(1200), random(900), 4 + random(60), 4 + random(60) });
+    }
+    const rl::Rectangle rec = { 400, 300, 400, 300 };
+    const rl::Vector2 center = { 600, 450 };
+    const f32 radius = 150;
+    List<u32> mask {}, reference {};
+    Reserve(&mask, ALL * ((ALL + 31) / 32));
+    Reserve(&reference, ALL * ((ALL + 31) / 32));
+    
+    Bench_Options options {};
+    options.items = COUNT;
+    // checks the batched mask against the calls one at a time, then times both; the SIMD paths take
+    // 4 or 8 at a time, so every count up to 64 is checked too, to run what they leave over
+    auto compare = [&](cstr name, int count, auto words, auto batched, auto single) {
+        for (int n = 0; n <= count; n = n < 64? n + 1 : count) {
+            memset(mask.data, 0xff, words(n) * sizeof(u32));
+            int hits = batched(n);
+            memset(reference.data, 0, words(n) * sizeof(u32));
+            int expected = single(n, reference.data);
+            if (hits != expected || memcmp(mask.data, reference.data, words(n) * sizeof(u32)) != 0) {
+                LogError(name, " collides ", hits, " times batched and ", expected, " times one at a time, checking ", n);
+                checksFailed = true;
+            }
+            if (n == count) break;
+        }
+        Record(Bench(TPrint(name, ", one at a time").data, [&]() { single(count, reference.data); }, options));
+        Record(Bench(TPrint(name, ", batched").data, [&]() { batched(count); }, options));
+    };
+    auto words = [](int n) { return usize(n + 31) / 32; };
+    compare("CheckCollisionRecs", COUNT, words,
+        [&](int n) { return rl::CheckCollisionRecsBatch(rec, recs.data, n, mask.data); },
+        [&](int n, u32 *bits) {
+            int hits = 0;
+            for (int i = 0; i < n; ++i) if (rl::CheckCollisionRecs(rec, recs.data[i])) { bits[i / 32] |= 1u << i % 32; ++hits; }
+            return hits;
+        });
+    compare("CheckCollisionCircles", COUNT, words,
+        [&](int n) { return rl::CheckCollisionCirclesBatch(center, radius, centers.data, radii.data, n, mask.data); },
+        [&](int n, u32 *bits) {
+            int hits = 0;
+            for (int i = 0; i < n; ++i) if (rl::CheckCollisionCircles(center, radius, centers.data[i], radii.data[i])) { bits[i / 32] |= 1u << i % 32; ++hits; }
+            return hits;
+        });
+    compare("CheckCollisionCircleRec", COUNT, words,
+        [&](int n) { return rl::CheckCollisionCircleRecBatch(centers.data, 18, n, rec, mask.data); },
+        [&](int n, u32 *bits) {
+            int hits = 0;
+            for (int i = 0; i < n; ++i) if (rl::CheckCollisionCircleRec(centers.data[i], 18, rec)) { bits[i / 32] |= 1u << i % 32; ++hits; }
+            return hits;
+        });
+    compare("CheckCollisionPointRec", COUNT, words,
+        [&](int n) { return rl::CheckCollisionPointRecBatch(centers.data, n, rec, mask.data); },
+        [&](int n, u32 *bits) {
+            int hits = 0;
+            for (int i = 0; i < n; ++i) if (rl::CheckCollisionPointRec(centers.data[i], rec)) { bits[i / 32] |= 1u << i % 32; ++hits; }
+            return hits;
+        });
+    options.items = ALL * ALL;
+    compare("CheckCollisionRecs 1000 against 1000", ALL, [&](int n) { return usize(n) * words(n); },
+        [&](int n) { return rl::CheckCollisionRecsBatchAll(recs.data, n, recs.data + ALL, n, mask.data); },
+        [&](int n, u32 *bits) {
+            int hits = 0;
+            for (int i = 0; i < n; ++i) {
+                u32 *row = bits + i * words(n);
+                for (int j = 0; j < n; ++j) if (rl::CheckCollisionRecs(recs.data[i], recs.data[ALL + j])) { row[j / 32] |= 1u << j % 32; ++hits; }
+            }
+            return hits;
+        });
+    
+    Dispose(centers.data, centers.allocator);
+    Dispose(radii.data, radii.allocator);
+    Dispose(recs.data, recs.allocator);
+    Dispose(mask.data, mask.allocator);
+    Dispose(reference.data, reference.allocator);
+}
+
+// filling rlgl's vertex batch, which every shape raylib draws goes through, and generating meshes,
+// which upload themselves, so both need a window
+void BenchWindow() {
+    rl::SetConfigFlags(rl::FLAG_WINDOW_HIDDEN);
+    rl::InitWindow(64, 64, "bench");
+    if (!rl::IsWindowReady()) {
+        Log("no window, skipping rlgl and the meshes");
+        return;
+    }
+    constexpr const u32 TRIANGLES = 3000;
+    Bench_Options options {};
+    options.items = 3 * TRIANGLES;
+    Record(Bench("rlVertex3f + rlDrawRenderBatchActive", [&]() {
+        rl::rlBegin(RL_TRIANGLES);
+        for (u32 i = 0; i < TRIANGLES; ++i) {
+            float x = static_cast<float>(i % 64), y = static_cast<float>(i / 64);
+            rl::rlColor4ub(static_cast<u8>(i), 128, 255, 255);
+            rl::rlVertex3f(x, y, 0);
+            rl::rlVertex3f(x, y + 1, 0);
+            rl::rlVertex3f(x + 1, y, 0);
+        }
+        rl::rlEnd();
+        rl::rlDrawRenderBatchActive();
+    }, options));
+    
+    // per triangle, the upload included
+    rl::Mesh sphere = rl::GenMeshSphere(1, 64, 64);
+    options.items = static_cast<u64>(sphere.triangleCount);
+    Record(Bench("GenMeshSphere", [&]() { rl::UnloadMesh(rl::GenMeshSphere(1, 64, 64)); }, options));
+    rl::Image heights = rl::GenImagePerlinNoise(128, 128, 0, 0, 4);
+    rl::Mesh terrain = rl::GenMeshHeightmap(heights, { 16, 4, 16 });
+    options.items = static_cast<u64>(terrain.triangleCount);
+    Record(Bench("GenMeshHeightmap", [&]() { rl::UnloadMesh(rl::GenMeshHeightmap(heights, { 16, 4, 16 })); }, options));
+    rl::UnloadImage(heights);
+    
+    // a ray from above down onto the terrain and one through the sphere, per triangle tested
+    rl::Matrix identity { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    rl::Ray down    { { 8, 10, 8 }, { 0, -1, 0 } };
+    rl::Ray through { { -2, 0.1f, 0 }, { 1, 0, 0 } };
+    Record(Bench("GetRayCollisionMesh, terrain", [&]() { NCZ_ASSERT(rl::GetRayCollisionMesh(down, terrain, identity).hit); }, options));
+    options.items = static_cast<u64>(sphere.triangleCount);
+    Record(Bench("GetRayCollisionMesh, sphere", [&]() { NCZ_ASSERT(rl::GetRayCollisionMesh(through, sphere, identity).hit); }, options));
+    rl::UnloadMesh(terrain);
+    rl::UnloadMesh(sphere);
+    rl::CloseTheWindow();
+}
+#endif//BENCH_RAYLIB
+
+struct Bench_Group {
+    cstr name;
+    void (*proc)();
+};
+Bench_Group benchGroups[] = {
+    { "walk",       BenchWalkFolder     },
+    { "traverse",   BenchTraverseFolder },
+    { "embed",      BenchEmbed          },
+    { "package",    BenchPackage        },
+    { "read",       BenchReadFiles      },
+    { "tasks",      BenchTasks          },
+    { "sync",       BenchSync           },
+    { "profiler",   BenchProfiler       },
+    { "memory",     BenchAllocation     },
+    { "lists",      BenchLists          },
+    { "strings",    BenchStringBuilder  },
+    { "balls",      BenchBalls          },
+    { "broadphase", BenchBroadPhase     },
+#ifdef BENCH_RAYLIB
+    { "collisions", BenchCollisions     },
+    { "images",     BenchImages         },
+    { "fonts",      BenchFonts          },
+    { "window",     BenchWindow         },
+#endif//BENCH_RAYLIB
+};
+
+int main(int argc, cstr *argv) {
+    context.logger.label = "bench";
+#ifdef BENCH_RAYLIB
+    // NOTE: raylib exits on fatal errors (no window) unless it logs through us
+    rl::SetTraceLogCallback(RaylibTraceLogAdapter);
+    rl::SetTraceLogLevel(rl::LOG_WARNING);
+#endif//BENCH_RAYLIB
+    cstr json = nullptr, baseline = nullptr;
+    f64 threshold = 0.1;
+    List<cstr> names {};
+    for (int i = 1; i < argc; ++i) {
+        if      (strncmp(argv[i], "--json=", 7)      == 0) json     = argv[i] + 7;
+        else if (strncmp(argv[i], "--compare=", 10)  == 0) baseline = argv[i] + 10;
+        else if (strncmp(argv[i], "--threshold=", 12) == 0) threshold = strtod(argv[i] + 12, nullptr) / 100;
+        else if (argv[i][0] == '-') {
+            LogError("unknown flag ", argv[i]);
+            return 1;
+        }
+        else Push(&names, argv[i]);
+    }
+    for (cstr name : names) {
+        bool found = false;
+        for (auto &group : benchGroups) found = found || strcmp(group.name, name) == 0;
+        if (!found) {
+            LogError("there are no benchmarks called ", name);
+            return 1;
+        }
+    }
+    
+    for (auto &group : benchGroups) {
+        bool run = !names.count;
+        for (cstr name : names) run = run || strcmp(group.name, name) == 0;
+        if (run) group.proc();
+    }
+    if (checksFailed) {
+        LogError("some benchmarks got wrong answers, see above");
+        return 1;
+    }
+    
+    if (json && !WriteBenchResults(json, results)) return 1;
+    if (baseline) {
+        auto [base, ok] = ReadBenchResults(baseline);
+        if (!ok) return 1;
+        u32 slower = CompareBenchResults(base, results, threshold);
+        Log(slower, " of ", results.count, " benchmarks got slower than in ", baseline);
+        if (slower) return 1;
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include "math.h" // for fmodf
 #include "nczlib/ncz.hpp"
 #include "raylib/raylib.cpp"
+#include "balls.hpp"
 
 static const int FACTOR        = 300;
 static const int SCREEN_WIDTH  = 4 * FACTOR;
@@ -15,9 +16,25 @@ bool paused     = false;
 ncz::u64 frame  = 0;
 float hue_angle = 0;
 
-float       circle_radius = PADDLE_HEIGHT * 0.75f;
-rl::Vector2 circle_position { 100, 300 };
-rl::Vector2 circle_velocity { PADDLE_SPEED, PADDLE_SPEED };
+// --autoplay=N plays N frames on its own at a fixed 60 fps and quits,
+// build.cpp plays it like that to collect the pgo profile
+// NOTE: the headless build has no one to play it, so it always autoplays, HEADLESS_FRAMES by
+// default, as fast as it can, and prints where the ball ended up so runs can be compared
+ncz::u64 autoplay_frames = 0;
+#ifdef PLATFORM_HEADLESS
+static const ncz::u64 HEADLESS_FRAMES = 3600;
+#endif//PLATFORM_HEADLESS
+
+// F3 shows where the time of a frame goes, --profile=PATH writes the last couple of frames to
+// PATH as a chrome trace when the game quits (F4 writes them right away)
+bool      show_profile = false;
+ncz::cstr profile_path = nullptr;
+
+// --balls=N plays with N balls instead of one, the first one is where the one ball always starts,
+// the others start all over the screen (the same places every time)
+float      circle_radius = PADDLE_HEIGHT * 0.75f;
+ncz::u64   ball_count    = 1;
+Balls      balls {};
 
 float paddle_velocity = 0;
 rl::Rectangle paddle {
@@ -32,64 +49,59 @@ void Clamp(T* t, T min, T max) {
     else if (*t > max) *t = max;
 }
 
-void RunFrame() {
-    Reset(&ncz::context.temporaryStorage);
-    
-    frame += 1;
-    float dt = rl::GetFrameTime(), w = SCREEN_WIDTH, h = SCREEN_HEIGHT;
-    if (rl::IsKeyPressed(rl::KEY_SPACE)) paused = !paused;
-
-    if (!paused) {
-        // update paddle
-        paddle_velocity = 0;
-        if (rl::IsKeyDown(rl::KEY_RIGHT) || rl::IsKeyDown(rl::KEY_D)) paddle_velocity += PADDLE_SPEED;
-        if (rl::IsKeyDown(rl::KEY_LEFT)  || rl::IsKeyDown(rl::KEY_A)) paddle_velocity -= PADDLE_SPEED;
-        paddle.x += paddle_velocity * dt;
-        Clamp(&paddle.x, 0.0f, w - paddle.width);
-
-        // update ball
-        circle_position.x += circle_velocity.x * dt;
-        circle_position.y += circle_velocity.y * dt;
-        if (circle_position.x < circle_radius || circle_position.x > w - circle_radius) circle_velocity.x *= -1;
-        if (circle_position.y < circle_radius || circle_position.y > h - circle_radius) circle_velocity.y *= -1;
-        Clamp(&circle_position.x, circle_radius, w - circle_radius);
-        Clamp(&circle_position.y, circle_radius, h - circle_radius);
-
-        if (rl::CheckCollisionCircleRec(circle_position, circle_radius, paddle)) {
-            ncz::Log("DING! ", paddle);
-            if (circle_position.y < paddle.y
-            &&  circle_position.y > paddle.y - circle_radius) {
-                circle_position.y = paddle.y - circle_radius;
-                circle_velocity.y *= -1;
-            }
-            if (circle_position.x < paddle.x
-            &&  circle_position.x > paddle.x - circle_radius) {
-                circle_position.x = paddle.x - circle_radius;
-                circle_velocity.x *= -1;
-            }
-            if (circle_position.y > paddle.y + paddle.height
-            &&  circle_position.y < paddle.y + paddle.height + circle_radius) {
-                circle_position.y = paddle.y + paddle.height + circle_radius;
-                circle_velocity.y *= -1;
-            }
-            if (circle_position.x > paddle.x + paddle.width
-            &&  circle_position.x < paddle.x + paddle.width + circle_radius) {
-                circle_position.x = paddle.x + paddle.width + circle_radius;
-                circle_velocity.x *= -1;
-            }
-        }
-
-        hue_angle = fmodf(hue_angle + 10.0f * dt, 360.0f);
+// the simulation runs at a fixed 60 ticks a second whatever the refresh rate is, and the frames draw
+// the ball and the paddle between where the last two ticks left them (see ncz::Game_Loop)
+ncz::Game_Loop loop {};
+float previous_paddle_x = paddle.x;
+
+// what the frame read from the keyboard, for the ticks it runs
+bool left  = false;
+bool right = false;
+
+void SpawnBalls() {
+    InitBalls(&balls, ball_count, circle_radius);
+    AddBall(&balls, 100, 300, PADDLE_SPEED, PADDLE_SPEED);
+    ncz::u32 seed = 1;
+    auto random = [&](float max) { seed = seed * 1664525 + 1013904223; return (seed >> 8) * (max / (1 << 24)); };
+    for (ncz::u64 i = 1; i < ball_count; ++i) {
+        float x = circle_radius + random(SCREEN_WIDTH  - 2 * circle_radius);
+        float y = circle_radius + random(SCREEN_HEIGHT - 4 * PADDLE_HEIGHT);
+        AddBall(&balls, x, y, random(1) < 0.5f ? -PADDLE_SPEED : PADDLE_SPEED, random(1) < 0.5f ? -PADDLE_SPEED : PADDLE_SPEED);
     }
+}
+
+void Tick(ncz::f64 step) {
+    NCZ_ZONE("tick");
+    float dt = step, w = SCREEN_WIDTH, h = SCREEN_HEIGHT;
+    RememberBalls(&balls);
+    previous_paddle_x = paddle.x;
+    
+    // update paddle
+    paddle_velocity = 0;
+    if (right) paddle_velocity += PADDLE_SPEED;
+    if (left)  paddle_velocity -= PADDLE_SPEED;
+    paddle.x += paddle_velocity * dt;
+    Clamp(&paddle.x, 0.0f, w - paddle.width);
+
+    // update balls
+    IntegrateBalls(&balls, dt);
+    BounceBalls(&balls, { 0, 0, w, h });
+    if (CollideBalls(&balls, { paddle.x, paddle.y, paddle.width, paddle.height })) ncz::Log("DING! ", paddle);
+
+    hue_angle = fmodf(hue_angle + 10.0f * dt, 360.0f);
+}
 
-    // draw the scene
+void Draw(ncz::f64 alpha) {
+    NCZ_ZONE("draw");
+    float t = alpha;
     auto color = rl::ColorFromHSV(hue_angle, 1.0f, 1.0f);
     rl::BeginDrawing();
         rl::ClearBackground(rl::DARKGRAY);
 
-        auto stats = ncz::TPrint("ball:   ", circle_position, "\n\n\n",
+        auto stats = ncz::TPrint("ball:   ", rl::Vector2 { balls.x[0], balls.y[0] }, "\n\n\n",
                                  "paddle: ", paddle,          "\n\n\n",
-                                 "frame:  ", frame,           "\n\n\n");
+                                 "frame:  ", frame,           "\n\n\n",
+                                 "ticks:  ", loop.stats.ticks, "\n\n\n");
         rl::DrawSomeText(stats.data, SCREEN_WIDTH*0.025f, SCREEN_HEIGHT*0.05f, 30, color);
 
         if (paused) {
@@ -103,22 +115,102 @@ void RunFrame() {
             );
         }
 
-        rl::DrawCircleV(circle_position, circle_radius, color);
-        rl::DrawRectangleRec(paddle, color);
-    rl::EndDrawing();
+        rl::Rectangle drawn_paddle = paddle;
+        drawn_paddle.x = previous_paddle_x + (paddle.x - previous_paddle_x) * t;
+        for (ncz::usize i = 0; i < balls.store.count; ++i) {
+            rl::Vector2 position {
+                balls.previousX[i] + (balls.x[i] - balls.previousX[i]) * t,
+                balls.previousY[i] + (balls.y[i] - balls.previousY[i]) * t,
+            };
+            rl::DrawCircleV(position, circle_radius, color);
+        }
+        rl::DrawRectangleRec(drawn_paddle, color);
+        if (show_profile) ncz::DrawProfileOverlay({ 0, SCREEN_HEIGHT * 0.6f, SCREEN_WIDTH, SCREEN_HEIGHT * 0.4f });
+    {
+        // presents the frame, and waits for the screen to take it
+        NCZ_ZONE("EndDrawing");
+        rl::EndDrawing();
+    }
 }
 
-int main(void) {
+void RunFrame() {
+    // the frame before ends where this one starts
+    ncz::EndProfileFrame();
+    NCZ_ZONE("frame");
+    Reset(&ncz::context.temporaryStorage);
+    
+    frame += 1;
+    ncz::f64 seconds = rl::GetFrameTime();
+    bool pause = rl::IsKeyPressed(rl::KEY_SPACE);
+    left  = rl::IsKeyDown(rl::KEY_LEFT)  || rl::IsKeyDown(rl::KEY_A);
+    right = rl::IsKeyDown(rl::KEY_RIGHT) || rl::IsKeyDown(rl::KEY_D);
+    if (autoplay_frames) {
+        // chase the ball, and take a short break every ten seconds, one tick a frame
+        // NOTE: the break starts on frame 600, the first toggle on frame 30 would start a pause instead
+        seconds = loop.tick;
+        bool toggle = frame >= 600 && (frame % 600 == 0 || frame % 600 == 30);
+        #ifdef PLATFORM_HEADLESS
+        // the keys go through raylib like a player's, so they are seen a frame later
+        rl::SetHeadlessKey(rl::KEY_SPACE, toggle);
+        rl::SetHeadlessKey(rl::KEY_LEFT,  balls.x[0] < paddle.x);
+        rl::SetHeadlessKey(rl::KEY_RIGHT, balls.x[0] > paddle.x + paddle.width);
+        #else
+        pause = toggle;
+        left  = balls.x[0] < paddle.x;
+        right = balls.x[0] > paddle.x + paddle.width;
+        #endif//PLATFORM_HEADLESS
+    }
+    if (pause) paused = !paused;
+    if (rl::IsKeyPressed(rl::KEY_F3)) show_profile = !show_profile;
+    #ifndef PLATFORM_WEB
+    if (rl::IsKeyPressed(rl::KEY_F4)) ncz::WriteProfileTrace(profile_path ? profile_path : "profile.json");
+    #endif//PLATFORM_WEB
+
+    // NOTE: paused, no time passes for the simulation
+    ncz::RunGameLoopFrame(&loop, paused ? 0 : seconds, Tick, Draw);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--autoplay=", 11) == 0) autoplay_frames = strtoull(argv[i] + 11, nullptr, 10);
+        if (strncmp(argv[i], "--profile=", 10) == 0)  profile_path    = argv[i] + 10;
+        if (strncmp(argv[i], "--balls=", 8) == 0)     ball_count      = strtoull(argv[i] + 8, nullptr, 10);
+    }
+    if (!ball_count) ball_count = 1;
+    SpawnBalls();
     #ifndef PLATFORM_WEB // TODO: just add this functionality to raylib.js
     rl::SetTraceLogCallback(ncz::RaylibTraceLogAdapter);
+    rl::SetLoadFileDataCallback(ncz::RaylibLoadFileDataAdapter);
+    rl::SetUnloadFileDataCallback(ncz::RaylibUnloadFileDataAdapter);
     #endif//PLATFORM_WEB
+    #ifdef PLATFORM_HEADLESS
+    if (!autoplay_frames) autoplay_frames = HEADLESS_FRAMES;
+    rl::SetHeadlessFrameTime(1.0 / 60.0);
+    ncz::u64 start = ncz::GetTimeNs();
+    #endif//PLATFORM_HEADLESS
     rl::InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "wow wasm with raylib so cool");
+    ncz::StartProfiler();
     #ifdef  PLATFORM_WEB
     raylib_js_set_entry(RunFrame);
     #else
-    while (!rl::WindowShouldClose()) RunFrame();
+    while (!rl::WindowShouldClose() && (!autoplay_frames || frame < autoplay_frames)) RunFrame();
     rl::CloseTheWindow();
+    if (profile_path) ncz::WriteProfileTrace(profile_path);
     #endif//PLATFORM_WEB
+    #ifdef PLATFORM_HEADLESS
+    {
+        // NOTE: Write prints floats as integers, a replay has to match to the last bit
+        auto stats  = rl::GetHeadlessStats();
+        ncz::f64 seconds = (ncz::GetTimeNs() - start) / 1e9;
+        char fps[32], state[128];
+        snprintf(fps, sizeof(fps), "%.1f", stats.frames / seconds);
+        snprintf(state, sizeof(state), "ball (%a, %a) velocity (%a, %a) paddle %a",
+                 balls.x[0], balls.y[0], balls.vx[0], balls.vy[0], paddle.x);
+        ncz::Log(stats.frames, " frames, ", loop.stats.ticks, " ticks, ", fps, " frames/s, ", stats.drawCalls, " draw calls, ",
+                 stats.vertices, " vertices, ", stats.bufferBytes, " bytes uploaded");
+        ncz::Log(state);
+    }
+    #endif//PLATFORM_HEADLESS
     
     // ncz_context.hpp
     // Memory Primitives:
@@ -13,16 +13,51 @@
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #pragma comment(lib, "dbghelp")
+#pragma comment(lib, "ws2_32")
+#pragma comment(lib, "psapi")
+#pragma comment(lib, "synchronization")
 #pragma warning(disable : 4996)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
 #include <windows.h>
+#include <psapi.h>
 #include <direct.h>
 #include <shellapi.h>
 #include <dbghelp.h>
 #else // POSIX
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
 #include <dirent.h>
-#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <signal.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/futex.h>
+#include <linux/perf_event.h>
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#if !defined(NCZ_NO_IO_URING) && __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define NCZ_IO_URING
+#endif
+#endif//__linux__
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#endif
 #endif
 #endif//NCZ_NO_OS
 
@@ -38,8 +73,8 @@ namespace ncz {
 #define NCZ_PUSH_STATE(variable, value) NCZ__PUSH_STATE_((variable), (value), NCZ_GENSYM(_pushedVariable_))
 #define NCZ_SAVE_STATE(variable) NCZ__SAVE_STATE_((variable), NCZ_GENSYM(_savedVariable_))
 #define NCZ_STATIC_ARRAY_LITERAL(type, name, ...)            \
-static constexpr const type _name_##data[] = { __VA_ARGS__ }; \
-static constexpr const Array<type> name = { sizeof(_name_##data)/sizeof(_name_##data[0]), (type*)_name_##data }
+static constexpr const type _##name##_data[] = { __VA_ARGS__ }; \
+static constexpr const Array<type> name = { sizeof(_##name##_data)/sizeof(_##name##_data[0]), (type*)_##name##_data }
 
 // These are helper macros and should not be used
 #define NCZ__CONCAT_(x, y) x##y
@@ -74,6 +109,7 @@ String operator ""_str(cstr data, usize count);
 bool StringIsCstr(String str);
 cstr AsCstr(String str);
 cstr CopyCstr(cstr src);
+String CopyString(String src); // the copy is null terminated
 
 struct Source_Location { cstr file; s64 line; };
 
@@ -132,6 +168,7 @@ struct Pool {
 
 void *Get(Pool *p, usize numBytes);
 void  Reset(Pool *p);
+void  Release(Pool *p); // gives all blocks back to the block allocator
 void *PoolAllocatorProc(Allocator_Mode mode, usize size, usize oldSize, void* oldMemory, void* allocator_data);
 
 // Logger
@@ -176,6 +213,7 @@ struct Context {
     Logger    logger           = crtLogger;
     bool      handlingAssert   = false;
     Pool      temporaryStorage = {32 * 1024, crtAllocator};
+    cstr      jobLabel         = nullptr; // what the commands started by this thread are for, see StartJobTrace
 };
 
 extern thread_local Context context;
@@ -197,6 +235,8 @@ template <typename T, typename ... Args>
 void Append(List<T> *xs, Args ... args);
 template<typename T>
 void Extend(List<T> *xs, Array<T> ys);
+template<typename T>
+void Reserve(List<T> *xs, usize capacity); // grows xs until capacity items fit
 
 using String_Builder = List<char>;
 void Write(String_Builder *sb, s64 i);
@@ -204,6 +244,7 @@ void Write(String_Builder *sb, void *p);
 void Write(String_Builder *sb, String str);
 void Write(String_Builder *sb, cstr str);
 void Write(String_Builder *sb, Source_Location loc);
+void WriteBase64(String_Builder *sb, String data); // standard alphabet, padded with '='
 
 template <typename T>
 void Write(String_Builder *sb, Array<T> list);
@@ -228,8 +269,18 @@ void LogStackTrace(usize skip = 0);
 #define NCZ_CFLAGS NCZ_CSTD, "-Wall", "-Wextra", "-Wpedantic", "-Werror", "-g"
 #define NCZ_CC(binary_path, source_path) "clang", NCZ_CFLAGS, "-o", binary_path, source_path
 
+// The script only has to build fast, it runs for a moment and is rarely debugged
+// NOTE: no -Werror, a warning that only some compiler (version) has must not stop the build
+#ifndef NCZ_SCRIPT_CFLAGS
+#define NCZ_SCRIPT_CFLAGS NCZ_CSTD, "-Wall", "-Wextra", "-Wpedantic", "-O0"
+#endif//NCZ_SCRIPT_CFLAGS
+
 // stolen nob Go Rebuild Urself™ Technology
 // from: https://github.com/tsoding/musializer/blob/master/src/nob.h#L260
+// Rebuilds the running script when src or any header it includes changed (the compiler writes
+// them to <binary>.d) and replaces the process with the new binary (exec, on windows it waits
+// for it instead). The compiler is looked up once, in $CXX and then clang, clang++, g++ and c++
+// on the PATH, and remembered in <binary>.cc.
 #define NCZ_CPP_FILE_IS_SCRIPT(argc, argv) ::ncz::ReloadCppScript({static_cast<usize>((argc)), (argv)}, __FILE__);
 void ReloadCppScript(Array<cstr> args, cstr src);
 
@@ -241,32 +292,624 @@ using Process = u64;
 
 bool Wait(Process proc);
 bool Wait(Array<Process> proc);
-Result<Process> RunCommandAsync(Array<cstr> args, bool trace = true);
-bool RunCommandSync(Array<cstr> args, bool trace = true);
+bool Kill(Process proc); // terminates and reaps the process, whether it was still running or not
+// Waits until one of procs exits and sets *index to it (procs.count if waiting itself failed),
+// returns false if that process failed, just like Wait
+bool WaitAny(Array<Process> procs, usize *index);
+// With outputPath set, what the command prints (stdout and stderr) goes to that file instead of ours
+Result<Process> RunCommandAsync(Array<cstr> args, bool trace = true, cstr outputPath = nullptr);
+bool RunCommandSync(Array<cstr> args, bool trace = true, cstr outputPath = nullptr);
+// Sets an environment variable of this process (value nullptr removes it), commands that are
+// started afterwards inherit it
+bool SetEnvironment(cstr name, cstr value);
+// Where the running binary is, to run it again: argv0 is only a name when the shell found it on the PATH
+cstr GetProgramPath(cstr argv0);
 
 template <typename ... Args>
 bool RunCmd(Args ... args);
 
+// Job traces
+// Between StartJobTrace and WriteJobTrace every command that RunCommandAsync starts is recorded:
+// when it started and ended, its exit status, the most memory it used and context.jobLabel (build
+// graphs set that to the target, and record the steps they run in process as well). The trace is
+// a chrome trace (chrome://tracing, ui.perfetto.dev) with a row for every job that ran at the same
+// time, so a step that everything waits on shows up as one bar with empty rows next to it.
+void StartJobTrace();
+bool WriteJobTrace(cstr path); // also stops the recording
+
+// Time
+u64  GetTimeNs(); // monotonic, only useful for measuring durations
+void SleepNs(u64 ns);
+
+// Threads
+using Thread      = u64;
+using Thread_Proc = void (*)(void *data);
+
+Result<Thread> StartThread(Thread_Proc proc, void *data);
+bool JoinThread(Thread thread);
+u32  GetProcessorCount();
+
+// Synchronization
+// Everything that blocks spins for a moment first (NCZ_SPIN_COUNT rounds) and only then asks the
+// OS to put the thread to sleep: most waits are over long before a trip through the scheduler
+// would be. Sleeping is a futex on linux and WaitOnAddress on windows, elsewhere a waiter naps and
+// looks again. Nothing has to be created or destroyed, {} is ready to use (and never moves once used).
+#ifndef NCZ_SPIN_COUNT
+#define NCZ_SPIN_COUNT 64
+#endif//NCZ_SPIN_COUNT
+void CpuRelax(); // one round of spinning, tells the processor we are waiting
+// Sleeps while *address holds expected, it may also wake up for no reason
+void FutexWait(u32 *address, u32 expected);
+void FutexWakeOne(u32 *address);
+void FutexWakeAll(u32 *address);
+// Spins and then sleeps until *address does not hold expected anymore
+void WaitWhileEqual(u32 *address, u32 expected);
+
+struct Mutex {
+    u32 state = 0; // 0 unlocked, 1 locked, 2 locked and somebody might be asleep
+};
+void Lock(Mutex *mutex);
+bool TryLock(Mutex *mutex);
+void Unlock(Mutex *mutex);
+
+struct Condition {
+    u32 sequence = 0;
+};
+// Unlocks mutex, sleeps until a Signal or Broadcast and locks mutex again. It may also return
+// without one, check what you are waiting for in a loop.
+void Wait(Condition *condition, Mutex *mutex);
+void Signal(Condition *condition); // wakes one waiter
+void Broadcast(Condition *condition); // wakes all of them
+
+struct Semaphore {
+    u32 count   = 0;
+    u32 waiters = 0;
+};
+void Post(Semaphore *semaphore, u32 count = 1);
+void Wait(Semaphore *semaphore); // takes one, sleeps until there is one
+bool TryWait(Semaphore *semaphore);
+
+// Sleeps until something that lives elsewhere (a queue that is not empty) becomes true, without a
+// lock and without costing the side that makes it true more than a fence while nobody sleeps:
+//     u32 key = PrepareWait(&events);
+//     if (!condition) CommitWait(&events, key);
+// and on the other side, first make condition true and then Notify(&events). A Notify between
+// PrepareWait and CommitWait is not lost, CommitWait returns right away.
+struct Event_Count {
+    u32 state = 0; // the number of notifies so far << 1, the lowest bit is set while somebody waits
+};
+u32  PrepareWait(Event_Count *events);
+void CommitWait(Event_Count *events, u32 key);
+void Notify(Event_Count *events); // wakes all waiters
+
+// Queues
+// Bounded lock-free ring buffers to hand items from one thread to another. The capacity is fixed
+// (rounded up to a power of two): Push returns false when the queue is full and Pop returns false
+// when it is empty, use an Event_Count or a Semaphore next to it to sleep instead of polling.
+// Items are copied in and out, keep them small and plain: pointers, handles, indices.
+template <typename T>
+struct Spsc_Queue { // one thread pushes and one thread pops
+    T        *items     = nullptr;
+    u64       mask      = 0;
+    Allocator allocator = {};
+    u8        padding0[64];
+    u64       head       = 0; // the next item to pop, written by the consumer
+    u64       cachedTail = 0; // what the consumer last saw of tail
+    u8        padding1[64];
+    u64       tail       = 0; // where the next item goes, written by the producer
+    u64       cachedHead = 0; // what the producer last saw of head
+    u8        padding2[64];
+};
+
+template <typename T>
+struct Mpmc_Queue { // any number of threads push and pop
+    struct Cell {
+        u64 sequence; // tells whether the cell is free for the push or full for the pop at a position
+        T   item;
+    };
+    Cell     *cells     = nullptr;
+    u64       mask      = 0;
+    Allocator allocator = {};
+    u8        padding0[64];
+    u64       head = 0;
+    u8        padding1[64];
+    u64       tail = 0;
+    u8        padding2[64];
+};
+
+template <typename T>
+void InitQueue(Spsc_Queue<T> *queue, usize capacity, Allocator allocator = context.allocator);
+template <typename T>
+void InitQueue(Mpmc_Queue<T> *queue, usize capacity, Allocator allocator = context.allocator);
+template <typename T>
+void Release(Spsc_Queue<T> *queue);
+template <typename T>
+void Release(Mpmc_Queue<T> *queue);
+template <typename T>
+bool Push(Spsc_Queue<T> *queue, T item);
+template <typename T>
+bool Push(Mpmc_Queue<T> *queue, T item);
+template <typename T>
+bool Pop(Spsc_Queue<T> *queue, T *item);
+template <typename T>
+bool Pop(Mpmc_Queue<T> *queue, T *item);
+
+// Entities
+// A structure of arrays: every component is a column of its own and an entity is an index into all
+// of them. A system that only needs two components only streams those two columns through the
+// cache, and a loop over a column of floats is something the compiler vectorizes. The columns come
+// out of a Pool, aligned to a cache line, and hold capacity entities: they never move, so pointers
+// to them stay good until Release. RemoveEntity moves the last entity into the hole, so the
+// entities are always 0 to count-1, but they do not keep their order (or their index).
+#ifndef NCZ_ENTITY_COLUMNS
+#define NCZ_ENTITY_COLUMNS 16
+#endif//NCZ_ENTITY_COLUMNS
+
+struct Entity_Store {
+    struct Column {
+        u8   *data;
+        usize size; // of one component
+    };
+    usize  count    = 0;
+    usize  capacity = 0;
+    u32    columns  = 0;
+    Column column[NCZ_ENTITY_COLUMNS] = {};
+    Pool   pool     = {};
+};
+
+void InitEntityStore(Entity_Store *store, usize capacity, Allocator allocator = context.allocator);
+void Release(Entity_Store *store);
+// The column of a new component, all zero. Add them all before the first entity.
+template <typename T>
+T *AddColumn(Entity_Store *store);
+Result<usize> AddEntity(Entity_Store *store); // its components are zero, fails when the store is full
+void RemoveEntity(Entity_Store *store, usize index);
+
+// Broad phase
+// A uniform grid to find what might touch among many boxes without testing every pair. The plane
+// is cut into square cells of cellSize (about the size of the biggest box is best, a box is then
+// in at most 4 cells) and BuildSpatialGrid sorts the boxes by the cells they overlap with a
+// counting sort: count per cell, prefix sum, scatter, so everything in a cell is next to each
+// other in one array. That is O(n) and allocates nothing once the lists have grown, it is meant
+// to be built again every frame rather than updated. The cells are hashed into buckets, so the
+// plane has no bounds. FindGridPairs reports every pair of boxes that overlap exactly once, for
+// a narrow phase (CheckCollisionCircles, CheckCollisionCircleRec, ...) to check.
+struct Grid_Box {
+    f32 minX, minY, maxX, maxY;
+};
+
+struct Grid_Pair {
+    u32 a, b; // a < b, indices into the boxes
+};
+
+struct Spatial_Grid {
+    struct Entry {
+        s32 x, y; // the cell
+        u32 item;
+    };
+    f32             cellSize = 0;
+    Array<Grid_Box> boxes    = {}; // of the last build, not a copy
+    List<u32>       start    = {}; // where the entries of each bucket start, and where the last one ends
+    List<Entry>     entries  = {}; // by bucket
+};
+
+void InitSpatialGrid(Spatial_Grid *grid, f32 cellSize, Allocator allocator = context.allocator);
+void Release(Spatial_Grid *grid);
+void BuildSpatialGrid(Spatial_Grid *grid, Array<Grid_Box> boxes); // the boxes have to stay until FindGridPairs
+void FindGridPairs(Spatial_Grid *grid, List<Grid_Pair> *pairs);   // appends them
+
+// Profiling
+// NCZ_ZONE("name") measures the rest of the scope it is in. Zones nest, and every thread records
+// its zones into a lock-free queue that only it pushes to, so a zone costs two reads of the cycle
+// counter (rdtsc, cntvct on arm, GetTimeNs elsewhere) and a push. That measured 40-45 ns in a
+// virtual machine, where rdtsc alone takes ~22 ns, the push is a few. Nothing is recorded
+// before StartProfiler, and nothing is even compiled with NCZ_NO_PROFILER defined. Once a frame
+// EndProfileFrame collects what all threads recorded into a Profile_Frame, the last
+// NCZ_PROFILE_FRAMES of them are kept for GetProfileFrame and WriteProfileTrace.
+// NOTE: zone names are kept as they are, use string literals
+#ifndef NCZ_PROFILE_FRAMES
+#define NCZ_PROFILE_FRAMES 120
+#endif//NCZ_PROFILE_FRAMES
+#ifndef NCZ_PROFILE_BUFFER_SIZE
+#define NCZ_PROFILE_BUFFER_SIZE 8192 // zones a thread can record between two frames, more are dropped
+#endif//NCZ_PROFILE_BUFFER_SIZE
+
+struct Profile_Zone {
+    cstr name;
+    u64  start, end; // ns since StartProfiler
+    u32  thread;     // numbered in the order they recorded their first zone
+    u32  depth;      // how many zones of its thread it is inside of
+};
+
+struct Profile_Total {
+    cstr name;
+    u64  ns;    // all zones with this name together
+    u64  self;  // the same without the zones inside them
+    u32  count;
+};
+
+struct Profile_Frame {
+    u64 index;      // counts the EndProfileFrames
+    u64 start, end; // ns since StartProfiler, start is where the previous frame ended
+    u64 dropped;    // zones that did not fit into the buffers
+    List<Profile_Zone>  zones;  // by thread, then in the order they ended
+    List<Profile_Total> totals; // the most time first
+};
+
+struct Profile_Scope {
+    cstr name;
+    u64  start; // 0 when the profiler was off as the zone started
+    Profile_Scope(cstr name);
+    ~Profile_Scope();
+};
+#ifndef NCZ_NO_PROFILER
+#define NCZ_ZONE(name) ::ncz::Profile_Scope NCZ_GENSYM(_zone_) { name }
+#else
+#define NCZ_ZONE(name)
+#endif//NCZ_NO_PROFILER
+
+void StartProfiler(); // the calling thread is the one that ends the frames
+void StopProfiler();  // forgets the frames
+void EndProfileFrame();
+// back = 0 is the frame the last EndProfileFrame collected, nullptr when it is not kept (anymore)
+Profile_Frame *GetProfileFrame(u32 back = 0);
+// The frames that are kept, as a chrome trace (chrome://tracing, ui.perfetto.dev)
+bool WriteProfileTrace(cstr path);
+
+// Game loop
+// Runs the simulation at a fixed tick however often frames come: every frame adds its time to an
+// accumulator and runs as many whole ticks as fit, the rest carries over to the next frame. The
+// simulation then does the same at 30 and at 240 fps, and a slow frame can not make it take a
+// step so big that things go through each other. A frame ends somewhere between two ticks, alpha
+// says where (0 to 1), so drawing the state of the last two ticks blended by alpha moves smoothly
+// at any refresh rate, one tick behind. When the ticks can not keep up (they cost more than they
+// simulate, or a frame stalled) only maxTicks run per frame and the rest of the time is dropped:
+// the game slows down instead of spending longer and longer frames catching up.
+struct Game_Loop_Stats {
+    u64 ticks;      // run so far
+    u64 frames;
+    u64 droppedNs;  // simulated time dropped to stay within maxTicks
+    u32 frameTicks; // run in the last frame
+    u64 tickNs;     // what the ticks of the last frame took, all together
+    u64 renderNs;   // what the render of the last frame took
+};
+
+struct Game_Loop {
+    f64 tick        = 1.0 / 60.0; // seconds of simulation per tick
+    u32 maxTicks    = 5;          // per frame
+    f64 accumulator = 0;          // seconds that did not make a whole tick yet
+    f64 alpha       = 0;          // accumulator / tick as of the last render
+    Game_Loop_Stats stats {};
+};
+
+// Runs tick(loop->tick) as often as seconds (the time of the frame) allow, then render(alpha)
+template <typename Tick, typename Render> // Tick :: (f64 dt) -> void, Render :: (f64 alpha) -> void
+void RunGameLoopFrame(Game_Loop *loop, f64 seconds, Tick tick, Render render);
+
+// Benchmarks
+// Bench runs f over and over and reports what one run cost: the median and percentiles of the
+// time, and on linux also of what the processor counted while it ran (perf_event_open): cycles,
+// instructions, cache misses and branch misses. Those tell whether a change made the code do less
+// or wait less on memory, the time alone does not. Where the counters are not allowed
+// (kernel.perf_event_paranoid above 2, containers, other platforms) only the time is measured.
+// Runs that took more than NCZ_BENCH_OUTLIER_MADS median absolute deviations longer than the
+// median are thrown out first, those are the OS taking the processor away, not the code.
+// Everything f puts into temporary storage is gone after each run. Only the calling thread is
+// counted, work f hands to other threads only shows up in the time.
+#ifndef NCZ_BENCH_OUTLIER_MADS
+#define NCZ_BENCH_OUTLIER_MADS 5
+#endif//NCZ_BENCH_OUTLIER_MADS
+
+// What the counters said at one point, ReadPerfCounters before and after a region and subtract.
+// The counts are raw: when the processor has fewer counters than were asked for they take turns
+// and only count while running, so they are only scaled up once subtracted (by enabled / running
+// of the region, the ratio of the reads themselves does not say anything about it).
+struct Perf_Sample {
+    u64 ns;
+    u64 cycles, instructions, cacheMisses, branchMisses; // 0 when not counted
+    u64 enabled, running; // how long the counters were on and how long they actually counted, in ns
+};
+
+struct Perf_Counters {
+    s32 fds[4] = { -1, -1, -1, -1 }; // in the order of Perf_Sample, the first one that opened leads the group
+};
+bool OpenPerfCounters(Perf_Counters *counters); // false when nothing can be counted
+void ClosePerfCounters(Perf_Counters *counters);
+Perf_Sample ReadPerfCounters(Perf_Counters *counters);
+
+struct Bench_Options {
+    u32 warmup  = 2;         // runs that are not measured, to fill the caches
+    u32 minRuns = 10;
+    u32 maxRuns = 10000;
+    u64 minNs   = 200000000; // runs until the runs took this long (and there were minRuns)
+    u64 items   = 1;         // what one run does, the results are per item
+};
+
+struct Bench_Stat {
+    f64 min, median, p90, p99;
+};
+
+struct Bench_Result {
+    cstr name;
+    u64  items;
+    u32  runs;     // measured, the outliers included
+    u32  outliers; // thrown out
+    bool counted;  // the counters were there
+    Bench_Stat ns, cycles, instructions, cacheMisses, branchMisses; // per item
+};
+
+template <typename F> // F :: () -> void
+Bench_Result Bench(cstr name, F f, Bench_Options options = {});
+void Write(String_Builder *sb, Bench_Result result);
+
+// Results as a JSON array with one result per line, to keep a baseline around and compare later runs with
+bool WriteBenchResults(cstr path, Array<Bench_Result> results);
+Result<Array<Bench_Result>> ReadBenchResults(cstr path); // only reads what WriteBenchResults writes
+// Logs the results whose median got slower than the one of the same name in baseline by more than
+// threshold (0.1 is 10%), returns how many did
+u32 CompareBenchResults(Array<Bench_Result> baseline, Array<Bench_Result> results, f64 threshold = 0.1);
+
+// Tasks
+// A pool of threads that run tasks. Every thread has its own deque (Chase-Lev): it adds the tasks
+// it creates at the bottom and takes them from there (the newest ones, their data is still in its
+// cache), the others steal the oldest ones from the top when they run out of work. A task runs
+// with the allocator, logger and job label of whoever added it, except that the temporary storage
+// is the one of the thread that runs it. Work comes in batches: WaitForTasks waits for every task
+// and ends the batch, the memory of its tasks and everything they put in temporary storage is
+// gone once the next one starts. Results that have to stay go into memory the caller gave them.
+using Task_Proc  = void (*)(void *data);
+using Range_Proc = void (*)(void *data, usize begin, usize end);
+struct Task;
+struct Task_Worker;
+struct Task_Pool {
+    Task_Worker *workers    = nullptr;
+    u32          count      = 0; // worker 0 is the thread that started the pool
+    Event_Count  idle       = {}; // workers that found nothing to do sleep on it
+    bool         stopping   = false;
+    u64          queued     = 0; // tasks sitting in the deques
+    u64          unfinished = 0; // tasks of this batch
+    u64          batch      = 0;
+};
+bool StartTaskPool(Task_Pool *pool, u32 threads = 0); // 0 means one per processor
+void StopTaskPool(Task_Pool *pool); // waits for the tasks first
+// Adds a task that runs once every task in after has finished (nullptrs in after are ignored).
+// Tasks can only be added by the thread that started the pool and by the tasks themselves.
+Task *AddTask(Task_Pool *pool, Task_Proc proc, void *data, Array<Task*> after = {});
+// Runs tasks on this thread (not only task) until task finished
+void WaitForTask(Task_Pool *pool, Task *task);
+// Runs tasks on this thread until every task finished, which ends the batch. Only for the thread
+// that started the pool, and not from inside a task.
+void WaitForTasks(Task_Pool *pool);
+// Calls proc on pieces of [0, count) in parallel and returns once all of count is done. A piece is
+// split in halves (the thread keeps one and offers the other to thieves) until it is no bigger
+// than grain, which by default leaves about 8 pieces per thread for the load balancing. Called by
+// the thread that started the pool outside of a task, this is a whole batch (see WaitForTasks).
+void ParallelForRange(Task_Pool *pool, usize count, Range_Proc proc, void *data, usize grain = 0);
+// f(T &item) for every item, the index of an item is &item - items.data
+template <typename T, typename F>
+void ParallelFor(Task_Pool *pool, Array<T> items, F f, usize grain = 0);
+
+// Sockets
+// A connection to another process, on this machine or on another one. Addresses are either
+// "unix:<path>", a unix domain socket (ListenSocket creates the file and replaces a stale one), or
+// "tcp:<host>:<port>", where a listener can use * as the host to accept connections from anywhere.
+using Socket = u64;
+Result<Socket> ListenSocket(cstr address);
+Result<Socket> AcceptSocket(Socket listener); // blocks until someone connects
+Result<Socket> ConnectSocket(cstr address);
+bool SendAll(Socket socket, String data);
+bool ReceiveAll(Socket socket, String buffer); // fails if the other side hangs up before buffer is full
+void CloseSocket(Socket socket);
+
 // Working with files
+#ifdef _WIN32
+#define NCZ_PATH_SEP "\\"
+#else
+#define NCZ_PATH_SEP "/"
+#endif//_WIN32
+
+enum class File_Type { FILE, FOLDER, LINK, OTHER };
+struct File_Info {
+    bool      exists = false;
+    File_Type type   = File_Type::OTHER;
+    u64       size   = 0;
+    u64       mtime  = 0; // nanoseconds since the unix epoch
+};
+
+// File infos are cached for the lifetime of the program, so asking about the same path twice
+// only hits the file system once. A missing file is not an error, it just has exists == false.
+// If something outside of ncz changes a file you already asked about (like a compiler writing
+// its output) call ForgetFileInfo before asking again. The cache is not thread safe, call these
+// from one thread and use PrefetchFileInfo if you want the stat calls to happen in parallel.
+Result<File_Info> GetFileInfo(cstr path);
+bool PrefetchFileInfo(Array<cstr> paths, u32 threads = 1);
+void ForgetFileInfo(cstr path);
+void ClearFileInfoCache();
+
 bool NeedsUpdate(cstr outputPath, Array<cstr> inputPaths);
 bool NeedsUpdate(cstr outputPath, cstr inputPaths);
 bool RenameFile(cstr oldPath, cstr newPath);
+bool CreateFolder(cstr path); // also creates missing parents, it is fine if it already exists
 
-bool WriteFile(cstr path, String data);
+// By default a write goes straight to path: a crash or a full disk halfway through leaves a
+// truncated file behind, and anyone reading path meanwhile sees half of it. With atomic set the
+// data goes to a temporary file next to path that is renamed over path once it is complete, so
+// path always holds either the old or the new contents. durable also flushes the data (and the
+// rename) to the disk, so the new contents survive a power loss. That costs a few milliseconds
+// per file, only ask for it when losing the file is worse than waiting.
+struct Write_Options {
+    bool atomic  = false;
+    bool durable = false; // implies atomic
+};
+bool WriteFile(cstr path, String data, Write_Options options = {});
+// Writes all pieces one after the other with as few system calls as possible (writev),
+// without concatenating them first
+bool WriteFile(cstr path, Array<String> pieces, Write_Options options = {});
 bool ReadFile(String_Builder *stream, cstr path);
 Result<String> ReadFile(cstr path);
+// Maps path into memory instead of copying it into the heap: pages are read in by the OS as they
+// are touched (reading ahead, we tell it we go front to back) and the String stays valid until
+// Unmap. The pages are read only, unless copyOnWrite is set: then they are writable, but writes
+// stay private to this process. An empty file maps to an empty String.
+Result<String> MapFile(cstr path, bool copyOnWrite = false);
+void Unmap(String mapped);
 
-enum class File_Type { FILE, FOLDER, LINK, OTHER };
 Result<Array<cstr>> ReadFolder(cstr parent);
 Result<File_Type> GetFileType(cstr path);
+
+// Streams
+// A Stream writes a file through a buffer of NCZ_STREAM_BUFFER_SIZE bytes, and applies its encoding
+// chunk by chunk as the data goes through, so writing a file of any size takes the same memory.
+// Whole files can be copied into a stream without passing through user space (copy_file_range or
+// sendfile on linux) as long as there is no encoding. After the first error the stream stops
+// writing and CloseStream returns false, so you only have to check that.
+enum class Stream_Encoding { NONE, BASE64 };
+struct Stream {
+    s64             handle   = -1;
+    cstr            path     = nullptr;
+    String_Builder  buffer   = {};
+    Stream_Encoding encoding = Stream_Encoding::NONE;
+    u8              carry[3] = {}; // bytes that are waiting for the rest of their base64 group
+    u32             carried  = 0;
+    u64             written  = 0;  // bytes that went into the file, after encoding
+    bool            ok       = false;
+    Write_Options   options  = {};
+    cstr            tempPath = nullptr; // where an atomic stream writes until CloseStream renames it
+};
+// Creates or truncates path. An atomic stream only replaces path when CloseStream succeeds,
+// on any error path is left as it was.
+bool OpenStream(Stream *stream, cstr path, Write_Options options = {});
+void Write(Stream *stream, String data);
+void Write(Stream *stream, cstr data);
+void SetEncoding(Stream *stream, Stream_Encoding encoding); // finishes the previous encoding (padding)
+bool CopyFileToStream(Stream *stream, cstr path);
+bool CloseStream(Stream *stream);
+
+// Bulk file I/O
+// Stats and reads a whole batch of files at once. On linux the batch goes through io_uring: the
+// statx, open, read and close calls for all files are submitted together, phase by phase, so the
+// kernel works on many files at the same time and we make a handful of system calls instead of
+// four per file. Where io_uring is not there (old kernels, containers that forbid it, other
+// platforms) the batch is split over threads making the plain calls. The contents go into the
+// request's buffer if it is big enough, otherwise into memory from the context allocator, which is
+// only used from the calling thread. Only regular files are read. The infos also go into the file
+// info cache. Returns false if any request failed (those log their error and are not ok), the rest
+// of the batch is still done.
+struct File_Request {
+    cstr      path   = nullptr;
+    bool      read   = true;  // false only stats the file
+    String    buffer = {};    // optional
+    File_Info info   = {};    // a missing file has exists == false, which is not an error
+    String    data   = {};    // the contents, points into buffer if it was used
+    bool      ok     = false;
+};
+struct File_Batch_Options {
+    u32  threads   = 0;    // for the fallback, 0 means one per processor
+    bool allowRing = true; // false always takes the fallback, mostly for comparing the two
+};
+bool ReadFiles(Array<File_Request> requests, File_Batch_Options options = {});
 // template <typename F> // F :: (String path, File_Type type) -> bool 
 template <typename F> bool TraverseFolder(cstr path, F visitProc);
 
+// Globs support `*` (anything except a path separator), `**` (anything) and `?` (one character).
+// A pattern without any separator is matched against the last component of the path only,
+// so "*.o" matches "a/b/c.o" while "a/*.o" only matches object files directly inside "a".
+bool MatchGlob(String pattern, String path);
+
+struct Walk_Options {
+    Array<cstr> include = {}; // only report entries matching one of these, empty means everything
+    Array<cstr> exclude = {}; // skip entries matching one of these, excluded folders are not entered
+    u32         threads = 1;  // folders are handed out to idle threads, the order of entries is then random
+};
+struct Walk_Entry {
+    String    path = {}; // path.data is null terminated and starts with the root you passed in
+    File_Type type = File_Type::OTHER;
+};
+// Recursively lists everything under root. Globs are matched against paths relative to root.
+// Links are reported as File_Type::LINK and are not followed.
+Result<Array<Walk_Entry>> WalkFolder(cstr root, Walk_Options options = {});
+
+// Watching files
+// On linux this is inotify, everywhere else we poll the modification times of the watched trees.
+struct File_Watcher {
+    s64        handle  = -1; // the inotify descriptor
+    List<cstr> roots   = {};
+    List<cstr> folders = {}; // inotify: watched folders indexed by watch descriptor
+    List<cstr> files   = {}; // polling: every file we saw last time and its modification time
+    List<u64>  mtimes  = {};
+};
+bool WatchFolder(File_Watcher *watcher, cstr path); // watches everything under path, recursively
+// Blocks until something changes, then keeps collecting changes until nothing has happened for
+// debounceMs, so a burst of saves turns into a single rebuild. The changed paths are forgotten by
+// the file info cache and returned with the context allocator.
+Result<Array<cstr>> WaitForChanges(File_Watcher *watcher, u64 debounceMs = 100);
+
+// Build graphs
+// A target turns its inputs into its outputs by running a command, or by calling proc for steps
+// that are simpler to do in process (procs run one at a time on the thread that runs the graph).
+// A target that has an output of another target as an input depends on it, deps is for
+// dependencies that do not go through files. A target only runs if one of its outputs is missing
+// or older than one of its inputs, targets without outputs always run.
+using Build_Proc = bool (*)(void *data);
+struct Build_Target {
+    cstr       name    = nullptr;
+    List<cstr> inputs  = {};
+    List<cstr> outputs = {};
+    List<cstr> command = {};
+    Build_Proc proc    = nullptr;
+    void      *data    = nullptr;
+    List<Build_Target*> deps = {};
+    u64        cost    = 1;     // a rough estimate of how long it takes, in whatever unit you like
+    bool       ran     = false; // set by RunBuildGraph
+    
+    // used by RunBuildGraph
+    List<Build_Target*> dependents = {};
+    u32 waitingFor = 0;
+    u64 priority   = 0;
+};
+struct Build_Graph {
+    List<Build_Target*> targets = {};
+};
+Build_Target *AddTarget(Build_Graph *graph, cstr name); // allocated with the context allocator
+// Runs the targets that are out of date, up to jobs commands at a time (0 means one per processor).
+// When several targets are ready, the one with the most cost left on its way to the end of the
+// build starts first, so the longest chain is never stuck behind something that could have waited.
+bool RunBuildGraph(Build_Graph *graph, u32 jobs = 0);
+
+#ifndef NCZ_NO_CC
+// Remote compiles
+// A compile (clang or gcc with -c <source> -o <object>) can run on a worker process, here or on
+// another machine. The source is preprocessed locally, so the worker needs none of our headers:
+// includes are expanded but macros are not (clang -frewrite-includes, gcc -fdirectives-only),
+// which keeps the warnings the same as for a local compile. The object and whatever the compiler
+// printed come back over the socket. Results are cached by a hash of the worker's compiler (what
+// its --version says), the flags and the preprocessed source, so recompiling the same code (a
+// touched file, switching branches back and forth) only asks a worker which compiler it has.
+struct Remote_Compile_Options {
+    // the job goes to the worker its hash picks and moves on to the next one if that one can not
+    // be reached, when none of them can it is compiled locally
+    Array<cstr> workers  = {};
+    cstr        cacheDir = nullptr; // nullptr means no cache
+};
+// One source, -c and -o, and nothing that reads or writes local files besides them (depfiles,
+// time traces, precompiled headers, pgo profiles) or builds for the machine it runs on (-march=native)
+bool CanCompileRemotely(Array<cstr> command);
+bool CompileRemotely(Array<cstr> command, Remote_Compile_Options options);
+// Serves CompileRemotely on address, threads jobs at a time (0 means one per processor), until the
+// process is killed. The jobs' files are kept in workDir while they compile.
+// NOTE: a worker runs compilers with flags that anyone who connects chooses, only listen where
+// you trust everyone who can connect.
+bool ServeCompiles(cstr address, cstr workDir, u32 threads = 0);
+#endif//NCZ_NO_CC
+
 
 }// namespace ncz
 #endif//NCZ_HPP_
 
-#ifdef NCZ_IMPLEMENTATION
+// NOTE: the implementation can be included twice in the same file, e.g. once through a
+// precompiled header and once more by the file itself
+#if defined(NCZ_IMPLEMENTATION) && !defined(NCZ_IMPLEMENTATION_)
+#define NCZ_IMPLEMENTATION_
 namespace ncz {
 thread_local Context context {};
 Logger    crtLogger    { CrtLoggerProc,    nullptr, nullptr };
@@ -287,6 +930,8 @@ void *Get(Pool *p, usize numBytes) {
         *p->blocks = nullptr;
         p->mark    = { p->blocks, 0 };
     }
+    // NOTE: a mark saved before the first allocation points nowhere, it means the start
+    if (!p->mark.block) p->mark = { p->blocks, 0 };
 
     if (numBytes < p->blockSize) {
         u8* currentBlock     = ((u8*)p->mark.block)+sizeof(void*);
@@ -321,9 +966,12 @@ void *Get(Pool *p, usize numBytes) {
 
 void Reset(Pool *p) {
     p->mark = {p->blocks, 0};
-    for (void** block = p->oversized; block != nullptr; block = (void**)*block) {
+    for (void** block = p->oversized; block != nullptr;) {
+        void** next = (void**)*block;
         Dispose(block, p->blockAllocator);
+        block = next;
     }
+    p->oversized = nullptr;
     
     // TODO: parameter for this?
     for (void** block = p->blocks; block != nullptr; block = (void**)*block) {
@@ -331,6 +979,22 @@ void Reset(Pool *p) {
     }
 }
 
+void Release(Pool *p) {
+    for (void** block = p->oversized; block != nullptr;) {
+        void** next = (void**)*block;
+        Dispose(block, p->blockAllocator);
+        block = next;
+    }
+    for (void** block = p->blocks; block != nullptr;) {
+        void** next = (void**)*block;
+        Dispose(block, p->blockAllocator);
+        block = next;
+    }
+    p->blocks    = nullptr;
+    p->oversized = nullptr;
+    p->mark      = {};
+}
+
 void *PoolAllocatorProc(Allocator_Mode mode, usize size, usize oldSize, void* oldMemory, void* allocatorData) {
     auto pool = static_cast<Pool*>(allocatorData);
     NCZ_ASSERT(pool != nullptr);
@@ -362,11 +1026,54 @@ cstr CopyCstr(cstr src) {
     return dst;
 }
 
+static bool IsPathSep(char c) { return c == '/' || c == '\\'; }
+
+static bool MatchGlobAt(cstr p, cstr pe, cstr t, cstr te) {
+    while (p < pe) {
+        if (*p == '*') {
+            bool any = p + 1 < pe && p[1] == '*';
+            p += any ? 2 : 1;
+            // "**/" is also allowed to match no folders at all
+            if (any && p < pe && IsPathSep(*p) && MatchGlobAt(p + 1, pe, t, te)) return true;
+            for (cstr rest = t;; ++rest) {
+                if (MatchGlobAt(p, pe, rest, te)) return true;
+                if (rest == te || (!any && IsPathSep(*rest))) return false;
+            }
+        }
+        if (t == te) return false;
+        if (*p == '?') {
+            if (IsPathSep(*t)) return false;
+        } else if (*p != *t && !(IsPathSep(*p) && IsPathSep(*t))) {
+            return false;
+        }
+        ++p; ++t;
+    }
+    return t == te;
+}
+
+bool MatchGlob(String pattern, String path) {
+    bool hasSep = false;
+    for (char c : pattern) hasSep = hasSep || IsPathSep(c);
+    if (!hasSep) {
+        usize base = path.count;
+        while (base > 0 && !IsPathSep(path.data[base-1])) --base;
+        path = { path.count - base, path.data + base };
+    }
+    return MatchGlobAt(pattern.data, pattern.data + pattern.count, path.data, path.data + path.count);
+}
+
+String CopyString(String src) {
+    auto dst = static_cast<char*>(Allocate(src.count+1));
+    memcpy(dst, src.data, src.count);
+    dst[src.count] = 0;
+    return {src.count, dst};
+}
+
 template <typename ...Args>
 void LogEx(Log_Level level, Log_Type type, Args... args) {
     // TODO: this could work if Pool had a constructor
     // NCZ_SAVE_STATE(context.temporaryStorage.mark);
-    String_Builder sb {}; memset(&sb, 0, sizeof(String_Builder));
+    String_Builder sb {};
     sb.allocator = NCZ_TEMP;
     if (context.logger.label) {
         Push(&sb, '[');
@@ -445,9 +1152,11 @@ void *CrtAllocatorProc(Allocator_Mode mode, usize size, usize oldSize, void* old
 }
 
 template<typename T> static
-void Grow(List<T> *xs) {
+void Grow(List<T> *xs, usize capacity = 0) {
     if (!xs->allocator.proc) xs->allocator = context.allocator;
     usize new_capacity = xs->data ? 2 * xs->capacity : 256;
+    // NOTE: the capacity doubling would reach, but with one reallocation instead of one per doubling
+    while (new_capacity < capacity) new_capacity *= 2;
     xs->data = static_cast<T*>(
         Resize(xs->data, new_capacity*sizeof(T), xs->capacity*sizeof(T), xs->allocator)
     );
@@ -467,11 +1176,16 @@ void Append(List<T> *xs, Args ... args) { (Push(xs, args), ...); }
 
 template<typename T>
 void Extend(List<T> *xs, Array<T> ys) {
-    while (xs->count+ys.count >= xs->capacity) Grow(xs);
+    if (xs->count+ys.count >= xs->capacity) Grow(xs, xs->count+ys.count+1);
     memcpy(xs->data+xs->count, ys.data, ys.count*sizeof(T));
     xs->count += ys.count;
 }
 
+template<typename T>
+void Reserve(List<T> *xs, usize capacity) {
+    if (xs->capacity < capacity) Grow(xs, capacity);
+}
+
 void Write(String_Builder *sb, s64 i) {
     constexpr const auto MAX_LEN = 32;
     char buf[MAX_LEN];
@@ -492,6 +1206,32 @@ void Write(String_Builder *sb, Source_Location loc) {
     Write(sb, loc.line);
     Push(sb, ':');
 }
+void WriteBase64(String_Builder *sb, String data) {
+    static constexpr const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    Reserve(sb, sb->count + (data.count + 2) / 3 * 4);
+    auto  in  = reinterpret_cast<const u8*>(data.data);
+    char *out = sb->data + sb->count;
+    usize i = 0;
+    for (; i + 3 <= data.count; i += 3) {
+        u32 bits = static_cast<u32>(in[i]) << 16 | static_cast<u32>(in[i + 1]) << 8 | in[i + 2];
+        out[0] = table[bits >> 18];
+        out[1] = table[bits >> 12 & 63];
+        out[2] = table[bits >>  6 & 63];
+        out[3] = table[bits       & 63];
+        out += 4;
+    }
+    if (i < data.count) {
+        u32 bits = static_cast<u32>(in[i]) << 16;
+        if (i + 1 < data.count) bits |= static_cast<u32>(in[i + 1]) << 8;
+        out[0] = table[bits >> 18];
+        out[1] = table[bits >> 12 & 63];
+        out[2] = i + 1 < data.count ? table[bits >> 6 & 63] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    sb->count = static_cast<usize>(out - sb->data);
+}
+
 template <typename T>
 void Write(String_Builder *sb, Array<T> xs) {
     Push(sb, '[');
@@ -532,21 +1272,6 @@ void HandleFailedAssertion(cstr repr, Source_Location loc) {
     exit(1);
 }
 
-#ifndef NCZ_NO_CC
-void ReloadCppScript(Array<cstr> args, cstr src) {
-    if (NeedsUpdate(args[0], src)) {
-        cstr old = TPrint(args[0], ".old").data;
-        if (!RenameFile(args[0], old)) exit(1);
-        if (!RunCmd(NCZ_CC(args[0], src))) {
-            RenameFile(old, args[0]);
-            exit(1);
-        }
-        if (!RunCommandSync(args)) exit(1);
-        exit(0);
-    }
-}
-#endif//NCZ_NO_CC
-
 // This library supports Windows and Posix systems. If you want to use this library on a different platform
 // #define NCZ_NO_OS and implement any procedures that you use
 template <typename... Args>
@@ -557,12 +1282,146 @@ bool RunCmd(Args ...args) {
     return RunCommandSync(cmd);
 }
 
-bool RunCommandSync(Array<cstr> args, bool trace) {
-    auto [proc, ok] = RunCommandAsync(args, trace);
+bool RunCommandSync(Array<cstr> args, bool trace, cstr outputPath) {
+    auto [proc, ok] = RunCommandAsync(args, trace, outputPath);
     if (!ok) return false;
     return Wait(proc);
 }
 
+// Job traces
+// NOTE: RunCommandAsync can be called from any thread (compile workers do), the records are
+// behind a mutex, that is held for a Push at most
+struct Job_Record {
+    cstr    label;
+    cstr    command; // nullptr for a step that ran in process
+    Process proc;
+    u64     start, end;
+    s64     status;  // the exit code, or minus the signal that killed it
+    u64     peakRss; // bytes, 0 when we could not find out
+    bool    done;
+};
+static bool             jobTraceOn    = false;
+static Mutex            jobTraceLock  = {};
+static u64              jobTraceStart = 0;
+static List<Job_Record> jobRecords    = {};
+
+
+void StartJobTrace() {
+    Lock(&jobTraceLock);
+    for (auto &record : jobRecords) {
+        Dispose(const_cast<char*>(record.label), crtAllocator);
+        Dispose(const_cast<char*>(record.command), crtAllocator);
+    }
+    jobRecords.count     = 0;
+    jobRecords.allocator = crtAllocator;
+    jobTraceStart = GetTimeNs();
+    jobTraceOn    = true;
+    Unlock(&jobTraceLock);
+}
+
+// Returns the index of the record, or -1 when nothing is recorded
+static s64 RecordJobStart(Process proc, Array<cstr> args) {
+    if (!__atomic_load_n(&jobTraceOn, __ATOMIC_RELAXED)) return -1;
+    NCZ_PUSH_STATE(context.allocator, crtAllocator);
+    cstr label   = context.jobLabel ? CopyCstr(context.jobLabel) : nullptr;
+    cstr command = nullptr;
+    if (args.count) {
+        String_Builder line {};
+        for (usize i = 0; i < args.count; ++i) Print(&line, i ? " " : "", args.data[i]);
+        Push(&line, '\0');
+        command = line.data;
+    }
+    Lock(&jobTraceLock);
+    s64 index = static_cast<s64>(jobRecords.count);
+    Push(&jobRecords, Job_Record { label, command, proc, GetTimeNs(), 0, 0, 0, false });
+    Unlock(&jobTraceLock);
+    return index;
+}
+
+static void RecordJobEnd(s64 index, s64 status, u64 peakRss) {
+    if (index < 0) return;
+    Lock(&jobTraceLock);
+    if (static_cast<usize>(index) < jobRecords.count && !jobRecords[index].done) {
+        auto &record = jobRecords[index];
+        record = { record.label, record.command, record.proc, record.start, GetTimeNs(), status, peakRss, true };
+    }
+    Unlock(&jobTraceLock);
+}
+
+// NOTE: process ids are reused once reaped, but only by processes that started after, so the
+// newest unfinished record with the id is the one
+static void RecordProcessEnd(Process proc, s64 status, u64 peakRss) {
+    if (!__atomic_load_n(&jobTraceOn, __ATOMIC_RELAXED)) return;
+    Lock(&jobTraceLock);
+    s64 index = -1;
+    for (usize i = jobRecords.count; i-- > 0;) {
+        if (jobRecords[i].proc == proc && !jobRecords[i].done) { index = static_cast<s64>(i); break; }
+    }
+    Unlock(&jobTraceLock);
+    RecordJobEnd(index, status, peakRss);
+}
+
+// The events of a chrome trace are one json array, the comma goes before every event but the first
+static void StartTraceEvent(String_Builder *out, usize *events) {
+    if ((*events)++) Write(out, ",\n");
+}
+
+static void WriteJsonString(String_Builder *out, cstr text) {
+    Push(out, '"');
+    for (cstr c = text; *c; ++c) {
+        if      (*c == '"' || *c == '\\') { Push(out, '\\'); Push(out, *c); }
+        else if (*c == '\n') Write(out, "\\n");
+        else if (static_cast<u8>(*c) < 0x20) Push(out, ' ');
+        else Push(out, *c);
+    }
+    Push(out, '"');
+}
+
+bool WriteJobTrace(cstr path) {
+    Lock(&jobTraceLock);
+    jobTraceOn = false;
+    Unlock(&jobTraceLock);
+    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+    
+    // NOTE: the records are in the order they started, every one goes on the first row that is
+    // free by then, so a row never has two jobs at once and the number of rows is how many ran
+    // at the same time. Commands a step ran go on the row of the step, nested under it.
+    u64 now = GetTimeNs();
+    struct Row { u64 end; bool step; };
+    List<Row> rows {};
+    String_Builder out {};
+    usize events = 0;
+    Write(&out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (auto &record : jobRecords) {
+        u64 end = record.done ? record.end : now;
+        usize row = 0;
+        while (row < rows.count && !(rows[row].step && rows[row].end >= end) && rows[row].end > record.start) row += 1;
+        if (row == rows.count) {
+            Push(&rows, Row {});
+            StartTraceEvent(&out, &events);
+            Print(&out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":", static_cast<u64>(row),
+                        ",\"args\":{\"name\":\"job ", static_cast<u64>(row), "\"}}");
+        }
+        if (!(rows[row].step && rows[row].end >= end)) rows[row] = { end, !record.command };
+        
+        StartTraceEvent(&out, &events);
+        Write(&out, "{\"name\":");
+        WriteJsonString(&out, record.label ? record.label : record.command);
+        Print(&out, ",\"cat\":\"", record.command ? "command" : "step", "\",\"ph\":\"X\",\"pid\":1,\"tid\":", static_cast<u64>(row),
+                    ",\"ts\":", (record.start - jobTraceStart) / 1000, ",\"dur\":", (end - record.start) / 1000, ",\"args\":{");
+        if (record.command) {
+            Write(&out, "\"command\":");
+            WriteJsonString(&out, record.command);
+            Write(&out, ",");
+        }
+        if (record.done) Print(&out, "\"status\":", record.status, ",\"peak_rss_kb\":", record.peakRss / 1024);
+        else             Write(&out, "\"status\":\"still running\"");
+        Write(&out, "}}");
+    }
+    Write(&out, "\n]}\n");
+    return WriteFile(path, { out.count, out.data }, { true });
+}
+
 bool Wait(Array<Process> procs) {
     bool ok = true;
     for (auto proc : procs) {
@@ -581,486 +1440,4358 @@ Result<String> ReadFile(cstr path) {
     return {sb};
 }
 
-#ifndef NCZ_NO_OS
+// Queues
+template <typename T>
+void InitQueue(Spsc_Queue<T> *queue, usize capacity, Allocator allocator) {
+    usize size = 1;
+    while (size < capacity) size *= 2;
+    *queue = {};
+    queue->items     = static_cast<T*>(Allocate(size * sizeof(T), allocator));
+    queue->mask      = size - 1;
+    queue->allocator = allocator;
+}
 
-bool WriteFile(cstr path, String data) {
-    FILE *f = fopen(path, "wb");
-    if (f == NULL) {
-        LogError("Could not open ", path, ": ", strerror(errno));
-        return false;
+template <typename T>
+void Release(Spsc_Queue<T> *queue) {
+    Dispose(queue->items, queue->allocator);
+    *queue = {};
+}
+
+// NOTE: each side keeps a copy of the other side's index and only reads the real one (a cache
+// miss, the other thread keeps writing it) when the copy says the queue is full or empty
+template <typename T>
+bool Push(Spsc_Queue<T> *queue, T item) {
+    u64 tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    if (tail - queue->cachedHead > queue->mask) {
+        queue->cachedHead = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        if (tail - queue->cachedHead > queue->mask) return false;
     }
-    NCZ_DEFER(fclose(f));
-    
-    char *buf = data.data;
-    int  size = data.count;
-    int error = 0;
-    while (size > 0) {
-        usize n = fwrite(buf, 1, size, f);
-        error   = ferror(f);
-        if (error) {
-            LogError("Could not write data to ", path, ": ", strerror(error));
-            return false;
-        }
-        size -= n;
-        buf  += n;
+    queue->items[tail & queue->mask] = item;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+template <typename T>
+bool Pop(Spsc_Queue<T> *queue, T *item) {
+    u64 head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    if (head == queue->cachedTail) {
+        queue->cachedTail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        if (head == queue->cachedTail) return false;
     }
-    
+    *item = queue->items[head & queue->mask];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
     return true;
 }
 
-bool ReadFile(String_Builder *stream, cstr path) {
-    #define CHECK(x, e) if (x) {                                 \
-    LogError("Could not read file ", path, ": ", strerror((e))); \
-    return false;                                                \
+template <typename T>
+void InitQueue(Mpmc_Queue<T> *queue, usize capacity, Allocator allocator) {
+    usize size = 2;
+    while (size < capacity) size *= 2;
+    *queue = {};
+    queue->cells     = static_cast<typename Mpmc_Queue<T>::Cell*>(Allocate(size * sizeof(*queue->cells), allocator));
+    queue->mask      = size - 1;
+    queue->allocator = allocator;
+    for (usize i = 0; i < size; ++i) queue->cells[i].sequence = i;
+}
+
+template <typename T>
+void Release(Mpmc_Queue<T> *queue) {
+    Dispose(queue->cells, queue->allocator);
+    *queue = {};
+}
+
+// "Bounded MPMC queue" (Vyukov): a cell whose sequence is the position is free for the push to
+// that position, one whose sequence is the position + 1 holds the item for the pop from there.
+// Threads claim positions with a compare and swap and only wait on each other for that one cell.
+template <typename T>
+bool Push(Mpmc_Queue<T> *queue, T item) {
+    u64 tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        auto cell = &queue->cells[tail & queue->mask];
+        s64 difference = static_cast<s64>(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - tail);
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&queue->tail, &tail, tail + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->item = item;
+                __atomic_store_n(&cell->sequence, tail + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false; // the pop of the last lap did not happen yet, full
+        } else {
+            tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
     }
-    
-    FILE *f = fopen(path, "rb");
-    CHECK(f == NULL, errno);
-    NCZ_DEFER(fclose(f));
-    CHECK(fseek(f, 0, SEEK_END) < 0, errno);
-    
-    long m = ftell(f);
-    CHECK(m < 0, errno);
-    CHECK(fseek(f, 0, SEEK_SET) < 0, errno);
+}
 
-    usize newCount = stream->count + m;
-    if (newCount > stream->capacity) {
-        stream->data     = static_cast<char*>(Resize(stream->data, newCount, stream->count));
-        stream->capacity = newCount;
+template <typename T>
+bool Pop(Mpmc_Queue<T> *queue, T *item) {
+    u64 head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    for (;;) {
+        auto cell = &queue->cells[head & queue->mask];
+        s64 difference = static_cast<s64>(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (head + 1));
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&queue->head, &head, head + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *item = cell->item;
+                __atomic_store_n(&cell->sequence, head + queue->mask + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false; // nothing was pushed here yet, empty
+        } else {
+            head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
     }
+}
 
-    fread(stream->data + stream->count, m, 1, f);
-    int err = ferror(f);
-    CHECK(err, err);
-    stream->count = newCount;
-    
-    return true;
-    #undef CHECK
+// Entities
+void InitEntityStore(Entity_Store *store, usize capacity, Allocator allocator) {
+    *store = {};
+    store->capacity = capacity;
+    store->pool     = { NCZ_POOL_DEFAULT_BLOCK_SIZE, allocator };
 }
 
-#ifdef _WIN32
-// Stack Trace
-void LogStackTrace(usize skip) {
-    // Initialize symbols
-    SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
-    SymInitialize(GetCurrentProcess(), NULL, TRUE);
+void Release(Entity_Store *store) {
+    Release(&store->pool);
+    *store = {};
+}
 
-    // Get the current context
-    CONTEXT context;
-    RtlCaptureContext(&context);
+template <typename T>
+T *AddColumn(Entity_Store *store) {
+    NCZ_ASSERT(store->columns < NCZ_ENTITY_COLUMNS);
+    NCZ_ASSERT(store->count == 0);
+    // NOTE: Get only aligns to NCZ_POOL_ALIGNMENT (oversized blocks even less), a column starts on a cache line
+    usize bytes = store->capacity * sizeof(T);
+    auto  data  = static_cast<u8*>(Get(&store->pool, bytes + 63));
+    data = reinterpret_cast<u8*>((reinterpret_cast<usize>(data) + 63) & ~static_cast<usize>(63));
+    memset(data, 0, bytes);
+    store->column[store->columns++] = { data, sizeof(T) };
+    return reinterpret_cast<T*>(data);
+}
 
-    STACKFRAME64 stackFrame;
-    memset(&stackFrame, 0, sizeof(STACKFRAME64));
+Result<usize> AddEntity(Entity_Store *store) {
+    if (store->count == store->capacity) return {};
+    usize index = store->count++;
+    for (u32 i = 0; i < store->columns; ++i) {
+        auto column = store->column[i];
+        memset(column.data + index * column.size, 0, column.size);
+    }
+    return index;
+}
 
-    DWORD machineType;
-#ifdef _M_IX86
-    machineType = IMAGE_FILE_MACHINE_I386;
-    stackFrame.AddrPC.Offset = context.Eip;
-    stackFrame.AddrPC.Mode = AddrModeFlat;
-    stackFrame.AddrFrame.Offset = context.Ebp;
-    stackFrame.AddrFrame.Mode = AddrModeFlat;
-    stackFrame.AddrStack.Offset = context.Esp;
-    stackFrame.AddrStack.Mode = AddrModeFlat;
-#elif _M_X64
-    machineType = IMAGE_FILE_MACHINE_AMD64;
-    stackFrame.AddrPC.Offset = context.Rip;
-    stackFrame.AddrPC.Mode = AddrModeFlat;
-    stackFrame.AddrFrame.Offset = context.Rsp;
-    stackFrame.AddrFrame.Mode = AddrModeFlat;
-    stackFrame.AddrStack.Offset = context.Rsp;
-    stackFrame.AddrStack.Mode = AddrModeFlat;
-#endif
-    
-    // TODO: Pool constructor
-    // auto mark = ::ncz::context.temporary_storage.mark;
-    // NCZ_DEFER(::ncz::context.temporary_storage.mark = mark);
-    
+void RemoveEntity(Entity_Store *store, usize index) {
+    NCZ_ASSERT(index < store->count);
+    usize last = --store->count;
+    if (index == last) return;
+    for (u32 i = 0; i < store->columns; ++i) {
+        auto column = store->column[i];
+        memcpy(column.data + index * column.size, column.data + last * column.size, column.size);
+    }
+}
+
+// Broad phase
+static s32 GetGridCell(f32 value, f32 cellSize) {
+    f32 cell  = value / cellSize;
+    s32 whole = static_cast<s32>(cell);
+    return whole - (cell < whole); // floor, the cast rounds towards zero
+}
+
+static u32 GetGridBucket(s32 x, s32 y, u32 mask) {
+    return (static_cast<u32>(x) * 73856093u ^ static_cast<u32>(y) * 19349663u) & mask;
+}
+
+void InitSpatialGrid(Spatial_Grid *grid, f32 cellSize, Allocator allocator) {
+    *grid = {};
+    grid->cellSize          = cellSize;
+    grid->start.allocator   = allocator;
+    grid->entries.allocator = allocator;
+}
+
+void Release(Spatial_Grid *grid) {
+    Dispose(grid->start.data, grid->start.allocator);
+    Dispose(grid->entries.data, grid->entries.allocator);
+    *grid = {};
+}
+
+void BuildSpatialGrid(Spatial_Grid *grid, Array<Grid_Box> boxes) {
+    f32 size    = grid->cellSize;
+    grid->boxes = boxes;
+    // NOTE: twice as many buckets as boxes keeps them short, unless the boxes are much bigger than a cell
+    u32 buckets = 1;
+    while (buckets < 2 * boxes.count) buckets *= 2;
+    u32 mask = buckets - 1;
+    Reserve(&grid->start, buckets + 1);
+    grid->start.count = buckets + 1;
+    auto start = grid->start.data;
+    memset(start, 0, (buckets + 1) * sizeof(u32));
     
-    String_Builder sb{};//(NCZ_TEMP);
-    sb.allocator = NCZ_TEMP;
-    Write(&sb, "Stack Trace:\n"_str);
+    // how many entries go into each bucket, counted one bucket further, so that the prefix sum
+    // turns them into where each bucket starts
+    usize count = 0;
+    for (usize i = 0; i < boxes.count; ++i) {
+        auto box = boxes.data[i];
+        s32 minX = GetGridCell(box.minX, size), maxX = GetGridCell(box.maxX, size);
+        s32 minY = GetGridCell(box.minY, size), maxY = GetGridCell(box.maxY, size);
+        for (s32 y = minY; y <= maxY; ++y) {
+            for (s32 x = minX; x <= maxX; ++x) start[GetGridBucket(x, y, mask) + 1] += 1;
+        }
+        count += static_cast<usize>(maxX - minX + 1) * static_cast<usize>(maxY - minY + 1);
+    }
+    for (u32 b = 0; b < buckets; ++b) start[b + 1] += start[b];
     
-    // Walk the stack
-    while (StackWalk64(machineType, GetCurrentProcess(), GetCurrentThread(), &stackFrame, &context, NULL, SymFunctionTableAccess64, SymGetModuleBase64, NULL)) {
-        if (skip--) continue;
-        
-        DWORD64 displacement = 0;
-        const int bufferSize = 1024;
-        char buffer[sizeof(SYMBOL_INFO) + bufferSize] = { 0 };
-        PSYMBOL_INFO symbol = (PSYMBOL_INFO)buffer;
-        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
-        symbol->MaxNameLen = bufferSize - sizeof(SYMBOL_INFO);
+    Reserve(&grid->entries, count);
+    grid->entries.count = count;
+    auto entries = grid->entries.data;
+    for (usize i = 0; i < boxes.count; ++i) {
+        auto box = boxes.data[i];
+        s32 minX = GetGridCell(box.minX, size), maxX = GetGridCell(box.maxX, size);
+        s32 minY = GetGridCell(box.minY, size), maxY = GetGridCell(box.maxY, size);
+        for (s32 y = minY; y <= maxY; ++y) {
+            for (s32 x = minX; x <= maxX; ++x) {
+                entries[start[GetGridBucket(x, y, mask)]++] = { x, y, static_cast<u32>(i) };
+            }
+        }
+    }
+    // the scatter moved every start to where the next bucket starts
+    memmove(start + 1, start, buckets * sizeof(u32));
+    start[0] = 0;
+}
 
-        // Get symbol information
-        if (SymFromAddr(GetCurrentProcess(), stackFrame.AddrPC.Offset, &displacement, symbol)) {
-            IMAGEHLP_LINE64 line;
-            DWORD lineDisplacement;
-            line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
-            // Get line information
-            if (SymGetLineFromAddr64(GetCurrentProcess(), stackFrame.AddrPC.Offset, &lineDisplacement, &line)) {
-                Print(&sb, line.FileName, ":", (u64) line.LineNumber-1, ": ");
-            } else {
-                Print(&sb, "unknown: ");
+void FindGridPairs(Spatial_Grid *grid, List<Grid_Pair> *pairs) {
+    f32  size    = grid->cellSize;
+    auto boxes   = grid->boxes.data;
+    auto start   = grid->start.data;
+    auto entries = grid->entries.data;
+    if (grid->start.count == 0) return; // initialised, but never built
+    u32  buckets = static_cast<u32>(grid->start.count) - 1;
+    for (u32 b = 0; b < buckets; ++b) {
+        for (u32 i = start[b], end = start[b + 1]; i < end; ++i) {
+            auto e = entries[i];
+            auto p = boxes[e.item];
+            for (u32 j = i + 1; j < end; ++j) {
+                auto f = entries[j];
+                if (f.x != e.x || f.y != e.y) continue; // another cell that hashed to the same bucket
+                auto q = boxes[f.item];
+                if (p.maxX < q.minX || q.maxX < p.minX || p.maxY < q.minY || q.maxY < p.minY) continue;
+                // NOTE: boxes that overlap share every cell their overlap is in, the pair is only
+                // reported by the one its top left corner is in
+                f32 x = p.minX > q.minX ? p.minX : q.minX;
+                f32 y = p.minY > q.minY ? p.minY : q.minY;
+                if (GetGridCell(x, size) != e.x || GetGridCell(y, size) != e.y) continue;
+                Push(pairs, e.item < f.item ? Grid_Pair { e.item, f.item } : Grid_Pair { f.item, e.item });
             }
-            Print(&sb, symbol->Name, "\n");
-        } else {
-            Print(&sb, "unknown:\n");
         }
-        
-        if (strcmp(symbol->Name, "main") == 0) break;
     }
-    
-    LogEx(Log_Level::TRACE, Log_Type::INFO, sb);
-    
-    // Cleanup
-    SymCleanup(GetCurrentProcess());
 }
 
-// Multiprocessing
-bool Wait(Process proc) {
-    if (!proc) return false;
-    
-    // String_Builder output(NCZ_TEMP);
-    // DWORD bytesRead;
-    // CHAR buffer[4096];
-    // while (ReadFile(proc.output, buffer, sizeof(buffer) - 1, &bytesRead, NULL)) {
-    //     printf("read %lu\n", bytesRead);
-    //     buffer[bytesRead] = '\0';
-    //     output.append(Array<char> { buffer, bytesRead });
-    // }
-    // log(Array<char>{output.data, output.count});
-    
-    DWORD result = WaitForSingleObject((HANDLE)proc, INFINITE);
+// Profiling
+// NOTE: the cycle counter ticks at a constant rate on every core of anything made since ~2008,
+// the ticks are turned into ns with a rate that is measured against GetTimeNs between frames
+static u64 ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    u64 ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return GetTimeNs();
+#endif
+}
+
+#define NCZ_PROFILE_MAX_DEPTH 64 // deeper zones still show up, they just count as self time of the zone they are in
+
+struct Profile_Record {
+    cstr name;
+    u64  start, end; // ticks
+    u32  depth;
+};
+
+struct Profile_Thread {
+    Spsc_Queue<Profile_Record> records; // pushed by the thread, popped by EndProfileFrame
+    u32             index;
+    u32             depth;
+    u64             dropped;
+    u64             inside[NCZ_PROFILE_MAX_DEPTH]; // ns spent in the zones that ended at each depth, since the zone they are in started
+    Profile_Thread *next;
+};
+
+static bool            profilerOn      = false;
+static Profile_Thread *profileThreads  = nullptr; // threads stay on the list for good, even once they exit
+static u32             profileThreadCount = 0;
+static thread_local Profile_Thread *profileThread = nullptr;
+static u64             profileStartTicks = 0, profileStartNs = 0;
+static f64             profileNsPerTick  = 1.0;
+static u64             profileFrameCount = 0;
+static Profile_Frame   profileFrames[NCZ_PROFILE_FRAMES] {};
+
+static Profile_Thread *AddProfileThread() {
+    auto thread = static_cast<Profile_Thread*>(Allocate(sizeof(Profile_Thread), crtAllocator));
+    *thread = {};
+    InitQueue(&thread->records, NCZ_PROFILE_BUFFER_SIZE, crtAllocator);
+    thread->index = __atomic_fetch_add(&profileThreadCount, 1, __ATOMIC_RELAXED);
+    thread->next  = __atomic_load_n(&profileThreads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&profileThreads, &thread->next, thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}
+    profileThread = thread;
+    return thread;
+}
+
+Profile_Scope::Profile_Scope(cstr name) : name(name), start(0) {
+    if (!__atomic_load_n(&profilerOn, __ATOMIC_RELAXED)) return;
+    auto thread = profileThread ? profileThread : AddProfileThread();
+    thread->depth += 1;
+    start = ReadCycleCounter();
+}
+
+Profile_Scope::~Profile_Scope() {
+    if (!start) return;
+    u64 end = ReadCycleCounter();
+    auto thread = profileThread;
+    thread->depth -= 1;
+    if (!Push(&thread->records, Profile_Record { name, start, end, thread->depth })) {
+        __atomic_add_fetch(&thread->dropped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void StartProfiler() {
+    if (!profileThread) AddProfileThread();
+    profileStartTicks = ReadCycleCounter();
+    profileStartNs    = GetTimeNs();
+    __atomic_store_n(&profilerOn, true, __ATOMIC_RELAXED);
+}
+
+void StopProfiler() {
+    __atomic_store_n(&profilerOn, false, __ATOMIC_RELAXED);
+    for (auto &frame : profileFrames) {
+        Dispose(frame.zones.data, crtAllocator);
+        Dispose(frame.totals.data, crtAllocator);
+        frame = {};
+    }
+    profileFrameCount = 0;
+}
+
+static int CompareProfileTotals(const void *a, const void *b) {
+    auto x = static_cast<const Profile_Total*>(a), y = static_cast<const Profile_Total*>(b);
+    return x->ns > y->ns ? -1 : x->ns < y->ns;
+}
+
+void EndProfileFrame() {
+    if (!__atomic_load_n(&profilerOn, __ATOMIC_RELAXED)) return;
+    u64 ticks = ReadCycleCounter(), ns = GetTimeNs();
+    if (ticks > profileStartTicks && ns > profileStartNs) {
+        profileNsPerTick = static_cast<f64>(ns - profileStartNs) / static_cast<f64>(ticks - profileStartTicks);
+    }
+    auto previous = profileFrameCount ? &profileFrames[(profileFrameCount - 1) % NCZ_PROFILE_FRAMES] : nullptr;
+    auto frame = &profileFrames[profileFrameCount % NCZ_PROFILE_FRAMES];
+    frame->index   = profileFrameCount++;
+    frame->start   = previous ? previous->end : 0;
+    frame->end     = ns - profileStartNs;
+    frame->dropped = 0;
+    frame->zones.count  = 0;
+    frame->totals.count = 0;
+    frame->zones.allocator  = crtAllocator;
+    frame->totals.allocator = crtAllocator;
     
-    if (result == WAIT_FAILED) {
-        LogError("could not wait on child process: ", (u64) GetLastError());
-        return false;
+    auto ToNs = [](u64 ticks) -> u64 {
+        return ticks > profileStartTicks ? static_cast<u64>(static_cast<f64>(ticks - profileStartTicks) * profileNsPerTick) : 0;
+    };
+    // NOTE: a zone is recorded when it ends, after the zones inside of it, so by then the thread
+    // has added those up at its depth + 1 (even the ones that ended in an earlier frame)
+    for (auto thread = __atomic_load_n(&profileThreads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+        Profile_Record record;
+        while (Pop(&thread->records, &record)) {
+            Profile_Zone zone { record.name, ToNs(record.start), ToNs(record.end), thread->index, record.depth };
+            Push(&frame->zones, zone);
+            u64 ns = zone.end - zone.start, inside = 0;
+            if (zone.depth + 1 < NCZ_PROFILE_MAX_DEPTH) {
+                inside = thread->inside[zone.depth + 1];
+                thread->inside[zone.depth + 1] = 0;
+            }
+            if (zone.depth < NCZ_PROFILE_MAX_DEPTH) thread->inside[zone.depth] += ns;
+            
+            usize t = 0;
+            while (t < frame->totals.count && frame->totals.data[t].name != zone.name) t += 1;
+            if (t == frame->totals.count) Push(&frame->totals, Profile_Total { zone.name, 0, 0, 0 });
+            frame->totals.data[t].ns    += ns;
+            frame->totals.data[t].self  += ns > inside ? ns - inside : 0;
+            frame->totals.data[t].count += 1;
+        }
+        frame->dropped += __atomic_exchange_n(&thread->dropped, 0, __ATOMIC_RELAXED);
     }
+    qsort(frame->totals.data, frame->totals.count, sizeof(Profile_Total), CompareProfileTotals);
+}
 
-    DWORD exit_status;
-    if (!GetExitCodeProcess((HANDLE)proc, &exit_status)) {
-        LogError("could not get process exit code: ", (u64) GetLastError());
-        return false;
+Profile_Frame *GetProfileFrame(u32 back) {
+    if (back >= NCZ_PROFILE_FRAMES || back >= profileFrameCount) return nullptr;
+    return &profileFrames[(profileFrameCount - 1 - back) % NCZ_PROFILE_FRAMES];
+}
+
+// chrome traces count in microseconds, with fractions
+static void WriteMicroseconds(String_Builder *out, u64 ns) {
+    Print(out, ns / 1000, ".");
+    Push(out, static_cast<char>('0' + ns / 100 % 10));
+    Push(out, static_cast<char>('0' + ns / 10 % 10));
+    Push(out, static_cast<char>('0' + ns % 10));
+}
+
+bool WriteProfileTrace(cstr path) {
+    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+    String_Builder out {};
+    usize events = 0;
+    Write(&out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (u32 t = 0; t < profileThreadCount; ++t) {
+        StartTraceEvent(&out, &events);
+        Print(&out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":", static_cast<u64>(t),
+                    ",\"args\":{\"name\":\"thread ", static_cast<u64>(t), "\"}}");
     }
+    for (u32 back = NCZ_PROFILE_FRAMES; back-- > 0;) {
+        auto frame = GetProfileFrame(back);
+        if (!frame) continue;
+        for (auto &zone : frame->zones) {
+            StartTraceEvent(&out, &events);
+            Write(&out, "{\"name\":");
+            WriteJsonString(&out, zone.name);
+            Print(&out, ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":", static_cast<u64>(zone.thread), ",\"ts\":");
+            WriteMicroseconds(&out, zone.start);
+            Write(&out, ",\"dur\":");
+            WriteMicroseconds(&out, zone.end - zone.start);
+            Write(&out, "}");
+        }
+        // a marker where every frame ends, on the row of the thread that ends them
+        StartTraceEvent(&out, &events);
+        Print(&out, "{\"name\":\"frame ", frame->index, "\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":");
+        WriteMicroseconds(&out, frame->end);
+        Print(&out, ",\"args\":{\"dropped\":", frame->dropped, "}}");
+    }
+    Write(&out, "\n]}\n");
+    return WriteFile(path, { out.count, out.data }, { true });
+}
 
+// Game loop
+template <typename Tick, typename Render>
+void RunGameLoopFrame(Game_Loop *loop, f64 seconds, Tick tick, Render render) {
+    auto stats = &loop->stats;
+    if (seconds > 0) loop->accumulator += seconds;
     
-    if (exit_status != 0) {
-        
-        LogError("command exited with exit code ", (u64) exit_status);
-        return false;
+    u64 start = GetTimeNs();
+    u32 ticks = 0;
+    for (; ticks < loop->maxTicks && loop->accumulator >= loop->tick; ++ticks) {
+        tick(loop->tick);
+        loop->accumulator -= loop->tick;
+    }
+    if (loop->accumulator >= loop->tick) {
+        // NOTE: only the whole ticks are dropped, the part of one that is left still moves alpha
+        u64 behind = static_cast<u64>(loop->accumulator / loop->tick);
+        loop->accumulator -= behind * loop->tick;
+        stats->droppedNs  += static_cast<u64>(behind * loop->tick * 1e9);
     }
     
+    u64 rendered = GetTimeNs();
+    loop->alpha  = loop->accumulator / loop->tick;
+    render(loop->alpha);
     
+    stats->ticks     += ticks;
+    stats->frames    += 1;
+    stats->frameTicks = ticks;
+    stats->tickNs     = rendered - start;
+    stats->renderNs   = GetTimeNs() - rendered;
+}
 
-    CloseHandle((HANDLE)proc);
+// Benchmarks
+static Perf_Sample Subtract(Perf_Sample a, Perf_Sample b) {
+    Perf_Sample d { a.ns - b.ns, a.cycles - b.cycles, a.instructions - b.instructions, a.cacheMisses - b.cacheMisses,
+                    a.branchMisses - b.branchMisses, a.enabled - b.enabled, a.running - b.running };
+    if (d.running >= d.enabled) return d;
+    // NOTE: the counters did not count the whole time, a region they never counted in has no counts at all
+    f64 scale = d.running ? static_cast<f64>(d.enabled) / static_cast<f64>(d.running) : 0.0;
+    u64 *counts[] = { &d.cycles, &d.instructions, &d.cacheMisses, &d.branchMisses };
+    for (u64 *count : counts) *count = static_cast<u64>(static_cast<f64>(*count) * scale);
+    d.running = d.enabled;
+    return d;
+}
 
-    return true;
+static int CompareF64s(const void *a, const void *b) {
+    f64 x = *static_cast<const f64*>(a), y = *static_cast<const f64*>(b);
+    return x < y ? -1 : x > y;
 }
 
-Result<Process> RunCommandAsync(Array<cstr> args, bool trace) {
+static Bench_Stat GetBenchStat(Array<f64> values) {
+    qsort(values.data, values.count, sizeof(f64), CompareF64s);
+    auto at = [&](f64 p) { return values.data[static_cast<usize>(p * static_cast<f64>(values.count - 1) + 0.5)]; };
+    return { values.data[0], at(0.5), at(0.9), at(0.99) };
+}
 
-    // // Create a pipe to capture the process's output
-    // HANDLE hRead, hWrite;
-    // SECURITY_ATTRIBUTES sa;
-    // sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-    // sa.lpSecurityDescriptor = NULL;
-    // sa.bInheritHandle = TRUE;
-    // if (!CreatePipe(&hRead, &hWrite, &sa, 0)) {
-    //     LogError("CreatePipe failed: ", (u64) GetLastError());
-    //     return {};
-    // }
-    
-    // https://docs.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
+static Bench_Result SummarizeBench(cstr name, Array<Perf_Sample> samples, bool counted, u64 items) {
+    Bench_Result result {};
+    result.name    = name;
+    result.items   = items;
+    result.runs    = static_cast<u32>(samples.count);
+    result.counted = counted;
+    if (!samples.count) return result;
     
-    STARTUPINFO siStartInfo;
-    ZeroMemory(&siStartInfo, sizeof(siStartInfo));
-    siStartInfo.cb = sizeof(STARTUPINFO);
-    // NOTE: theoretically setting NULL to std handles should not be a problem
-    // https://docs.microsoft.com/en-us/windows/console/getstdhandle?redirectedfrom=MSDN#attachdetach-behavior
-    // TODO: check for errors in GetStdHandle
-    siStartInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
-    siStartInfo.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
-    siStartInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
-    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+    NCZ_SAVE_STATE(context.temporaryStorage.mark);
+    Array<f64> values { samples.count, static_cast<f64*>(Allocate(samples.count * sizeof(f64), NCZ_TEMP)) };
+    Array<f64> deviations { samples.count, static_cast<f64*>(Allocate(samples.count * sizeof(f64), NCZ_TEMP)) };
+    for (usize i = 0; i < samples.count; ++i) values.data[i] = static_cast<f64>(samples.data[i].ns);
+    f64 median = GetBenchStat(values).median;
+    for (usize i = 0; i < samples.count; ++i) {
+        f64 d = static_cast<f64>(samples.data[i].ns) - median;
+        deviations.data[i] = d < 0 ? -d : d;
+    }
+    // NOTE: 1.4826 turns the median absolute deviation into the standard deviation of a normal
+    // distribution, and only slow runs are outliers, nothing makes code run faster than it can.
+    // Very steady code has almost no deviation, a percent of the median keeps the limit from
+    // throwing out runs that only lost to the clock
+    f64 spread = 1.4826 * GetBenchStat(deviations).median;
+    if (spread < median / 100) spread = median / 100;
+    f64 limit = median + NCZ_BENCH_OUTLIER_MADS * spread;
+    usize kept = 0;
+    for (usize i = 0; i < samples.count; ++i) {
+        if (static_cast<f64>(samples.data[i].ns) <= limit) samples.data[kept++] = samples.data[i];
+    }
+    result.outliers = static_cast<u32>(samples.count - kept);
     
-    PROCESS_INFORMATION piProcInfo;
-    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
+    values.count = kept;
+    u64 Perf_Sample::*fields[]  = { &Perf_Sample::ns, &Perf_Sample::cycles, &Perf_Sample::instructions, &Perf_Sample::cacheMisses, &Perf_Sample::branchMisses };
+    Bench_Stat Bench_Result::*stats[] = { &Bench_Result::ns, &Bench_Result::cycles, &Bench_Result::instructions, &Bench_Result::cacheMisses, &Bench_Result::branchMisses };
+    for (usize f = 0; f < sizeof(fields) / sizeof(fields[0]); ++f) {
+        if (f && !counted) break;
+        for (usize i = 0; i < kept; ++i) values.data[i] = static_cast<f64>(samples.data[i].*fields[f]) / static_cast<f64>(items);
+        result.*stats[f] = GetBenchStat(values);
+    }
+    return result;
+}
+
+template <typename F>
+Bench_Result Bench(cstr name, F f, Bench_Options options) {
+    Perf_Counters counters {};
+    bool counted = OpenPerfCounters(&counters);
+    List<Perf_Sample> samples {};
+    samples.allocator = crtAllocator;
+    Reserve(&samples, options.minRuns);
     
-    // TODO: Pool constructor
-    // auto mark = context.temporaryStorage.mark;
-        String_Builder sb{};//(NCZ_TEMP);
-        sb.allocator = NCZ_TEMP;
-        for (auto* it = args.data; it != args.data + args.count; it++) {
-            if (it != args.data) Push(&sb, ' ');
-            if (!strchr(*it, ' ')) {
-                Write(&sb, *it);
-            } else {
-                Push(&sb, '\"');
-                Write(&sb, *it);
-                Push(&sb, '\"');
+    auto mark = context.temporaryStorage.mark;
+    for (u32 i = 0; i < options.warmup; ++i) {
+        f();
+        context.temporaryStorage.mark = mark;
+    }
+    u64 total = 0;
+    while (samples.count < options.maxRuns && (samples.count < options.minRuns || total < options.minNs)) {
+        // NOTE: the time is taken inside of the counter reads, which are system calls
+        Perf_Sample before = ReadPerfCounters(&counters);
+        before.ns = GetTimeNs();
+        f();
+        u64 end = GetTimeNs();
+        Perf_Sample after = ReadPerfCounters(&counters);
+        after.ns = end;
+        context.temporaryStorage.mark = mark;
+        Push(&samples, Subtract(after, before));
+        total += after.ns - before.ns;
+    }
+    ClosePerfCounters(&counters);
+    auto result = SummarizeBench(name, samples, counted, options.items);
+    Dispose(samples.data, crtAllocator);
+    return result;
+}
+
+// three significant digits are plenty for anything measured
+static void WriteMeasurement(String_Builder *sb, f64 value) {
+    char text[32];
+    snprintf(text, sizeof(text), value >= 100 ? "%.0f" : value >= 10 ? "%.1f" : "%.2f", value);
+    Write(sb, text);
+}
+
+void Write(String_Builder *sb, Bench_Result result) {
+    Print(sb, result.name, ": ");
+    WriteMeasurement(sb, result.ns.median);
+    Write(sb, " ns (p90 ");
+    WriteMeasurement(sb, result.ns.p90);
+    Write(sb, ", p99 ");
+    WriteMeasurement(sb, result.ns.p99);
+    Write(sb, ", min ");
+    WriteMeasurement(sb, result.ns.min);
+    Print(sb, "), ", static_cast<u64>(result.runs), " runs, ", static_cast<u64>(result.outliers), " outliers");
+    if (!result.counted) return;
+    Bench_Stat stats[] = { result.cycles, result.instructions, result.cacheMisses, result.branchMisses };
+    cstr names[]       = { " cycles, ", " instructions, ", " cache misses, ", " branch misses" };
+    Write(sb, " | ");
+    for (usize i = 0; i < 4; ++i) {
+        WriteMeasurement(sb, stats[i].median);
+        Write(sb, names[i]);
+    }
+    if (result.cycles.median > 0) {
+        Write(sb, ", ipc ");
+        WriteMeasurement(sb, result.instructions.median / result.cycles.median);
+    }
+}
+
+// NOTE: the stats are flat keys (ns_median, cycles_p90, ...), that keeps the file greppable and the
+// reader a loop over keys
+static cstr benchStatNames[]  = { "ns", "cycles", "instructions", "cache_misses", "branch_misses" };
+static Bench_Stat Bench_Result::*benchStats[] = { &Bench_Result::ns, &Bench_Result::cycles, &Bench_Result::instructions, &Bench_Result::cacheMisses, &Bench_Result::branchMisses };
+static cstr benchPartNames[]  = { "min", "median", "p90", "p99" };
+static f64 Bench_Stat::*benchParts[] = { &Bench_Stat::min, &Bench_Stat::median, &Bench_Stat::p90, &Bench_Stat::p99 };
+
+bool WriteBenchResults(cstr path, Array<Bench_Result> results) {
+    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+    String_Builder out {};
+    Write(&out, "[\n");
+    for (usize i = 0; i < results.count; ++i) {
+        auto &result = results.data[i];
+        Write(&out, "{\"name\":");
+        WriteJsonString(&out, result.name);
+        Print(&out, ",\"items\":", result.items, ",\"runs\":", static_cast<u64>(result.runs),
+                    ",\"outliers\":", static_cast<u64>(result.outliers), ",\"counted\":", result.counted ? "true" : "false");
+        for (usize s = 0; s < 5; ++s) {
+            if (s && !result.counted) break;
+            for (usize p = 0; p < 4; ++p) {
+                char value[32];
+                snprintf(value, sizeof(value), "%.6g", result.*benchStats[s].*benchParts[p]);
+                Print(&out, ",\"", benchStatNames[s], "_", benchPartNames[p], "\":", static_cast<cstr>(value));
             }
         }
-        Push(&sb, '\0');
-        if (trace) LogInfo(sb.data);
-        BOOL bSuccess = CreateProcessA(NULL, sb.data, NULL, NULL, TRUE, 0, NULL, NULL, &siStartInfo, &piProcInfo);
-    // context.temporaryStorage.mark = mark;
-    
-    if (!bSuccess) {
-        LogError("Could not create child process: ", (u64) GetLastError());
-        return {};
+        Write(&out, i + 1 < results.count ? "},\n" : "}\n");
     }
-    
-    CloseHandle(piProcInfo.hThread);
-    return (u64)piProcInfo.hProcess;
+    Write(&out, "]\n");
+    return WriteFile(path, { out.count, out.data }, { true });
 }
 
+Result<Array<Bench_Result>> ReadBenchResults(cstr path) {
+    auto [text, ok] = ReadFile(path);
+    if (!ok) return {};
+    List<Bench_Result> results {};
+    for (usize i = 0; i < text.count; ++i) {
+        if (text.data[i] != '{') continue;
+        Bench_Result result {};
+        // every key is a string and every value a string, a number or a boolean
+        while (i < text.count && text.data[i] != '}') {
+            while (i < text.count && text.data[i] != '"' && text.data[i] != '}') i += 1;
+            if (i == text.count || text.data[i] == '}') break;
+            cstr key = text.data + i + 1;
+            while (i + 1 < text.count && text.data[++i] != '"') {}
+            usize keyLength = static_cast<usize>(text.data + i - key);
+            i += 2; // the closing quote and the colon
+            if (i >= text.count) break;
+            if (text.data[i] == '"') {
+                String_Builder value {};
+                while (++i < text.count && text.data[i] != '"') {
+                    if (text.data[i] == '\\' && i + 1 < text.count) {
+                        i += 1;
+                        Push(&value, text.data[i] == 'n' ? '\n' : text.data[i]);
+                    } else {
+                        Push(&value, text.data[i]);
+                    }
+                }
+                Push(&value, '\0');
+                i += 1;
+                if (keyLength == 4 && strncmp(key, "name", 4) == 0) result.name = value.data;
+                continue;
+            }
+            char *end = nullptr;
+            f64 number = strtod(text.data + i, &end);
+            if (end == text.data + i) {
+                if (keyLength == 7 && strncmp(key, "counted", 7) == 0) result.counted = text.data[i] == 't';
+                while (i < text.count && text.data[i] != ',' && text.data[i] != '}') i += 1;
+                continue;
+            }
+            i = static_cast<usize>(end - text.data);
+            if      (keyLength == 5 && strncmp(key, "items",    5) == 0) result.items    = static_cast<u64>(number);
+            else if (keyLength == 4 && strncmp(key, "runs",     4) == 0) result.runs     = static_cast<u32>(number);
+            else if (keyLength == 8 && strncmp(key, "outliers", 8) == 0) result.outliers = static_cast<u32>(number);
+            for (usize s = 0; s < 5; ++s) {
+                usize statLength = strlen(benchStatNames[s]);
+                if (keyLength <= statLength || strncmp(key, benchStatNames[s], statLength) != 0 || key[statLength] != '_') continue;
+                for (usize p = 0; p < 4; ++p) {
+                    usize partLength = strlen(benchPartNames[p]);
+                    if (keyLength == statLength + 1 + partLength && strncmp(key + statLength + 1, benchPartNames[p], partLength) == 0) {
+                        result.*benchStats[s].*benchParts[p] = number;
+                    }
+                }
+            }
+        }
+        if (!result.name) {
+            LogError(path, " has a result without a name");
+            return {};
+        }
+        Push(&results, result);
+    }
+    return Array<Bench_Result> { results.count, results.data };
+}
 
-// Working With Files
-bool RenameFile(cstr old_path, cstr new_path) {
-    // TODO: make these logs trace or verbose
-    LogEx(Log_Level::TRACE, Log_Type::INFO, "[rename] ", old_path, " -> ", new_path);
-     if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
-        // LogError("Could not rename "_str, old_path, ": "_str, os_get_error());
-        // return false;
-        
-        char buf[256];
-        memset(buf, 0, sizeof(buf));
-        FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                       NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), 
-                       buf, (sizeof(buf) / sizeof(char)), NULL);
+u32 CompareBenchResults(Array<Bench_Result> baseline, Array<Bench_Result> results, f64 threshold) {
+    u32 regressions = 0;
+    for (usize i = 0; i < results.count; ++i) {
+        auto &result = results.data[i];
+        Bench_Result *base = nullptr;
+        for (usize j = 0; j < baseline.count && !base; ++j) {
+            if (strcmp(baseline.data[j].name, result.name) == 0) base = &baseline.data[j];
+        }
+        if (!base || base->ns.median <= 0) continue;
         
-        String str { strlen(buf), buf };
+        f64 change = result.ns.median / base->ns.median - 1;
+        if (change <= threshold) continue;
+        regressions += 1;
+        String_Builder sb {};
+        sb.allocator = NCZ_TEMP;
+        Print(&sb, result.name, " got ");
+        WriteMeasurement(&sb, 100 * change);
+        Write(&sb, "% slower: ");
+        WriteMeasurement(&sb, base->ns.median);
+        Write(&sb, " -> ");
+        WriteMeasurement(&sb, result.ns.median);
+        Write(&sb, " ns");
+        // NOTE: the instructions barely move between runs, unlike the time, when they did not
+        // change either it is more likely the machine than the code
+        if (result.counted && base->counted && base->instructions.median > 0) {
+            Write(&sb, ", instructions ");
+            WriteMeasurement(&sb, base->instructions.median);
+            Write(&sb, " -> ");
+            WriteMeasurement(&sb, result.instructions.median);
+        }
+        LogEx(Log_Level::NORMAL, Log_Type::WARN, String { sb.count, sb.data });
+    }
+    return regressions;
+}
 
-        if (str[str.count-1] == '\n') str.count -= 1;
-        LogEx(Log_Level::NORMAL, Log_Type::ERRO, "Could not rename ", old_path, ": ", str);
-        return false;
+#ifndef NCZ_NO_OS
+
+// Stats a batch of paths into infos[i], implemented per platform below.
+// Missing files are reported with exists == false, any other failure is logged.
+static bool StatFiles(Array<cstr> paths, File_Info *infos);
+
+struct File_Info_Cache {
+    struct Entry {
+        u64       hash   = 0;
+        cstr      path   = nullptr;
+        bool      cached = false;
+        File_Info info   = {};
+    };
+    Entry *entries  = nullptr;
+    usize count     = 0;
+    usize capacity  = 0;
+};
+static File_Info_Cache fileInfoCache {};
+
+static u64 HashCstr(cstr str) {
+    u64 hash = 14695981039346656037ull; // FNV-1a
+    for (; *str; ++str) hash = (hash ^ static_cast<u8>(*str)) * 1099511628211ull;
+    return hash;
+}
+
+// Returns the slot for path, inserting an empty (uncached) one if needed
+// NOTE: "./a.c" and "a.c" are the same file, forgetting one has to forget the other
+static cstr StripDotSlash(cstr path) {
+    while (path[0] == '.' && IsPathSep(path[1]) && path[2]) path += 2;
+    return path;
+}
+
+static File_Info_Cache::Entry *FindFileInfoEntry(cstr path) {
+    path = StripDotSlash(path);
+    auto cache = &fileInfoCache;
+    if (2 * (cache->count + 1) > cache->capacity) {
+        auto old         = *cache;
+        cache->capacity  = old.capacity ? 2 * old.capacity : 1024;
+        cache->count     = 0;
+        cache->entries   = static_cast<File_Info_Cache::Entry*>(
+            Allocate(cache->capacity * sizeof(File_Info_Cache::Entry), crtAllocator)
+        );
+        for (usize i = 0; i < cache->capacity; ++i) cache->entries[i] = {};
+        for (usize i = 0; i < old.capacity; ++i) {
+            auto entry = old.entries[i];
+            if (!entry.path) continue;
+            usize j = entry.hash & (cache->capacity - 1);
+            while (cache->entries[j].path) j = (j + 1) & (cache->capacity - 1);
+            cache->entries[j] = entry;
+            cache->count += 1;
+        }
+        if (old.entries) Dispose(old.entries, crtAllocator);
     }
-    return true;
+    
+    u64 hash = HashCstr(path);
+    usize i  = hash & (cache->capacity - 1);
+    for (;; i = (i + 1) & (cache->capacity - 1)) {
+        auto entry = &cache->entries[i];
+        if (!entry->path) break;
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) return entry;
+    }
+    
+    NCZ_PUSH_STATE(context.allocator, crtAllocator);
+    cache->entries[i] = { hash, CopyCstr(path), false, {} };
+    cache->count += 1;
+    return &cache->entries[i];
 }
 
-bool NeedsUpdate(cstr output_path, Array<cstr> input_paths) {
-    String error_string {};
-    u32 error_id = 0;
-    #define CHECK(x, ...) if (!(x)) { \
-        error_id = GetLastError();    \
-        error_string.count = FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, error_id, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&error_string.data, 0, NULL) - 1; \
-        LogError(/*NCZ_HERE, " ",*/ __VA_ARGS__, ": (", error_id, ") ", error_string); \
-        LocalFree(error_string.data); \
-        return false; \
+Result<File_Info> GetFileInfo(cstr path) {
+    auto entry = FindFileInfoEntry(path);
+    if (!entry->cached) {
+        if (!StatFiles({1, &path}, &entry->info)) return {};
+        entry->cached = true;
     }
+    return entry->info;
+}
+
+void ForgetFileInfo(cstr path) { FindFileInfoEntry(path)->cached = false; }
+
+void ClearFileInfoCache() {
+    for (usize i = 0; i < fileInfoCache.capacity; ++i) fileInfoCache.entries[i].cached = false;
+}
+
+struct Stat_Job {
+    Array<cstr> paths = {};
+    File_Info  *infos = nullptr;
+    bool        ok    = true;
+};
+static void RunStatJob(void *data) {
+    auto job = static_cast<Stat_Job*>(data);
+    job->ok  = StatFiles(job->paths, job->infos);
+}
+
+static int CompareCstrs(const void *a, const void *b) {
+    return strcmp(*static_cast<const cstr*>(a), *static_cast<const cstr*>(b));
+}
+
+// NOTE: spawning a thread costs about as much as a few dozen stat calls, so we only
+// go parallel when every thread gets a reasonably sized chunk of paths
+#ifndef NCZ_PREFETCH_MIN_PATHS_PER_THREAD
+#define NCZ_PREFETCH_MIN_PATHS_PER_THREAD 64
+#endif//NCZ_PREFETCH_MIN_PATHS_PER_THREAD
+
+bool PrefetchFileInfo(Array<cstr> paths, u32 threads) {
+    NCZ_SAVE_STATE(context.temporaryStorage.mark);
+    List<cstr> misses {}; misses.allocator = NCZ_TEMP;
+    for (cstr path : paths) if (!FindFileInfoEntry(path)->cached) Push(&misses, path);
+    if (!misses.count) return true;
     
-    BOOL bSuccess;
+    // sorting groups paths by folder, so the batches share directory lookups
+    qsort(misses.data, misses.count, sizeof(cstr), CompareCstrs);
+    auto infos = static_cast<File_Info*>(Get(&context.temporaryStorage, misses.count * sizeof(File_Info)));
     
-    HANDLE output_path_fd = CreateFile(output_path, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, NULL);
-    if (output_path_fd == INVALID_HANDLE_VALUE) {
-        error_id = GetLastError();
-        if (error_id == 2) { // output does not yet exist, means we have to update
+    if (threads < 1) threads = 1;
+    if (misses.count < threads * NCZ_PREFETCH_MIN_PATHS_PER_THREAD) {
+        threads = static_cast<u32>(misses.count / NCZ_PREFETCH_MIN_PATHS_PER_THREAD);
+        if (threads < 1) threads = 1;
+    }
+    
+    bool ok = true;
+    if (threads == 1) {
+        ok = StatFiles(misses, infos);
+    } else {
+        auto jobs    = static_cast<Stat_Job*>(Get(&context.temporaryStorage, threads * sizeof(Stat_Job)));
+        auto handles = static_cast<Result<Thread>*>(Get(&context.temporaryStorage, threads * sizeof(Result<Thread>)));
+        usize chunk  = (misses.count + threads - 1) / threads;
+        for (u32 t = 0; t < threads; ++t) {
+            usize begin = t * chunk, end = begin + chunk;
+            if (begin > misses.count) begin = misses.count;
+            if (end   > misses.count) end   = misses.count;
+            jobs[t]    = { {end - begin, misses.data + begin}, infos + begin, true };
+            handles[t] = StartThread(RunStatJob, &jobs[t]);
+            // if we could not get a thread just do the work here
+            if (!handles[t].ok) RunStatJob(&jobs[t]);
+        }
+        for (u32 t = 0; t < threads; ++t) {
+            if (handles[t].ok) ok = JoinThread(handles[t].value) && ok;
+            ok = jobs[t].ok && ok;
+        }
+    }
+    if (!ok) return false;
+    
+    for (usize i = 0; i < misses.count; ++i) {
+        auto entry    = FindFileInfoEntry(misses[i]);
+        entry->info   = infos[i];
+        entry->cached = true;
+    }
+    return true;
+}
+
+bool NeedsUpdate(cstr outputPath, Array<cstr> inputPaths) {
+    auto [output, ok] = GetFileInfo(outputPath);
+    if (!ok) return false;
+    // NOTE: if output does not exist it 100% must be rebuilt
+    if (!output.exists) return true;
+    
+    if (inputPaths.count > 1 && !PrefetchFileInfo(inputPaths)) return false;
+    for (cstr inputPath : inputPaths) {
+        auto [input, ok] = GetFileInfo(inputPath);
+        if (!ok) return false;
+        if (!input.exists) {
+            // NOTE: non-existing input is an error cause it is needed for building in the first place
+            LogError("Could not find input file ", inputPath);
+            return false;
+        }
+        // NOTE: if even a single input is fresher than outputPath that's 100% rebuild
+        if (input.mtime > output.mtime) return true;
+    }
+    
+    return false;
+}
+
+Result<File_Type> GetFileType(cstr path) {
+    auto [info, ok] = GetFileInfo(path);
+    if (!ok) return {};
+    if (!info.exists) {
+        LogError("Could not get file type of ", path, ": file does not exist");
+        return {};
+    }
+    return info.type;
+}
+
+bool CreateFolder(cstr path) {
+    NCZ_SAVE_STATE(context.temporaryStorage.mark);
+    String folder = TPrint(path);
+    for (usize i = 1; i <= folder.count; ++i) {
+        if (i < folder.count && !IsPathSep(folder.data[i])) continue;
+        char sep = folder.data[i];
+        folder.data[i] = '\0';
+            ForgetFileInfo(folder.data);
+            #ifdef _WIN32
+            if (!CreateDirectoryA(folder.data, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+                LogError("Could not create folder ", folder.data, ": ", (u64) GetLastError());
+                return false;
+            }
+            #else
+            if (mkdir(folder.data, 0755) != 0 && errno != EEXIST) {
+                LogError("Could not create folder ", folder.data, ": ", strerror(errno));
+                return false;
+            }
+            #endif//_WIN32
+        folder.data[i] = sep;
+    }
+    return true;
+}
+
+bool ReadFile(String_Builder *stream, cstr path) {
+    #define CHECK(x, e) if (x) {                                 \
+    LogError("Could not read file ", path, ": ", strerror((e))); \
+    return false;                                                \
+    }
+    
+    FILE *f = fopen(path, "rb");
+    CHECK(f == NULL, errno);
+    NCZ_DEFER(fclose(f));
+    CHECK(fseek(f, 0, SEEK_END) < 0, errno);
+    
+    long m = ftell(f);
+    CHECK(m < 0, errno);
+    CHECK(fseek(f, 0, SEEK_SET) < 0, errno);
+
+    usize newCount = stream->count + m;
+    Reserve(stream, newCount);
+
+    fread(stream->data + stream->count, m, 1, f);
+    int err = ferror(f);
+    CHECK(err, err);
+    stream->count = newCount;
+    
+    return true;
+    #undef CHECK
+}
+
+// Implemented per platform below, handles are file descriptors or HANDLEs. They log their own errors.
+// A new file written to replace another one (atomic writes) gets the permissions of that one
+static s64  OpenFileHandle(cstr path, bool write, cstr replaces = nullptr);
+static void CloseFileHandle(s64 handle);
+static bool WriteToHandle(s64 handle, cstr path, const char *data, usize size);
+static bool WriteToHandle(s64 handle, cstr path, Array<String> pieces);
+static bool SyncFileHandle(s64 handle, cstr path); // waits until the data is on the disk
+// Renames tempPath over path, durable also waits until the rename is on the disk
+static bool CommitTempFile(cstr tempPath, cstr path, bool durable);
+static u64  CurrentProcessId();
+static Result<usize> ReadFromHandle(s64 handle, cstr path, char *data, usize size); // 0 at the end
+// Copies all of from into to without going through user space, returns false (without logging)
+// if the platform or the file system can not do that and nothing was copied
+static Result<bool> CopyHandleFast(s64 from, s64 to, u64 *copied);
+
+#ifndef NCZ_STREAM_BUFFER_SIZE
+#define NCZ_STREAM_BUFFER_SIZE (64 * 1024)
+#endif//NCZ_STREAM_BUFFER_SIZE
+
+// NOTE: next to path so the rename never has to cross file systems, the process id and the counter
+// keep concurrent writers of the same path out of each other's way
+static cstr TempPathFor(cstr path) {
+    static u64 counter = 0;
+    u64 n = __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+    return TPrint(path, ".", CurrentProcessId(), "-", n, ".tmp").data;
+}
+
+bool WriteFile(cstr path, Array<String> pieces, Write_Options options) {
+    if (options.durable) options.atomic = true;
+    ForgetFileInfo(path);
+    cstr target = options.atomic ? TempPathFor(path) : path;
+    s64 handle = OpenFileHandle(target, true, options.atomic ? path : nullptr);
+    if (handle == -1) return false;
+    
+    bool ok = WriteToHandle(handle, path, pieces);
+    if (ok && options.durable) ok = SyncFileHandle(handle, path);
+    CloseFileHandle(handle);
+    
+    if (!options.atomic) return ok;
+    if (ok) ok = CommitTempFile(target, path, options.durable);
+    if (!ok) remove(target);
+    return ok;
+}
+
+bool WriteFile(cstr path, String data, Write_Options options) {
+    return WriteFile(path, { 1, &data }, options);
+}
+
+// Synchronization
+// NOTE: the futex calls are implemented per platform below
+
+void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+void WaitWhileEqual(u32 *address, u32 expected) {
+    for (u32 spin = 0; spin < NCZ_SPIN_COUNT; ++spin) {
+        if (__atomic_load_n(address, __ATOMIC_ACQUIRE) != expected) return;
+        CpuRelax();
+    }
+    while (__atomic_load_n(address, __ATOMIC_ACQUIRE) == expected) FutexWait(address, expected);
+}
+
+// "Futexes Are Tricky" (Drepper), the third mutex: unlocking only makes a system call when the
+// state says somebody might be asleep
+void Lock(Mutex *mutex) {
+    u32 state = 0;
+    if (__atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+    for (u32 spin = 0; spin < NCZ_SPIN_COUNT && state == 1; ++spin) {
+        CpuRelax();
+        state = 0;
+        if (__atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+    }
+    // NOTE: we cannot know whether we are the only one asleep, so whoever gets here locks with 2
+    // and the unlock wakes somebody even if nobody is left
+    if (state != 2) state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    while (state != 0) {
+        FutexWait(&mutex->state, 2);
+        state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+bool TryLock(Mutex *mutex) {
+    u32 state = 0;
+    return __atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void Unlock(Mutex *mutex) {
+    if (__atomic_exchange_n(&mutex->state, 0, __ATOMIC_RELEASE) == 2) FutexWakeOne(&mutex->state);
+}
+
+// NOTE: a waiter reads the sequence before it unlocks, a signal after that changes it, so the
+// futex does not put the waiter to sleep when it missed the wake
+void Wait(Condition *condition, Mutex *mutex) {
+    u32 sequence = __atomic_load_n(&condition->sequence, __ATOMIC_RELAXED);
+    Unlock(mutex);
+    FutexWait(&condition->sequence, sequence);
+    // whoever else was woken up is probably waiting for the mutex too, 2 makes sure they get woken
+    while (__atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE) != 0) FutexWait(&mutex->state, 2);
+}
+
+void Signal(Condition *condition) {
+    __atomic_add_fetch(&condition->sequence, 1, __ATOMIC_RELEASE);
+    FutexWakeOne(&condition->sequence);
+}
+
+void Broadcast(Condition *condition) {
+    __atomic_add_fetch(&condition->sequence, 1, __ATOMIC_RELEASE);
+    FutexWakeAll(&condition->sequence);
+}
+
+void Post(Semaphore *semaphore, u32 count) {
+    __atomic_add_fetch(&semaphore->count, count, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&semaphore->waiters, __ATOMIC_SEQ_CST)) {
+        if (count == 1) FutexWakeOne(&semaphore->count);
+        else            FutexWakeAll(&semaphore->count);
+    }
+}
+
+bool TryWait(Semaphore *semaphore) {
+    u32 count = __atomic_load_n(&semaphore->count, __ATOMIC_RELAXED);
+    while (count) {
+        if (__atomic_compare_exchange_n(&semaphore->count, &count, count - 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return true;
+    }
+    return false;
+}
+
+void Wait(Semaphore *semaphore) {
+    for (u32 spin = 0; spin < NCZ_SPIN_COUNT; ++spin) {
+        if (TryWait(semaphore)) return;
+        CpuRelax();
+    }
+    // NOTE: waiters goes up before count is read again and Post reads waiters after count went up
+    // (both sequentially consistent), so either we see the post or the post sees us
+    __atomic_add_fetch(&semaphore->waiters, 1, __ATOMIC_SEQ_CST);
+    while (!TryWait(semaphore)) FutexWait(&semaphore->count, 0);
+    __atomic_sub_fetch(&semaphore->waiters, 1, __ATOMIC_RELAXED);
+}
+
+// "Eventcount" (Vyukov): setting the lowest bit and reading the condition are ordered by the
+// read-modify-write, making the condition true and reading the bit by the fence in Notify
+u32 PrepareWait(Event_Count *events) {
+    return __atomic_fetch_or(&events->state, 1, __ATOMIC_SEQ_CST) | 1;
+}
+
+void CommitWait(Event_Count *events, u32 key) {
+    WaitWhileEqual(&events->state, key);
+}
+
+void Notify(Event_Count *events) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    u32 state = __atomic_load_n(&events->state, __ATOMIC_RELAXED);
+    while (state & 1) {
+        if (__atomic_compare_exchange_n(&events->state, &state, (state + 2) & ~1u, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            FutexWakeAll(&events->state);
+            return;
+        }
+    }
+}
+
+// Tasks
+#ifndef NCZ_TASK_DEQUE_SIZE
+#define NCZ_TASK_DEQUE_SIZE 4096 // a task that does not fit runs right away, on the thread that added it
+#endif//NCZ_TASK_DEQUE_SIZE
+
+struct Task_Link {
+    Task      *task;
+    Task_Link *next;
+};
+
+struct Task {
+    Task_Proc  proc;
+    void      *data;
+    Allocator  allocator;
+    bool       temporary; // allocator was the temporary storage of whoever added it
+    Logger     logger;
+    cstr       jobLabel;
+    u32        waitingFor; // unfinished tasks in after, plus one while AddTask is not done with it
+    Task_Link *dependents; // TASK_DONE once it finished
+};
+#define TASK_DONE (reinterpret_cast<Task_Link*>(1))
+
+// NOTE: top and bottom are written by different threads, the padding keeps them on their own cache lines
+struct Task_Worker {
+    Task_Pool *pool;
+    u32        index;
+    u32        depth;   // tasks running on this thread's stack
+    u64        batch;   // the batch tasks and temporary storage were last reset for
+    u64        random;  // picks who to steal from
+    Pool       tasks;   // the tasks it added and their links
+    Result<Thread> thread;
+    u8         padding0[64];
+    s64        top;
+    u8         padding1[64];
+    s64        bottom;
+    Task      *slots[NCZ_TASK_DEQUE_SIZE];
+};
+
+static thread_local Task_Worker *currentWorker = nullptr;
+
+// The deque, following "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.):
+// only the owner pushes and pops at the bottom, anyone steals at the top, and the last task is
+// settled with a compare and swap on top between the owner and the thieves.
+static bool PushTask(Task_Worker *worker, Task *task) {
+    s64 bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    s64 top    = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= NCZ_TASK_DEQUE_SIZE) return false;
+    __atomic_store_n(&worker->slots[bottom % NCZ_TASK_DEQUE_SIZE], task, __ATOMIC_RELAXED);
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELEASE); // publishes the slot (and the task)
+    return true;
+}
+
+static Task *PopTask(Task_Worker *worker) {
+    s64 bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&worker->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    s64 top = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+    if (top > bottom) {
+        __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return nullptr;
+    }
+    Task *task = __atomic_load_n(&worker->slots[bottom % NCZ_TASK_DEQUE_SIZE], __ATOMIC_RELAXED);
+    if (top == bottom) {
+        if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) task = nullptr;
+        __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+static Task *StealTask(Task_Worker *worker) {
+    s64 top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    s64 bottom = __atomic_load_n(&worker->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) return nullptr;
+    Task *task = __atomic_load_n(&worker->slots[top % NCZ_TASK_DEQUE_SIZE], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) return nullptr;
+    return task;
+}
+
+static Task *FindTask(Task_Pool *pool, Task_Worker *worker) {
+    Task *task = PopTask(worker);
+    if (!task) {
+        worker->random ^= worker->random << 13; worker->random ^= worker->random >> 7; worker->random ^= worker->random << 17;
+        for (u32 i = 0; i < pool->count && !task; ++i) {
+            auto victim = &pool->workers[(worker->random + i) % pool->count];
+            if (victim != worker) task = StealTask(victim);
+        }
+    }
+    if (task) __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+    return task;
+}
+
+static void RunTask(Task_Pool *pool, Task_Worker *worker, Task *task);
+
+static void ScheduleTask(Task_Pool *pool, Task_Worker *worker, Task *task) {
+    if (!PushTask(worker, task)) {
+        RunTask(pool, worker, task);
+        return;
+    }
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+    Notify(&pool->idle);
+}
+
+static void FinishTask(Task_Pool *pool, Task_Worker *worker, Task *task) {
+    Task_Link *link = __atomic_exchange_n(&task->dependents, TASK_DONE, __ATOMIC_ACQ_REL);
+    for (; link; link = link->next) {
+        if (__atomic_sub_fetch(&link->task->waitingFor, 1, __ATOMIC_ACQ_REL) == 0) ScheduleTask(pool, worker, link->task);
+    }
+    // NOTE: the last thing that touches the task, WaitForTasks may throw it away right after
+    __atomic_sub_fetch(&pool->unfinished, 1, __ATOMIC_RELEASE);
+}
+
+static void RunTask(Task_Pool *pool, Task_Worker *worker, Task *task) {
+    // a worker notices a new batch when it gets its first task of it, nobody else touches its memory
+    u64 batch = __atomic_load_n(&pool->batch, __ATOMIC_ACQUIRE);
+    if (worker->index && worker->batch != batch && !worker->depth) {
+        Reset(&worker->tasks);
+        Reset(&context.temporaryStorage);
+        worker->batch = batch;
+    }
+    {
+        NCZ_PUSH_STATE(context.allocator, task->temporary ? NCZ_TEMP : task->allocator);
+        NCZ_PUSH_STATE(context.logger, task->logger);
+        NCZ_PUSH_STATE(context.jobLabel, task->jobLabel);
+        worker->depth += 1;
+        task->proc(task->data);
+        worker->depth -= 1;
+    }
+    FinishTask(pool, worker, task);
+}
+
+// Runs tasks until done() says so, backing off while there is nothing to take
+template <typename F>
+static void HelpUntil(Task_Pool *pool, Task_Worker *worker, F done) {
+    for (u32 idle = 0; !done();) {
+        Task *task = FindTask(pool, worker);
+        if (task) { RunTask(pool, worker, task); idle = 0; continue; }
+        if (++idle < 64) CpuRelax();
+        else SleepNs(idle < 256 ? 0 : 50000);
+    }
+}
+
+static void RunTaskWorker(void *data) {
+    auto worker = static_cast<Task_Worker*>(data);
+    auto pool   = worker->pool;
+    currentWorker = worker;
+    for (;;) {
+        Task *task = nullptr;
+        for (u32 spin = 0; !task && spin < 64; ++spin) {
+            task = FindTask(pool, worker);
+            if (!task) CpuRelax();
+        }
+        if (task) { RunTask(pool, worker, task); continue; }
+        
+        u32 key = PrepareWait(&pool->idle);
+        if (__atomic_load_n(&pool->stopping, __ATOMIC_ACQUIRE)) break;
+        if (!__atomic_load_n(&pool->queued, __ATOMIC_RELAXED)) CommitWait(&pool->idle, key);
+    }
+    Release(&worker->tasks);
+    Release(&context.temporaryStorage);
+}
+
+bool StartTaskPool(Task_Pool *pool, u32 threads) {
+    NCZ_ASSERT(!currentWorker && "this thread already runs a task pool");
+    if (!threads) threads = GetProcessorCount();
+    *pool = {};
+    pool->count   = threads;
+    pool->workers = static_cast<Task_Worker*>(Allocate(threads * sizeof(Task_Worker), crtAllocator));
+    for (u32 i = 0; i < threads; ++i) {
+        auto worker = &pool->workers[i];
+        *worker = {};
+        worker->pool   = pool;
+        worker->index  = i;
+        worker->random = 0x9E3779B97F4A7C15ull * (i + 1);
+        worker->tasks  = { 16 * 1024, crtAllocator };
+    }
+    currentWorker = &pool->workers[0];
+    // NOTE: a worker without a thread just has an empty deque, only its own thread would fill it
+    for (u32 i = 1; i < threads; ++i) {
+        pool->workers[i].thread = StartThread(RunTaskWorker, &pool->workers[i]);
+        if (!pool->workers[i].thread.ok) LogError("Could not start task worker ", i, ", going on without it");
+    }
+    return true;
+}
+
+void StopTaskPool(Task_Pool *pool) {
+    WaitForTasks(pool);
+    __atomic_store_n(&pool->stopping, true, __ATOMIC_RELEASE);
+    Notify(&pool->idle);
+    for (u32 i = 1; i < pool->count; ++i) {
+        if (pool->workers[i].thread.ok) JoinThread(pool->workers[i].thread.value);
+    }
+    Release(&pool->workers[0].tasks);
+    Dispose(pool->workers, crtAllocator);
+    *pool = {};
+    currentWorker = nullptr;
+}
+
+Task *AddTask(Task_Pool *pool, Task_Proc proc, void *data, Array<Task*> after) {
+    auto worker = currentWorker;
+    NCZ_ASSERT(worker && worker->pool == pool && "tasks are added by the pool's thread or by tasks");
+    auto task = static_cast<Task*>(Get(&worker->tasks, sizeof(Task)));
+    bool temporary = context.allocator.data == &context.temporaryStorage;
+    *task = { proc, data, context.allocator, temporary, context.logger, context.jobLabel, 1, nullptr };
+    __atomic_add_fetch(&pool->unfinished, 1, __ATOMIC_RELAXED);
+    
+    for (usize i = 0; i < after.count; ++i) {
+        Task *before = after.data[i];
+        if (!before) continue;
+        auto link = static_cast<Task_Link*>(Get(&worker->tasks, sizeof(Task_Link)));
+        link->task = task;
+        task->waitingFor += 1; // nobody else knows the task yet
+        Task_Link *head = __atomic_load_n(&before->dependents, __ATOMIC_ACQUIRE);
+        for (;;) {
+            if (head == TASK_DONE) { task->waitingFor -= 1; break; }
+            link->next = head;
+            if (__atomic_compare_exchange_n(&before->dependents, &head, link, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) break;
+        }
+    }
+    if (__atomic_sub_fetch(&task->waitingFor, 1, __ATOMIC_ACQ_REL) == 0) ScheduleTask(pool, worker, task);
+    return task;
+}
+
+void WaitForTask(Task_Pool *pool, Task *task) {
+    auto worker = currentWorker;
+    NCZ_ASSERT(worker && worker->pool == pool);
+    HelpUntil(pool, worker, [&]() { return __atomic_load_n(&task->dependents, __ATOMIC_ACQUIRE) == TASK_DONE; });
+}
+
+void WaitForTasks(Task_Pool *pool) {
+    auto worker = currentWorker;
+    NCZ_ASSERT(worker == &pool->workers[0] && !worker->depth && "only the pool's thread ends a batch, outside of tasks");
+    {
+        NCZ_SAVE_STATE(context.temporaryStorage.mark);
+        HelpUntil(pool, worker, [&]() { return !__atomic_load_n(&pool->unfinished, __ATOMIC_ACQUIRE); });
+    }
+    Reset(&worker->tasks);
+    __atomic_add_fetch(&pool->batch, 1, __ATOMIC_RELEASE);
+}
+
+struct Range_Job {
+    Task_Pool *pool;
+    Range_Proc proc;
+    void      *data;
+    usize      begin, end, grain;
+    u64       *remaining;
+};
+
+static void RunRangeJob(void *data) {
+    auto job = *static_cast<Range_Job*>(data);
+    while (job.end - job.begin > job.grain) {
+        usize middle = job.begin + (job.end - job.begin) / 2;
+        auto right = static_cast<Range_Job*>(Get(&currentWorker->tasks, sizeof(Range_Job)));
+        *right = job;
+        right->begin = middle;
+        AddTask(job.pool, RunRangeJob, right);
+        job.end = middle;
+    }
+    job.proc(job.data, job.begin, job.end);
+    __atomic_sub_fetch(job.remaining, job.end - job.begin, __ATOMIC_RELEASE);
+}
+
+void ParallelForRange(Task_Pool *pool, usize count, Range_Proc proc, void *data, usize grain) {
+    if (!count) return;
+    if (!grain) grain = count / (8 * pool->count);
+    if (!grain) grain = 1;
+    auto worker = currentWorker;
+    NCZ_ASSERT(worker && worker->pool == pool);
+    u64 remaining = count;
+    Range_Job job { pool, proc, data, 0, count, grain, &remaining };
+    AddTask(pool, RunRangeJob, &job);
+    if (worker->index || worker->depth) {
+        HelpUntil(pool, worker, [&]() { return !__atomic_load_n(&remaining, __ATOMIC_ACQUIRE); });
+    } else {
+        WaitForTasks(pool);
+    }
+}
+
+template <typename T, typename F>
+void ParallelFor(Task_Pool *pool, Array<T> items, F f, usize grain) {
+    struct Closure { Array<T> items; F *f; };
+    Closure closure { items, &f };
+    ParallelForRange(pool, items.count, [](void *data, usize begin, usize end) {
+        auto closure = static_cast<Closure*>(data);
+        for (usize i = begin; i < end; ++i) (*closure->f)(closure->items.data[i]);
+    }, &closure, grain);
+}
+
+// Turns "unix:<path>" or "tcp:<host>:<port>" into a socket address, listen makes * mean every interface
+static bool ResolveSocketAddress(cstr address, bool listen, sockaddr_storage *addr, socklen_t *size) {
+    memset(addr, 0, sizeof(*addr));
+    if (strncmp(address, "unix:", 5) == 0) {
+        auto local = reinterpret_cast<sockaddr_un*>(addr);
+        cstr path  = address + 5;
+        if (!*path || strlen(path) >= sizeof(local->sun_path)) {
+            LogError("Socket path ", path, " is empty or too long");
+            return false;
+        }
+        local->sun_family = AF_UNIX;
+        strcpy(local->sun_path, path);
+        *size = sizeof(sockaddr_un);
+        return true;
+    }
+    
+    cstr colon = strncmp(address, "tcp:", 4) == 0 ? strrchr(address + 4, ':') : nullptr;
+    if (!colon) {
+        LogError("Bad socket address ", address, ", it should be unix:<path> or tcp:<host>:<port>");
+        return false;
+    }
+    String host { static_cast<usize>(colon - address - 4), const_cast<char*>(address + 4) };
+    if (host.count >= 2 && host.data[0] == '[' && host.data[host.count - 1] == ']') host = { host.count - 2, host.data + 1 }; // [::1]
+    cstr hostName = TPrint(host).data;
+    if (listen && strcmp(hostName, "*") == 0) hostName = nullptr;
+    
+    addrinfo hints {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = listen ? AI_PASSIVE : 0;
+    addrinfo *found = nullptr;
+    int error = getaddrinfo(hostName, colon + 1, &hints, &found);
+    if (error) {
+        LogError("Could not resolve ", address, ": ", gai_strerror(error));
+        return false;
+    }
+    memcpy(addr, found->ai_addr, found->ai_addrlen);
+    *size = static_cast<socklen_t>(found->ai_addrlen);
+    freeaddrinfo(found);
+    return true;
+}
+
+#ifndef NCZ_NO_CC
+// Implemented per platform below
+static cstr FindExecutable(cstr name); // searches the PATH, nullptr if it is not there
+static void ReplaceProcess(cstr path, Array<cstr> args); // runs path with args, only returns if that failed
+
+// Adds the prerequisites of the makefile rule in path (what -MMD writes) to deps,
+// returns false if there is no such file
+static bool ReadDepfile(cstr path, List<cstr> *deps) {
+    auto [info, found] = GetFileInfo(path);
+    if (!found || !info.exists) return false;
+    auto [text, ok] = ReadFile(path);
+    if (!ok) return false;
+    
+    // NOTE: the target ends at the first colon followed by white space, a windows path has one
+    // right after the drive letter
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    usize i = 0;
+    while (i < text.count && !(text.data[i] == ':' && (i + 1 == text.count || isSpace(text.data[i+1])))) i += 1;
+    
+    String_Builder dep {}; dep.allocator = NCZ_TEMP;
+    for (i += 1; i <= text.count; ++i) {
+        char c    = i < text.count ? text.data[i] : ' ';
+        char next = i + 1 < text.count ? text.data[i+1] : '\0';
+        if (c == '\\' && next == ' ') { Push(&dep, ' '); i += 1; continue; }  // escaped space
+        if (c == '\\' && (next == '\n' || next == '\r')) c = ' ';            // line continuation
+        if (!isSpace(c)) { Push(&dep, c); continue; }
+        if (!dep.count) continue;
+        Push(&dep, '\0');
+        Push(deps, static_cast<cstr>(dep.data));
+        dep = {}; dep.allocator = NCZ_TEMP;
+    }
+    return true;
+}
+
+static cstr ProbeCompiler() {
+    cstr env = getenv("CXX");
+    if (env && *env) return env;
+    cstr candidates[] = { "clang", "clang++", "g++", "c++" };
+    for (cstr candidate : candidates) if (FindExecutable(candidate)) return candidate;
+    return nullptr;
+}
+
+void ReloadCppScript(Array<cstr> args, cstr src) {
+    cstr binary  = GetProgramPath(args[0]);
+    cstr depfile = TPrint(binary, ".d").data;
+    cstr cache   = TPrint(binary, ".cc").data;
+    
+    // NOTE: without a depfile we can not know what else src includes, so we have to build
+    List<cstr> inputs {}; inputs.allocator = NCZ_TEMP;
+    Push(&inputs, src);
+    bool stale = !ReadDepfile(depfile, &inputs);
+    if (!stale && !PrefetchFileInfo(inputs)) {
+        LogError("Could not check whether ", binary, " is up to date, rebuilding it");
+        stale = true;
+    }
+    // a header that is gone is no reason to stop, the compiler will tell if it is still needed
+    for (usize i = 0; !stale && i < inputs.count; ++i) stale = !GetFileInfo(inputs[i]).value.exists;
+    if (!stale && !NeedsUpdate(binary, inputs)) return;
+    
+    cstr compiler = nullptr;
+    String_Builder cached {}; cached.allocator = NCZ_TEMP;
+    if (GetFileInfo(cache).value.exists && ReadFile(&cached, cache)) {
+        while (cached.count && (cached.data[cached.count-1] == '\n' || cached.data[cached.count-1] == '\r')) cached.count -= 1;
+        Push(&cached, '\0');
+        compiler = cached.data;
+    }
+    if (!compiler || !*compiler) {
+        compiler = ProbeCompiler();
+        if (!compiler) {
+            LogError("Could not find a compiler to rebuild ", binary, ", set CXX");
+            exit(1);
+        }
+        WriteFile(cache, { strlen(compiler), const_cast<char*>(compiler) });
+    }
+    
+    // NOTE: same as an atomic WriteFile, the new binary is built next to the old one and only
+    // replaces it once the compiler is done, a failed compile leaves the old one in place
+    cstr fresh = TempPathFor(binary);
+    if (!RunCmd(compiler, NCZ_SCRIPT_CFLAGS, "-MMD", "-MF", depfile, "-o", fresh, src) || !CommitTempFile(fresh, binary, false)) {
+        remove(fresh);
+        // the compiler may be gone, look for it again next time
+        remove(cache);
+        exit(1);
+    }
+    ReplaceProcess(binary, args);
+    exit(1);
+}
+#endif//NCZ_NO_CC
+
+static void FlushStream(Stream *stream) {
+    if (!stream->ok || !stream->buffer.count) return;
+    stream->ok = WriteToHandle(stream->handle, stream->path, stream->buffer.data, stream->buffer.count);
+    stream->written      += stream->buffer.count;
+    stream->buffer.count  = 0;
+}
+
+static void WriteRaw(Stream *stream, const char *data, usize size) {
+    if (!stream->ok) return;
+    if (stream->buffer.count + size > stream->buffer.capacity) FlushStream(stream);
+    if (size >= stream->buffer.capacity) {
+        // NOTE: too big to be worth buffering
+        stream->ok = stream->ok && WriteToHandle(stream->handle, stream->path, data, size);
+        stream->written += size;
+        return;
+    }
+    memcpy(stream->buffer.data + stream->buffer.count, data, size);
+    stream->buffer.count += size;
+}
+
+// Encodes whole groups of three bytes straight into the buffer, whatever is left over is carried
+// to the next write (or padded by SetEncoding/CloseStream)
+static void WriteBase64Chunks(Stream *stream, const u8 *data, usize size) {
+    if (!stream->ok) return; // a failed stream drops what it is given, like WriteRaw
+    while (stream->carried && size) {
+        stream->carry[stream->carried++] = *data++;
+        size -= 1;
+        if (stream->carried == 3) {
+            stream->carried = 0;
+            WriteBase64Chunks(stream, stream->carry, 3);
+        }
+    }
+    constexpr const usize MAX_GROUPS = NCZ_STREAM_BUFFER_SIZE / 4;
+    while (size >= 3) {
+        usize groups = size / 3 < MAX_GROUPS ? size / 3 : MAX_GROUPS;
+        if (stream->buffer.count + 4 * groups > stream->buffer.capacity) FlushStream(stream);
+        if (!stream->ok) return;
+        WriteBase64(&stream->buffer, { 3 * groups, reinterpret_cast<char*>(const_cast<u8*>(data)) });
+        data += 3 * groups;
+        size -= 3 * groups;
+    }
+    // NOTE: carry holds 3 bytes, only ever the ones that do not make a whole group
+    for (usize i = 0; i < size % 3; ++i) stream->carry[stream->carried++] = data[i];
+}
+
+bool OpenStream(Stream *stream, cstr path, Write_Options options) {
+    *stream = {};
+    if (options.durable) options.atomic = true;
+    stream->path    = path;
+    stream->options = options;
+    if (options.atomic) {
+        NCZ_PUSH_STATE(context.allocator, crtAllocator);
+        stream->tempPath = CopyCstr(TempPathFor(path));
+    }
+    stream->handle = OpenFileHandle(options.atomic ? stream->tempPath : path, true, options.atomic ? path : nullptr);
+    ForgetFileInfo(path);
+    if (stream->handle == -1) {
+        Dispose(const_cast<char*>(stream->tempPath), crtAllocator);
+        stream->tempPath = nullptr;
+        return false;
+    }
+    stream->buffer.allocator = crtAllocator;
+    Reserve(&stream->buffer, NCZ_STREAM_BUFFER_SIZE);
+    stream->ok = true;
+    return true;
+}
+
+void Write(Stream *stream, String data) {
+    if (stream->encoding == Stream_Encoding::BASE64) {
+        WriteBase64Chunks(stream, reinterpret_cast<const u8*>(data.data), data.count);
+    } else {
+        WriteRaw(stream, data.data, data.count);
+    }
+}
+void Write(Stream *stream, cstr data) { Write(stream, { strlen(data), const_cast<char*>(data) }); }
+
+void SetEncoding(Stream *stream, Stream_Encoding encoding) {
+    if (stream->carried) {
+        String_Builder padded {};
+        char chars[4];
+        padded.data     = chars;
+        padded.capacity = sizeof(chars);
+        WriteBase64(&padded, { stream->carried, reinterpret_cast<char*>(stream->carry) });
+        stream->carried = 0;
+        WriteRaw(stream, chars, padded.count);
+    }
+    stream->encoding = encoding;
+}
+
+bool CopyFileToStream(Stream *stream, cstr path) {
+    if (!stream->ok) return false;
+    s64 from = OpenFileHandle(path, false);
+    if (from == -1) return stream->ok = false;
+    NCZ_DEFER(CloseFileHandle(from));
+    
+    if (stream->encoding == Stream_Encoding::NONE) {
+        FlushStream(stream);
+        if (!stream->ok) return false;
+        u64 copied = 0;
+        auto [done, ok] = CopyHandleFast(from, stream->handle, &copied);
+        stream->written += copied;
+        if (!ok) return stream->ok = false;
+        if (done) return stream->ok;
+    }
+    
+    char chunk[4096];
+    for (;;) {
+        auto [n, ok] = ReadFromHandle(from, path, chunk, sizeof(chunk));
+        if (!ok) return stream->ok = false;
+        if (!n) break;
+        Write(stream, { n, chunk });
+        if (!stream->ok) return false;
+    }
+    return stream->ok;
+}
+
+bool CloseStream(Stream *stream) {
+    if (stream->handle == -1) return false;
+    SetEncoding(stream, Stream_Encoding::NONE);
+    FlushStream(stream);
+    if (stream->ok && stream->options.durable) stream->ok = SyncFileHandle(stream->handle, stream->path);
+    CloseFileHandle(stream->handle);
+    if (stream->tempPath) {
+        if (stream->ok) stream->ok = CommitTempFile(stream->tempPath, stream->path, stream->options.durable);
+        if (!stream->ok) remove(stream->tempPath);
+        Dispose(const_cast<char*>(stream->tempPath), crtAllocator);
+        stream->tempPath = nullptr;
+    }
+    ForgetFileInfo(stream->path);
+    Dispose(stream->buffer.data, crtAllocator);
+    stream->handle = -1;
+    stream->buffer = {};
+    return stream->ok;
+}
+
+#ifdef NCZ_IO_URING
+// Does the whole batch through io_uring, implemented below. Returns false (without logging) when
+// io_uring can not be used, ok tells if every request went fine.
+static bool ReadFilesWithRing(Array<File_Request> requests, bool *ok);
+#endif//NCZ_IO_URING
+
+// NOTE: a thread costs about as much to start as reading a few small files
+#ifndef NCZ_BULK_IO_MIN_FILES_PER_THREAD
+#define NCZ_BULK_IO_MIN_FILES_PER_THREAD 16
+#endif//NCZ_BULK_IO_MIN_FILES_PER_THREAD
+
+// Points the data of a request that was statted at the memory the file is read into
+static void PrepareFileData(File_Request *request) {
+    if (!request->read || request->info.type != File_Type::FILE || !request->info.size) return;
+    usize size = request->info.size;
+    char *data = request->buffer.count >= size ? request->buffer.data : static_cast<char*>(Allocate(size));
+    request->data = { size, data };
+}
+
+struct File_Job {
+    Array<File_Request> requests = {};
+    cstr               *paths    = nullptr; // for the stat phase
+    File_Info          *infos    = nullptr;
+    bool                ok       = true;
+};
+
+static void RunStatFilesJob(void *data) {
+    auto job = static_cast<File_Job*>(data);
+    if (StatFiles({ job->requests.count, job->paths }, job->infos)) return;
+    // NOTE: StatFiles stops at the first error, ask again one by one to find out which ones failed
+    job->ok = false;
+    for (usize i = 0; i < job->requests.count; ++i) {
+        job->requests.data[i].ok = StatFiles({ 1, &job->paths[i] }, &job->infos[i]);
+    }
+}
+
+static void RunReadFilesJob(void *data) {
+    auto job = static_cast<File_Job*>(data);
+    for (auto &request : job->requests) {
+        if (!request.data.count) continue;
+        s64 handle = OpenFileHandle(request.path, false);
+        if (handle == -1) {
+            request.ok = job->ok = false;
+            continue;
+        }
+        usize done = 0;
+        while (done < request.data.count) {
+            auto [n, ok] = ReadFromHandle(handle, request.path, request.data.data + done, request.data.count - done);
+            if (!ok) request.ok = job->ok = false;
+            if (!ok || !n) break; // the file got shorter since we looked at it
+            done += n;
+        }
+        request.data.count = done;
+        CloseFileHandle(handle);
+    }
+}
+
+// Runs proc on every job, one thread each, the first one on the calling thread
+static bool RunFileJobs(Thread_Proc proc, File_Job *jobs, u32 count) {
+    auto threads = static_cast<Result<Thread>*>(Allocate(count * sizeof(Result<Thread>), crtAllocator));
+    NCZ_DEFER(Dispose(threads, crtAllocator));
+    for (u32 t = 1; t < count; ++t) {
+        threads[t] = StartThread(proc, &jobs[t]);
+        // if we could not get a thread just do the work here
+        if (!threads[t].ok) proc(&jobs[t]);
+    }
+    proc(&jobs[0]);
+    bool ok = true;
+    for (u32 t = 0; t < count; ++t) {
+        if (t && threads[t].ok) ok = JoinThread(threads[t].value) && ok;
+        ok = jobs[t].ok && ok;
+    }
+    return ok;
+}
+
+static bool ReadFilesWithThreads(Array<File_Request> requests, u32 threads) {
+    if (!threads) threads = GetProcessorCount();
+    if (requests.count < threads * NCZ_BULK_IO_MIN_FILES_PER_THREAD) {
+        threads = static_cast<u32>(requests.count / NCZ_BULK_IO_MIN_FILES_PER_THREAD);
+        if (threads < 1) threads = 1;
+    }
+    
+    auto jobs  = static_cast<File_Job*>(Allocate(threads * sizeof(File_Job), crtAllocator));
+    auto paths = static_cast<cstr*>(Allocate(requests.count * sizeof(cstr), crtAllocator));
+    auto infos = static_cast<File_Info*>(Allocate(requests.count * sizeof(File_Info), crtAllocator));
+    NCZ_DEFER(Dispose(jobs, crtAllocator); Dispose(paths, crtAllocator); Dispose(infos, crtAllocator));
+    
+    usize chunk = (requests.count + threads - 1) / threads;
+    for (u32 t = 0; t < threads; ++t) {
+        usize begin = t * chunk, end = begin + chunk;
+        if (begin > requests.count) begin = requests.count;
+        if (end   > requests.count) end   = requests.count;
+        jobs[t] = { { end - begin, requests.data + begin }, paths + begin, infos + begin, true };
+    }
+    for (usize i = 0; i < requests.count; ++i) paths[i] = requests.data[i].path;
+    bool ok = RunFileJobs(RunStatFilesJob, jobs, threads);
+    
+    // NOTE: allocating happens here, between the phases, the context allocator belongs to this thread
+    for (usize i = 0; i < requests.count; ++i) {
+        auto request = &requests.data[i];
+        if (!request->ok) continue;
+        request->info = infos[i];
+        PrepareFileData(request);
+    }
+    for (u32 t = 0; t < threads; ++t) jobs[t].ok = true;
+    return RunFileJobs(RunReadFilesJob, jobs, threads) && ok;
+}
+
+bool ReadFiles(Array<File_Request> requests, File_Batch_Options options) {
+    for (auto &request : requests) {
+        request.info = {};
+        request.data = {};
+        request.ok   = true;
+    }
+    if (!requests.count) return true;
+    
+    bool ok   = true;
+    bool done = false;
+    #ifdef NCZ_IO_URING
+    if (options.allowRing) done = ReadFilesWithRing(requests, &ok);
+    #endif//NCZ_IO_URING
+    if (!done) ok = ReadFilesWithThreads(requests, options.threads);
+    
+    for (auto &request : requests) {
+        if (!request.ok) continue;
+        auto entry    = FindFileInfoEntry(request.path);
+        entry->info   = request.info;
+        entry->cached = true;
+    }
+    return ok;
+}
+
+static void PushUnique(List<cstr> *paths, cstr path) {
+    for (cstr it : *paths) if (strcmp(it, path) == 0) return;
+    Push(paths, CopyCstr(path));
+}
+
+#ifndef __linux__
+// Polling fallback for File_Watcher: walks the watched trees and compares modification times
+// with the previous walk. The snapshot lives in the crt allocator, changes are copied with the
+// context allocator.
+static bool SnapshotWatchedFiles(File_Watcher *watcher, List<cstr> *changes) {
+    List<cstr> files  {}; files.allocator  = crtAllocator;
+    List<u64>  mtimes {}; mtimes.allocator = crtAllocator;
+    for (cstr root : watcher->roots) {
+        Array<Walk_Entry> entries {};
+        {
+            NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+            auto result = WalkFolder(root);
+            if (!result.ok) return false;
+            entries = result.value;
+        }
+        for (auto entry : entries) {
+            if (entry.type != File_Type::FILE) continue;
+            ForgetFileInfo(entry.path.data);
+            auto [info, ok] = GetFileInfo(entry.path.data);
+            if (!ok) return false;
+            NCZ_PUSH_STATE(context.allocator, crtAllocator);
+            Push(&files,  CopyCstr(entry.path.data));
+            Push(&mtimes, info.mtime);
+        }
+    }
+    
+    if (changes) {
+        auto seen = static_cast<bool*>(Get(&context.temporaryStorage, watcher->files.count + 1));
+        memset(seen, 0, watcher->files.count + 1);
+        for (usize i = 0; i < files.count; ++i) {
+            // NOTE: we walk the same trees every time so the old entry is usually at the same index
+            usize j = i;
+            if (j >= watcher->files.count || strcmp(watcher->files[j], files[i]) != 0) {
+                for (j = 0; j < watcher->files.count; ++j) if (strcmp(watcher->files[j], files[i]) == 0) break;
+            }
+            if (j < watcher->files.count) seen[j] = true;
+            if (j == watcher->files.count || watcher->mtimes[j] != mtimes[i]) PushUnique(changes, files[i]);
+        }
+        for (usize j = 0; j < watcher->files.count; ++j) {
+            if (!seen[j]) PushUnique(changes, watcher->files[j]);
+        }
+    }
+    
+    for (cstr file : watcher->files) Dispose(const_cast<char*>(file), crtAllocator);
+    if (watcher->files.data)  Dispose(watcher->files.data,  crtAllocator);
+    if (watcher->mtimes.data) Dispose(watcher->mtimes.data, crtAllocator);
+    watcher->files  = files;
+    watcher->mtimes = mtimes;
+    return true;
+}
+
+bool WatchFolder(File_Watcher *watcher, cstr path) {
+    NCZ_PUSH_STATE(context.allocator, crtAllocator);
+    Push(&watcher->roots, CopyCstr(path));
+    return SnapshotWatchedFiles(watcher, nullptr);
+}
+
+#ifndef NCZ_WATCH_POLL_INTERVAL_MS
+#define NCZ_WATCH_POLL_INTERVAL_MS 250
+#endif//NCZ_WATCH_POLL_INTERVAL_MS
+
+Result<Array<cstr>> WaitForChanges(File_Watcher *watcher, u64 debounceMs) {
+    List<cstr> changes {};
+    while (!changes.count) {
+        SleepNs(NCZ_WATCH_POLL_INTERVAL_MS * 1000000ull);
+        if (!SnapshotWatchedFiles(watcher, &changes)) return {};
+    }
+    for (;;) {
+        usize count = changes.count;
+        SleepNs(debounceMs * 1000000ull);
+        if (!SnapshotWatchedFiles(watcher, &changes)) return {};
+        if (changes.count == count) break;
+    }
+    return changes;
+}
+#endif//__linux__
+
+static bool MatchesAnyGlob(Array<cstr> globs, String path) {
+    for (cstr glob : globs) if (MatchGlob({strlen(glob), const_cast<char*>(glob)}, path)) return true;
+    return false;
+}
+
+// Every walker thread collects its entries into its own pool, which are then copied
+// out with the caller's allocator once the walk is done.
+struct Walk_Worker {
+    struct Walker    *walker  = nullptr;
+    Pool              pool    = {64 * 1024, crtAllocator};
+    List<Walk_Entry>  entries = {};
+    bool              ok      = true;
+};
+
+static Result<Array<Walk_Entry>> CollectWalkEntries(Walk_Worker *workers, u32 count) {
+    bool  ok    = true;
+    usize total = 0;
+    for (u32 i = 0; i < count; ++i) {
+        ok     = workers[i].ok && ok;
+        total += workers[i].entries.count;
+    }
+    
+    Array<Walk_Entry> result {};
+    if (ok && total) {
+        result.data = static_cast<Walk_Entry*>(Allocate(total * sizeof(Walk_Entry)));
+        for (u32 i = 0; i < count; ++i) {
+            for (auto entry : workers[i].entries) {
+                char *path = static_cast<char*>(Allocate(entry.path.count + 1));
+                memcpy(path, entry.path.data, entry.path.count + 1);
+                result.data[result.count++] = { {entry.path.count, path}, entry.type };
+            }
+        }
+    }
+    for (u32 i = 0; i < count; ++i) Release(&workers[i].pool);
+    if (!ok) return {};
+    return result;
+}
+
+// Decides what to do with path (which starts at the end of the root):
+// returns false if it is excluded and sets *report if it should be part of the output
+static bool FilterWalkEntry(Walk_Options *options, String relativePath, bool *report) {
+    if (MatchesAnyGlob(options->exclude, relativePath)) return false;
+    *report = !options->include.count || MatchesAnyGlob(options->include, relativePath);
+    return true;
+}
+
+Build_Target *AddTarget(Build_Graph *graph, cstr name) {
+    auto target = static_cast<Build_Target*>(Allocate(sizeof(Build_Target)));
+    *target = {};
+    target->name = name;
+    Push(&graph->targets, target);
+    return target;
+}
+
+static void LinkTargets(Build_Target *from, Build_Target *to) {
+    Push(&from->dependents, to);
+    to->waitingFor += 1;
+}
+
+static bool Produces(Build_Target *target, cstr path) {
+    for (cstr output : target->outputs) {
+        if (strcmp(StripDotSlash(output), StripDotSlash(path)) == 0) return true;
+    }
+    return false;
+}
+
+static Result<bool> IsTargetStale(Build_Target *target) {
+    if (!target->outputs.count) return true;
+    if (target->inputs.count > 1 && !PrefetchFileInfo(target->inputs)) return {};
+    for (cstr input : target->inputs) {
+        auto [info, ok] = GetFileInfo(input);
+        if (!ok) return {};
+        if (!info.exists) {
+            LogError("target ", target->name, " needs ", input, ", which does not exist and no target makes it");
+            return {};
+        }
+    }
+    for (cstr output : target->outputs) {
+        if (NeedsUpdate(output, target->inputs)) return true;
+    }
+    return false;
+}
+
+// The outputs changed, so the cache has to ask again, and whoever was waiting on them may be ready now
+static void FinishTarget(Build_Target *target, List<Build_Target*> *ready) {
+    for (cstr output : target->outputs) ForgetFileInfo(output);
+    for (auto dependent : target->dependents) {
+        if (--dependent->waitingFor == 0) Push(ready, dependent);
+    }
+}
+
+bool RunBuildGraph(Build_Graph *graph, u32 jobs) {
+    if (!jobs) jobs = GetProcessorCount();
+    auto targets = graph->targets;
+    for (auto target : targets) {
+        target->dependents.count = 0;
+        target->waitingFor       = 0;
+        target->ran              = false;
+    }
+    
+    // NOTE: quadratic, but build graphs have tens of targets, not thousands
+    for (auto target : targets) {
+        for (auto dep : target->deps) LinkTargets(dep, target);
+        for (cstr input : target->inputs) {
+            for (auto producer : targets) {
+                if (producer != target && Produces(producer, input)) LinkTargets(producer, target);
+            }
+        }
+    }
+    
+    // topological order, the waiting counts are restored afterwards
+    List<Build_Target*> order {};
+    for (auto target : targets) if (!target->waitingFor) Push(&order, target);
+    for (usize i = 0; i < order.count; ++i) {
+        for (auto dependent : order[i]->dependents) {
+            if (--dependent->waitingFor == 0) Push(&order, dependent);
+        }
+    }
+    if (order.count != targets.count) {
+        for (auto target : targets) {
+            if (target->waitingFor) LogError("target ", target->name, " is part of (or waits on) a dependency cycle");
+        }
+        return false;
+    }
+    for (auto target : targets) {
+        for (auto dependent : target->dependents) dependent->waitingFor += 1;
+    }
+    for (usize i = order.count; i-- > 0;) {
+        auto target = order[i];
+        u64 rest = 0;
+        for (auto dependent : target->dependents) {
+            if (dependent->priority > rest) rest = dependent->priority;
+        }
+        target->priority = target->cost + rest;
+    }
+    
+    List<Build_Target*> ready   {};
+    List<Build_Target*> running {};
+    List<Process>       procs   {};
+    for (auto target : targets) if (!target->waitingFor) Push(&ready, target);
+    
+    bool ok = true;
+    while (ok && (ready.count || running.count)) {
+        while (ok && ready.count && running.count < jobs) {
+            usize best = 0;
+            for (usize i = 1; i < ready.count; ++i) {
+                if (ready[i]->priority > ready[best]->priority) best = i;
+            }
+            auto target = ready[best];
+            ready[best] = ready[ready.count - 1];
+            ready.count -= 1;
+            
+            auto [stale, checked] = IsTargetStale(target);
+            if (!checked) { ok = false; break; }
+            if (!stale) { FinishTarget(target, &ready); continue; }
+            
+            target->ran = true;
+            NCZ_PUSH_STATE(context.jobLabel, target->name);
+            if (target->proc) {
+                s64 step = RecordJobStart(0, {});
+                ok = target->proc(target->data);
+                RecordJobEnd(step, ok ? 0 : 1, 0);
+                if (!ok) LogError("target ", target->name, " failed");
+                else     FinishTarget(target, &ready);
+            } else if (target->command.count) {
+                auto [proc, started] = RunCommandAsync(target->command);
+                if (!started) { ok = false; break; }
+                Push(&procs, proc);
+                Push(&running, target);
+            } else {
+                FinishTarget(target, &ready);
+            }
+        }
+        if (!ok || !running.count) break;
+        
+        usize index = 0;
+        bool succeeded = WaitAny(procs, &index);
+        if (index == procs.count) { ok = false; break; }
+        auto target = running[index];
+        procs[index]   = procs[procs.count - 1];
+        running[index] = running[running.count - 1];
+        procs.count   -= 1;
+        running.count -= 1;
+        if (!succeeded) {
+            LogError("target ", target->name, " failed");
+            ok = false;
+            break;
+        }
+        FinishTarget(target, &ready);
+    }
+    
+    // NOTE: let whatever is still running finish, so that no process outlives the build
+    // and the file info cache does not remember outputs that are still being written
+    if (procs.count) Wait(procs);
+    for (auto target : running) for (cstr output : target->outputs) ForgetFileInfo(output);
+    return ok;
+}
+
+#ifndef NCZ_NO_CC
+// Remote compiles
+// NOTE: a message is a list of blobs, each one a u64 size (little endian, like every machine we
+// build on) followed by that many bytes. A job starts with the protocol version and the compiler,
+// the worker answers with the hash of what that compiler's --version says (empty when it will not
+// run it). Then either an empty blob, the object was in the cache after all, or the compiler and
+// its flags separated by '\0' (without -c, -o and the source), the source's file name (the
+// compiler goes by its extension) and the preprocessed source. The answer to that is "ok" or
+// "failed", what the compiler printed and the object.
+#define NCZ_COMPILE_PROTOCOL "ncz-compile-2"
+#define NCZ_COMPILE_MAX_BLOB (u64(4) << 30)
+
+static bool SendBlob(Socket socket, String blob) {
+    u64 size = blob.count;
+    return SendAll(socket, { sizeof(size), reinterpret_cast<char*>(&size) }) && SendAll(socket, blob);
+}
+
+// The blob is allocated with the context allocator and null terminated, so text can be used as a cstr
+static bool ReceiveBlob(Socket socket, String *blob) {
+    u64 size = 0;
+    if (!ReceiveAll(socket, { sizeof(size), reinterpret_cast<char*>(&size) })) return false;
+    if (size > NCZ_COMPILE_MAX_BLOB) {
+        LogError("Got a message of ", size, " bytes, that is not a compile job");
+        return false;
+    }
+    *blob = { size, static_cast<char*>(Allocate(size + 1)) };
+    blob->data[size] = '\0';
+    return ReceiveAll(socket, *blob);
+}
+
+static bool IsSourceFile(cstr arg) {
+    cstr dot = strrchr(arg, '.');
+    if (arg[0] == '-' || !dot) return false;
+    cstr extensions[] = { ".c", ".cc", ".cpp", ".cxx", ".m", ".mm" };
+    for (cstr extension : extensions) if (strcmp(dot, extension) == 0) return true;
+    return false;
+}
+
+// Flags that take the next argument as their value
+static bool TakesValue(cstr arg) {
+    cstr flags[] = { "-o", "-D", "-U", "-I", "-isystem", "-iquote", "-idirafter", "-include", "-isysroot", "--sysroot", "-target", "-arch", "-Xclang", "-mllvm" };
+    for (cstr flag : flags) if (strcmp(arg, flag) == 0) return true;
+    return false;
+}
+
+// Flags that tell the preprocessor where files are, the worker gets the preprocessed source instead
+static bool IsIncludeFlag(cstr arg) {
+    cstr flags[] = { "-I", "-isystem", "-iquote", "-idirafter", "-include", "-isysroot", "--sysroot" };
+    for (cstr flag : flags) if (strncmp(arg, flag, strlen(flag)) == 0) return true;
+    return false;
+}
+
+// Flags that read or write files the worker does not have, or writes them where we would not see
+// them, and the ones that would build for the worker's processor instead of ours
+static bool IsLocalFlag(cstr arg) {
+    cstr flags[] = { "-M", "-ftime-trace", "-include-pch", "-fprofile-instr-use", "-fprofile-use", "-fprofile-sample-use", "-x", "-save-temps", "-Wp,", "@",
+                     "-march=native", "-mtune=native", "-mcpu=native" };
+    for (cstr flag : flags) if (strncmp(arg, flag, strlen(flag)) == 0) return true;
+    return false;
+}
+
+bool CanCompileRemotely(Array<cstr> command) {
+    if (command.count < 2) return false;
+    bool compile = false, output = false;
+    usize sources = 0;
+    for (usize i = 1; i < command.count; ++i) {
+        cstr arg = command.data[i];
+        if (IsLocalFlag(arg)) return false;
+        if (strcmp(arg, "-c") == 0) compile = true;
+        else if (strcmp(arg, "-o") == 0) output = i + 1 < command.count;
+        else if (IsSourceFile(arg)) sources += 1;
+        if (TakesValue(arg)) i += 1;
+    }
+    return compile && output && sources == 1;
+}
+
+// 128 bits of a fast hash (not a cryptographic one), plenty to tell compile jobs apart
+struct Content_Hash {
+    u64 a = 0x9E3779B97F4A7C15ull;
+    u64 b = 0xC2B2AE3D27D4EB4Full;
+};
+
+static u64 RotateLeft(u64 x, u32 n) { return x << n | x >> (64 - n); }
+
+static void HashBytes(Content_Hash *hash, String data) {
+    constexpr const u64 P1 = 0x87C37B91114253D5ull, P2 = 0x4CF5AD432745937Full;
+    usize i = 0;
+    for (u64 word; i + 8 <= data.count; i += 8) {
+        memcpy(&word, data.data + i, 8);
+        hash->a = RotateLeft(hash->a ^ word * P1, 31) * P2;
+        hash->b = RotateLeft(hash->b + word * P2, 33) * P1;
+    }
+    u64 tail = 0;
+    if (i < data.count) memcpy(&tail, data.data + i, data.count - i);
+    hash->a = RotateLeft(hash->a ^ tail * P1, 31) * P2 ^ data.count;
+    hash->b = RotateLeft(hash->b + tail * P2, 33) * P1 + data.count;
+}
+
+// The hash as 32 hex digits, mixed so that every bit of a and b shows up everywhere
+static cstr HashName(Content_Hash hash) {
+    auto mix = [](u64 x) { x ^= x >> 33; x *= 0xFF51AFD7ED558CCDull; x ^= x >> 33; x *= 0xC4CEB9FE1A85EC53ull; return x ^ x >> 33; };
+    u64 words[] = { mix(hash.a ^ RotateLeft(hash.b, 17)), mix(hash.b ^ RotateLeft(hash.a, 41)) };
+    String_Builder name {};
+    for (u64 word : words) {
+        for (u32 shift = 64; shift;) Push(&name, "0123456789abcdef"[(word >> (shift -= 4)) & 15]);
+    }
+    Push(&name, '\0');
+    return name.data;
+}
+
+// Asks the worker on socket which compiler it has, an empty identity means it will not run that one
+static bool ReceiveCompilerIdentity(Socket socket, cstr compiler, String *identity) {
+    return SendBlob(socket, NCZ_COMPILE_PROTOCOL ""_str) && SendBlob(socket, { strlen(compiler), const_cast<char*>(compiler) }) &&
+           ReceiveBlob(socket, identity);
+}
+
+// Compiles what CompileRemotely preprocessed on the worker, returns false if the job never came back
+static bool SendCompileJob(Socket socket, String flags, cstr name, String source, bool *compiled, String *log, String *object) {
+    String status {};
+    bool ok = SendBlob(socket, flags) && SendBlob(socket, { strlen(name), const_cast<char*>(name) }) && SendBlob(socket, source) &&
+              ReceiveBlob(socket, &status) && ReceiveBlob(socket, log) && ReceiveBlob(socket, object);
+    *compiled = ok && strcmp(status.data, "ok") == 0;
+    return ok;
+}
+
+bool CompileRemotely(Array<cstr> command, Remote_Compile_Options options) {
+    if (!CanCompileRemotely(command)) return RunCommandSync(command, false);
+    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+    
+    // NOTE: the worker gets everything but the paths the preprocessor needed, the defines stay
+    // because -frewrite-includes leaves the macros (and the #ifs) alone
+    cstr compiler = command.data[0], source = nullptr, object = nullptr;
+    bool clang = strstr(compiler, "clang") != nullptr;
+    List<cstr> preprocess {}, flags {};
+    Push(&preprocess, compiler);
+    Push(&flags, compiler);
+    for (usize i = 1; i < command.count; ++i) {
+        cstr arg   = command.data[i];
+        cstr value = TakesValue(arg) && i + 1 < command.count ? command.data[++i] : nullptr;
+        if (strcmp(arg, "-c") == 0) continue;
+        if (strcmp(arg, "-o") == 0) { object = value; continue; }
+        if (IsSourceFile(arg))      { source = arg;   continue; }
+        Push(&preprocess, arg);
+        if (value) Push(&preprocess, value);
+        if (IsIncludeFlag(arg)) continue;
+        Push(&flags, arg);
+        if (value) Push(&flags, value);
+    }
+    // gcc has to be told that the directives are already taken care of
+    if (!clang) Append(&flags, static_cast<cstr>("-fpreprocessed"), static_cast<cstr>("-fdirectives-only"));
+    
+    cstr preprocessed = SPrint(object, ".pp").data;
+    Append(&preprocess, static_cast<cstr>("-E"), static_cast<cstr>(clang ? "-frewrite-includes" : "-fdirectives-only"), source, static_cast<cstr>("-o"), preprocessed);
+    if (!RunCommandSync(preprocess, false)) return false; // missing headers and such, already reported
+    auto [text, read] = ReadFile(preprocessed);
+    remove(preprocessed);
+    if (!read) return false;
+    
+    cstr name = source;
+    for (cstr c = source; *c; ++c) if (*c == '/' || *c == '\\') name = c + 1;
+    String_Builder joined {};
+    for (cstr flag : flags) { Write(&joined, flag); Push(&joined, '\0'); }
+    
+    // what is compiled picks the worker, that worker's compiler completes the key of the cache
+    Content_Hash job {};
+    HashBytes(&job, { joined.count, joined.data });
+    HashBytes(&job, { strlen(name), const_cast<char*>(name) });
+    HashBytes(&job, text);
+    
+    usize count = options.workers.count;
+    for (usize n = 0; n < count; ++n) {
+        cstr address = options.workers.data[(job.a + n) % count];
+        auto connection = ConnectSocket(address);
+        if (!connection.ok) continue;
+        Socket socket = connection.value;
+        NCZ_DEFER(CloseSocket(socket));
+        String identity {};
+        if (!ReceiveCompilerIdentity(socket, compiler, &identity) || !identity.count) continue;
+        Content_Hash hash = job;
+        HashBytes(&hash, identity);
+        
+        // NOTE: the log goes into the cache before the object, an object in the cache always has one
+        cstr cachedObject = nullptr, cachedLog = nullptr;
+        if (options.cacheDir) {
+            cstr key     = HashName(hash);
+            cachedObject = SPrint(options.cacheDir, NCZ_PATH_SEP, key, ".o").data;
+            cachedLog    = SPrint(options.cacheDir, NCZ_PATH_SEP, key, ".log").data;
+            if (GetFileInfo(cachedObject).value.exists) {
+                auto [log, hasLog] = ReadFile(cachedLog);
+                auto [cached, hit] = ReadFile(cachedObject);
+                if (hasLog && hit) {
+                    SendBlob(socket, {}); // nothing to compile after all
+                    fwrite(log.data, 1, log.count, stderr);
+                    return WriteFile(object, cached, { true });
+                }
+            }
+        }
+        
+        bool compiled = false;
+        String log {}, result {};
+        if (!SendCompileJob(socket, { joined.count, joined.data }, name, text, &compiled, &log, &result)) continue;
+        fwrite(log.data, 1, log.count, stderr);
+        if (!compiled) return false;
+        if (options.cacheDir && CreateFolder(options.cacheDir)) {
+            if (WriteFile(cachedLog, log, { true })) WriteFile(cachedObject, result, { true });
+        }
+        return WriteFile(object, result, { true });
+    }
+    LogInfo("no compile worker could take ", source, ", compiling it here");
+    return RunCommandSync(command, false);
+}
+
+static bool IsKnownCompiler(cstr compiler) {
+    cstr compilers[] = { "clang", "clang++", "gcc", "g++", "cc", "c++" };
+    for (cstr known : compilers) if (strcmp(compiler, known) == 0) return true;
+    return false;
+}
+
+// What a compiler of the worker is: the hash of what its --version says. Every compiler is only
+// asked once, a worker has to be restarted when one of them is upgraded.
+struct Compiler_Identity {
+    cstr compiler;
+    char hash[33];
+};
+static Mutex                   compilerIdentitiesLock;
+static List<Compiler_Identity> compilerIdentities { 0, nullptr, 0, crtAllocator };
+
+// The identity as a temporary string, nullptr if the compiler could not say what it is
+static cstr GetCompilerIdentity(cstr compiler, cstr workDir) {
+    Lock(&compilerIdentitiesLock);
+    NCZ_DEFER(Unlock(&compilerIdentitiesLock));
+    for (auto &known : compilerIdentities) if (strcmp(known.compiler, compiler) == 0) return TPrint(known.hash).data;
+    
+    cstr output = TempPathFor(SPrint(workDir, NCZ_PATH_SEP "version").data);
+    cstr args[] = { compiler, "--version" };
+    bool ran = RunCommandSync({ 2, args }, false, output);
+    Result<String> text = GetFileInfo(output).value.exists ? ReadFile(output) : Result<String> {};
+    remove(output);
+    if (!ran || !text.ok || !text.value.count) return nullptr;
+    Content_Hash hash {};
+    HashBytes(&hash, text.value);
+    Compiler_Identity identity {};
+    identity.compiler = static_cast<cstr>(Allocate(strlen(compiler) + 1, crtAllocator));
+    memcpy(const_cast<char*>(identity.compiler), compiler, strlen(compiler) + 1);
+    memcpy(identity.hash, HashName(hash), sizeof(identity.hash));
+    Push(&compilerIdentities, identity);
+    return TPrint(identity.hash).data;
+}
+
+// Runs the job that comes in over socket, false if it never got an answer
+static bool ServeCompile(Socket socket, cstr workDir) {
+    String version {}, compiler {}, flags {}, name {}, text {};
+    if (!ReceiveBlob(socket, &version)) return false;
+    if (strcmp(version.data, NCZ_COMPILE_PROTOCOL) != 0) {
+        LogError("A client speaks ", version.data, " instead of " NCZ_COMPILE_PROTOCOL);
+        return false;
+    }
+    if (!ReceiveBlob(socket, &compiler)) return false;
+    // NOTE: only a compiler by its plain name (what the PATH finds)
+    cstr identity = IsKnownCompiler(compiler.data) ? GetCompilerIdentity(compiler.data, workDir) : nullptr;
+    if (!identity) LogError("Refused to compile with ", compiler.data);
+    if (!SendBlob(socket, identity ? String{ strlen(identity), const_cast<char*>(identity) } : String {})) return false;
+    if (!identity) return true;
+    if (!ReceiveBlob(socket, &flags)) return false;
+    if (!flags.count) return true; // the client had it in its cache
+    if (!ReceiveBlob(socket, &name) || !ReceiveBlob(socket, &text)) return false;
+    
+    List<cstr> args {};
+    for (usize i = 0; i < flags.count; i += strlen(flags.data + i) + 1) Push(&args, static_cast<cstr>(flags.data + i));
+    // NOTE: the compiler it asked about, and a file name that stays in workDir
+    bool valid = args.count && strcmp(args[0], compiler.data) == 0 && IsSourceFile(name.data) && !strpbrk(name.data, "/\\:");
+    if (!valid) {
+        LogError("Refused a compile job for ", name.data, " with ", args.count ? args[0] : "no compiler");
+        return SendBlob(socket, "failed"_str) && SendBlob(socket, "the worker refused the job\n"_str) && SendBlob(socket, {});
+    }
+    
+    cstr job    = TempPathFor(SPrint(workDir, NCZ_PATH_SEP "job").data);
+    cstr source = SPrint(job, "-", name.data).data;
+    cstr object = SPrint(job, ".o").data;
+    cstr output = SPrint(job, ".log").data;
+    Append(&args, static_cast<cstr>("-c"), source, static_cast<cstr>("-o"), object);
+    bool ok = WriteFile(source, text) && RunCommandSync(args, false, output);
+    String log    = GetFileInfo(output).value.exists ? ReadFile(output).value : String {};
+    String result = {};
+    if (ok) {
+        auto [data, read] = ReadFile(object);
+        ok     = read;
+        result = data;
+    }
+    remove(source);
+    remove(object);
+    remove(output);
+    return SendBlob(socket, ok ? "ok"_str : "failed"_str) && SendBlob(socket, log) && SendBlob(socket, result);
+}
+
+struct Compile_Server {
+    Socket listener;
+    cstr   workDir;
+};
+
+static void RunCompileServer(void *data) {
+    auto server = static_cast<Compile_Server*>(data);
+    context.allocator = NCZ_TEMP;
+    for (;;) {
+        Reset(&context.temporaryStorage);
+        auto [socket, ok] = AcceptSocket(server->listener);
+        if (!ok) { SleepNs(10000000); continue; } // out of file descriptors, probably, give it a moment
+        ServeCompile(socket, server->workDir);
+        CloseSocket(socket);
+    }
+}
+
+bool ServeCompiles(cstr address, cstr workDir, u32 threads) {
+    if (!threads) threads = GetProcessorCount();
+    if (!CreateFolder(workDir)) return false;
+    auto [listener, ok] = ListenSocket(address);
+    if (!ok) return false;
+    LogInfo("serving compiles on ", address, ", ", static_cast<u64>(threads), " at a time");
+    
+    // NOTE: every thread waits in accept on the same socket, the kernel hands each connection to one
+    Compile_Server server { listener, workDir };
+    for (u32 t = 1; t < threads; ++t) {
+        if (!StartThread(RunCompileServer, &server).ok) return false;
+    }
+    RunCompileServer(&server);
+    return true;
+}
+#endif//NCZ_NO_CC
+
+#ifdef _WIN32
+// Stack Trace
+void LogStackTrace(usize skip) {
+    // Initialize symbols
+    SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+    SymInitialize(GetCurrentProcess(), NULL, TRUE);
+
+    // Get the current context
+    CONTEXT context;
+    RtlCaptureContext(&context);
+
+    STACKFRAME64 stackFrame;
+    memset(&stackFrame, 0, sizeof(STACKFRAME64));
+
+    DWORD machineType;
+#ifdef _M_IX86
+    machineType = IMAGE_FILE_MACHINE_I386;
+    stackFrame.AddrPC.Offset = context.Eip;
+    stackFrame.AddrPC.Mode = AddrModeFlat;
+    stackFrame.AddrFrame.Offset = context.Ebp;
+    stackFrame.AddrFrame.Mode = AddrModeFlat;
+    stackFrame.AddrStack.Offset = context.Esp;
+    stackFrame.AddrStack.Mode = AddrModeFlat;
+#elif _M_X64
+    machineType = IMAGE_FILE_MACHINE_AMD64;
+    stackFrame.AddrPC.Offset = context.Rip;
+    stackFrame.AddrPC.Mode = AddrModeFlat;
+    stackFrame.AddrFrame.Offset = context.Rsp;
+    stackFrame.AddrFrame.Mode = AddrModeFlat;
+    stackFrame.AddrStack.Offset = context.Rsp;
+    stackFrame.AddrStack.Mode = AddrModeFlat;
+#endif
+    
+    // TODO: Pool constructor
+    // auto mark = ::ncz::context.temporary_storage.mark;
+    // NCZ_DEFER(::ncz::context.temporary_storage.mark = mark);
+    
+    
+    String_Builder sb{};//(NCZ_TEMP);
+    sb.allocator = NCZ_TEMP;
+    Write(&sb, "Stack Trace:\n"_str);
+    
+    // Walk the stack
+    while (StackWalk64(machineType, GetCurrentProcess(), GetCurrentThread(), &stackFrame, &context, NULL, SymFunctionTableAccess64, SymGetModuleBase64, NULL)) {
+        if (skip--) continue;
+        
+        DWORD64 displacement = 0;
+        const int bufferSize = 1024;
+        char buffer[sizeof(SYMBOL_INFO) + bufferSize] = { 0 };
+        PSYMBOL_INFO symbol = (PSYMBOL_INFO)buffer;
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = bufferSize - sizeof(SYMBOL_INFO);
+
+        // Get symbol information
+        if (SymFromAddr(GetCurrentProcess(), stackFrame.AddrPC.Offset, &displacement, symbol)) {
+            IMAGEHLP_LINE64 line;
+            DWORD lineDisplacement;
+            line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+            // Get line information
+            if (SymGetLineFromAddr64(GetCurrentProcess(), stackFrame.AddrPC.Offset, &lineDisplacement, &line)) {
+                Print(&sb, line.FileName, ":", (u64) line.LineNumber-1, ": ");
+            } else {
+                Print(&sb, "unknown: ");
+            }
+            Print(&sb, symbol->Name, "\n");
+        } else {
+            Print(&sb, "unknown:\n");
+        }
+        
+        if (strcmp(symbol->Name, "main") == 0) break;
+    }
+    
+    LogEx(Log_Level::TRACE, Log_Type::INFO, sb);
+    
+    // Cleanup
+    SymCleanup(GetCurrentProcess());
+}
+
+// Multiprocessing
+// NOTE: has to happen before the handle is closed, the memory counters go with it
+static void RecordProcessExit(Process proc, DWORD exitCode) {
+    PROCESS_MEMORY_COUNTERS counters {};
+    counters.cb = sizeof(counters);
+    u64 peakRss = GetProcessMemoryInfo((HANDLE)proc, &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+    RecordProcessEnd(proc, static_cast<s64>(exitCode), peakRss);
+}
+
+bool Wait(Process proc) {
+    if (!proc) return false;
+    
+    // String_Builder output(NCZ_TEMP);
+    // DWORD bytesRead;
+    // CHAR buffer[4096];
+    // while (ReadFile(proc.output, buffer, sizeof(buffer) - 1, &bytesRead, NULL)) {
+    //     printf("read %lu\n", bytesRead);
+    //     buffer[bytesRead] = '\0';
+    //     output.append(Array<char> { buffer, bytesRead });
+    // }
+    // log(Array<char>{output.data, output.count});
+    
+    DWORD result = WaitForSingleObject((HANDLE)proc, INFINITE);
+    
+    if (result == WAIT_FAILED) {
+        LogError("could not wait on child process: ", (u64) GetLastError());
+        return false;
+    }
+
+    DWORD exit_status;
+    if (!GetExitCodeProcess((HANDLE)proc, &exit_status)) {
+        LogError("could not get process exit code: ", (u64) GetLastError());
+        return false;
+    }
+    RecordProcessExit(proc, exit_status);
+    CloseHandle((HANDLE)proc);
+    
+    if (exit_status != 0) {
+        LogError("command exited with exit code ", (u64) exit_status);
+        return false;
+    }
+    return true;
+}
+
+bool WaitAny(Array<Process> procs, usize *index) {
+    *index = procs.count;
+    if (!procs.count) return false;
+    // NOTE: WaitForMultipleObjects takes at most 64 handles, with more we go around in slices
+    for (usize first = 0;; first = first + MAXIMUM_WAIT_OBJECTS < procs.count ? first + MAXIMUM_WAIT_OBJECTS : 0) {
+        HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+        DWORD count = 0;
+        for (usize i = first; i < procs.count && count < MAXIMUM_WAIT_OBJECTS; ++i) handles[count++] = (HANDLE)procs[i];
+        DWORD timeout = procs.count > MAXIMUM_WAIT_OBJECTS ? 10 : INFINITE;
+        DWORD result  = WaitForMultipleObjects(count, handles, FALSE, timeout);
+        if (result == WAIT_TIMEOUT) continue;
+        if (result == WAIT_FAILED || result >= WAIT_OBJECT_0 + count) {
+            LogError("could not wait on child processes: ", (u64) GetLastError());
+            return false;
+        }
+        *index = first + (result - WAIT_OBJECT_0);
+        return Wait(procs[*index]); // it already exited, this only collects the exit code
+    }
+}
+
+bool SetEnvironment(cstr name, cstr value) {
+    if (!SetEnvironmentVariableA(name, value)) {
+        LogError("Could not set ", name, ": ", (u64) GetLastError());
+        return false;
+    }
+    return true;
+}
+
+cstr GetProgramPath(cstr argv0) {
+    char buffer[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, buffer, sizeof(buffer));
+    if (!length || length >= sizeof(buffer)) return argv0;
+    return SPrint(String{ length, buffer }).data;
+}
+
+bool Kill(Process proc) {
+    if (!proc) return false;
+    // NOTE: fails with access denied if the process already exited, which is fine by us
+    TerminateProcess((HANDLE)proc, 1);
+    bool ok = WaitForSingleObject((HANDLE)proc, INFINITE) != WAIT_FAILED;
+    if (!ok) LogError("could not wait on killed process: ", (u64) GetLastError());
+    DWORD exitCode = 1;
+    GetExitCodeProcess((HANDLE)proc, &exitCode);
+    RecordProcessExit(proc, exitCode);
+    CloseHandle((HANDLE)proc);
+    return ok;
+}
+
+Result<Process> RunCommandAsync(Array<cstr> args, bool trace, cstr outputPath) {
+
+    // // Create a pipe to capture the process's output
+    // HANDLE hRead, hWrite;
+    // SECURITY_ATTRIBUTES sa;
+    // sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+    // sa.lpSecurityDescriptor = NULL;
+    // sa.bInheritHandle = TRUE;
+    // if (!CreatePipe(&hRead, &hWrite, &sa, 0)) {
+    //     LogError("CreatePipe failed: ", (u64) GetLastError());
+    //     return {};
+    // }
+    
+    // https://docs.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
+    
+    STARTUPINFO siStartInfo;
+    ZeroMemory(&siStartInfo, sizeof(siStartInfo));
+    siStartInfo.cb = sizeof(STARTUPINFO);
+    // NOTE: theoretically setting NULL to std handles should not be a problem
+    // https://docs.microsoft.com/en-us/windows/console/getstdhandle?redirectedfrom=MSDN#attachdetach-behavior
+    // TODO: check for errors in GetStdHandle
+    siStartInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    siStartInfo.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    siStartInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+    
+    HANDLE output = INVALID_HANDLE_VALUE;
+    if (outputPath) {
+        SECURITY_ATTRIBUTES inherit { sizeof(inherit), NULL, TRUE };
+        output = CreateFileA(outputPath, GENERIC_WRITE, FILE_SHARE_READ, &inherit, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (output == INVALID_HANDLE_VALUE) {
+            LogError("Could not create ", outputPath, ": ", (u64) GetLastError());
+            return {};
+        }
+        siStartInfo.hStdOutput = output;
+        siStartInfo.hStdError  = output;
+    }
+    
+    PROCESS_INFORMATION piProcInfo;
+    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
+    
+    // TODO: Pool constructor
+    // auto mark = context.temporaryStorage.mark;
+        String_Builder sb{};//(NCZ_TEMP);
+        sb.allocator = NCZ_TEMP;
+        for (auto* it = args.data; it != args.data + args.count; it++) {
+            if (it != args.data) Push(&sb, ' ');
+            if (!strchr(*it, ' ')) {
+                Write(&sb, *it);
+            } else {
+                Push(&sb, '\"');
+                Write(&sb, *it);
+                Push(&sb, '\"');
+            }
+        }
+        Push(&sb, '\0');
+        if (trace) LogInfo(sb.data);
+        BOOL bSuccess = CreateProcessA(NULL, sb.data, NULL, NULL, TRUE, 0, NULL, NULL, &siStartInfo, &piProcInfo);
+    // context.temporaryStorage.mark = mark;
+    if (output != INVALID_HANDLE_VALUE) CloseHandle(output); // the child has its own copy
+    
+    if (!bSuccess) {
+        LogError("Could not create child process: ", (u64) GetLastError());
+        return {};
+    }
+    
+    CloseHandle(piProcInfo.hThread);
+    RecordJobStart((u64)piProcInfo.hProcess, args);
+    return (u64)piProcInfo.hProcess;
+}
+
+// Time
+u64 GetTimeNs() {
+    static LARGE_INTEGER frequency = {};
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    u64 seconds = counter.QuadPart / frequency.QuadPart;
+    u64 rest    = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000ull + rest * 1000000000ull / frequency.QuadPart;
+}
+
+void SleepNs(u64 ns) { ::Sleep(static_cast<DWORD>(ns / 1000000)); }
+
+// Threads
+struct Thread_Start { Thread_Proc proc; void *data; };
+static DWORD WINAPI ThreadTrampoline(LPVOID parameter) {
+    auto start = *static_cast<Thread_Start*>(parameter);
+    Dispose(parameter, crtAllocator);
+    start.proc(start.data);
+    return 0;
+}
+
+Result<Thread> StartThread(Thread_Proc proc, void *data) {
+    auto start = static_cast<Thread_Start*>(Allocate(sizeof(Thread_Start), crtAllocator));
+    *start = { proc, data };
+    HANDLE thread = CreateThread(NULL, 0, ThreadTrampoline, start, 0, NULL);
+    if (thread == NULL) {
+        LogError("Could not create thread: ", (u64) GetLastError());
+        Dispose(start, crtAllocator);
+        return {};
+    }
+    return (u64)thread;
+}
+
+bool JoinThread(Thread thread) {
+    if (WaitForSingleObject((HANDLE)thread, INFINITE) == WAIT_FAILED) {
+        LogError("Could not join thread: ", (u64) GetLastError());
+        return false;
+    }
+    CloseHandle((HANDLE)thread);
+    return true;
+}
+
+u32 GetProcessorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+// Synchronization
+void FutexWait(u32 *address, u32 expected) { WaitOnAddress(address, &expected, sizeof(expected), INFINITE); }
+void FutexWakeOne(u32 *address) { WakeByAddressSingle(address); }
+void FutexWakeAll(u32 *address) { WakeByAddressAll(address); }
+
+// Benchmarks
+// NOTE: windows only hands out processor counters to drivers, benchmarks measure the time
+bool OpenPerfCounters(Perf_Counters *counters) { *counters = {}; return false; }
+void ClosePerfCounters(Perf_Counters *) {}
+Perf_Sample ReadPerfCounters(Perf_Counters *) { return { GetTimeNs(), 0, 0, 0, 0, 0, 0 }; }
+
+// Sockets
+// NOTE: WSAStartup counts how often it was called, calling it for every socket is fine
+static bool StartSockets() {
+    WSADATA data;
+    int error = WSAStartup(MAKEWORD(2, 2), &data);
+    if (error) LogError("Could not start winsock: ", (u64) error);
+    return !error;
+}
+
+static Result<SOCKET> OpenSocket(int family, cstr address) {
+    SOCKET handle = WSASocketW(family, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_NO_HANDLE_INHERIT);
+    if (handle == INVALID_SOCKET) {
+        LogError("Could not create a socket for ", address, ": ", (u64) WSAGetLastError());
+        return {};
+    }
+    // NOTE: a message goes out in a few sends, without this the last one waits for the ack of the first
+    BOOL one = TRUE;
+    if (family != AF_UNIX) setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&one), sizeof(one));
+    return handle;
+}
+
+Result<Socket> ListenSocket(cstr address) {
+    sockaddr_storage addr; socklen_t size;
+    if (!StartSockets() || !ResolveSocketAddress(address, true, &addr, &size)) return {};
+    auto [handle, ok] = OpenSocket(addr.ss_family, address);
+    if (!ok) return {};
+    if (addr.ss_family == AF_UNIX) DeleteFileA(reinterpret_cast<sockaddr_un*>(&addr)->sun_path);
+    if (bind(handle, reinterpret_cast<sockaddr*>(&addr), size) == SOCKET_ERROR || listen(handle, SOMAXCONN) == SOCKET_ERROR) {
+        LogError("Could not listen on ", address, ": ", (u64) WSAGetLastError());
+        closesocket(handle);
+        return {};
+    }
+    return static_cast<Socket>(handle);
+}
+
+Result<Socket> AcceptSocket(Socket listener) {
+    SOCKET handle = accept(static_cast<SOCKET>(listener), nullptr, nullptr);
+    if (handle == INVALID_SOCKET) {
+        LogError("Could not accept a connection: ", (u64) WSAGetLastError());
+        return {};
+    }
+    BOOL one = TRUE;
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&one), sizeof(one));
+    return static_cast<Socket>(handle);
+}
+
+Result<Socket> ConnectSocket(cstr address) {
+    sockaddr_storage addr; socklen_t size;
+    if (!StartSockets() || !ResolveSocketAddress(address, false, &addr, &size)) return {};
+    auto [handle, ok] = OpenSocket(addr.ss_family, address);
+    if (!ok) return {};
+    if (connect(handle, reinterpret_cast<sockaddr*>(&addr), size) == SOCKET_ERROR) {
+        LogError("Could not connect to ", address, ": ", (u64) WSAGetLastError());
+        closesocket(handle);
+        return {};
+    }
+    return static_cast<Socket>(handle);
+}
+
+bool SendAll(Socket socket, String data) {
+    for (usize sent = 0; sent < data.count;) {
+        int chunk = static_cast<int>(data.count - sent < (1u << 30) ? data.count - sent : (1u << 30));
+        int n = send(static_cast<SOCKET>(socket), data.data + sent, chunk, 0);
+        if (n == SOCKET_ERROR) {
+            LogError("Could not send: ", (u64) WSAGetLastError());
+            return false;
+        }
+        sent += static_cast<usize>(n);
+    }
+    return true;
+}
+
+bool ReceiveAll(Socket socket, String buffer) {
+    for (usize received = 0; received < buffer.count;) {
+        int chunk = static_cast<int>(buffer.count - received < (1u << 30) ? buffer.count - received : (1u << 30));
+        int n = recv(static_cast<SOCKET>(socket), buffer.data + received, chunk, 0);
+        if (n == SOCKET_ERROR) {
+            LogError("Could not receive: ", (u64) WSAGetLastError());
+            return false;
+        }
+        if (n == 0) {
+            LogError("The connection was closed ", buffer.count - received, " bytes early");
+            return false;
+        }
+        received += static_cast<usize>(n);
+    }
+    return true;
+}
+
+void CloseSocket(Socket socket) { closesocket(static_cast<SOCKET>(socket)); }
+
+// Working With Files
+static s64 OpenFileHandle(cstr path, bool write, cstr replaces) {
+    // NOTE: windows has no mode bits, the attributes that say who sees the file are what is kept
+    DWORD attributes = replaces ? GetFileAttributesA(replaces) : INVALID_FILE_ATTRIBUTES;
+    attributes = attributes == INVALID_FILE_ATTRIBUTES ? FILE_ATTRIBUTE_NORMAL
+               : attributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_NOT_CONTENT_INDEXED);
+    if (!attributes) attributes = FILE_ATTRIBUTE_NORMAL;
+    HANDLE handle = write
+        ? CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, attributes, NULL)
+        : CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        LogError("Could not open ", path, ": ", (u64) GetLastError());
+        return -1;
+    }
+    return (s64)handle;
+}
+
+static void CloseFileHandle(s64 handle) { CloseHandle((HANDLE)handle); }
+
+static u64 CurrentProcessId() { return GetCurrentProcessId(); }
+
+static bool WriteToHandle(s64 handle, cstr path, const char *data, usize size) {
+    while (size > 0) {
+        DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size, n = 0;
+        if (!::WriteFile((HANDLE)handle, data, chunk, &n, NULL)) {
+            LogError("Could not write data to ", path, ": ", (u64) GetLastError());
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool WriteToHandle(s64 handle, cstr path, Array<String> pieces) {
+    // NOTE: WriteFileGather only takes whole, page aligned pages of an unbuffered file
+    for (String piece : pieces) {
+        if (!WriteToHandle(handle, path, piece.data, piece.count)) return false;
+    }
+    return true;
+}
+
+static bool SyncFileHandle(s64 handle, cstr path) {
+    if (!FlushFileBuffers((HANDLE)handle)) {
+        LogError("Could not flush ", path, " to the disk: ", (u64) GetLastError());
+        return false;
+    }
+    return true;
+}
+
+static Result<usize> ReadFromHandle(s64 handle, cstr path, char *data, usize size) {
+    DWORD n = 0;
+    if (!::ReadFile((HANDLE)handle, data, size > 0x40000000 ? 0x40000000 : (DWORD)size, &n, NULL)) {
+        LogError("Could not read file ", path, ": ", (u64) GetLastError());
+        return {};
+    }
+    return static_cast<usize>(n);
+}
+
+static Result<bool> CopyHandleFast(s64, s64, u64 *) { return false; }
+
+Result<String> MapFile(cstr path, bool copyOnWrite) {
+    s64 file = OpenFileHandle(path, false);
+    if (file == -1) return {};
+    NCZ_DEFER(CloseFileHandle(file));
+    
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx((HANDLE)file, &size)) {
+        LogError("Could not get the size of ", path, ": ", (u64) GetLastError());
+        return {};
+    }
+    if (!size.QuadPart) return String{};
+    
+    // NOTE: the view keeps the mapping (and the file) alive, both handles can go right away
+    HANDLE mapping = CreateFileMappingA((HANDLE)file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        LogError("Could not map ", path, ": ", (u64) GetLastError());
+        return {};
+    }
+    NCZ_DEFER(CloseHandle(mapping));
+    void *data = MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        LogError("Could not map ", path, ": ", (u64) GetLastError());
+        return {};
+    }
+    return String{ static_cast<usize>(size.QuadPart), static_cast<char*>(data) };
+}
+
+void Unmap(String mapped) {
+    if (mapped.data) UnmapViewOfFile(mapped.data);
+}
+
+#ifndef NCZ_NO_CC
+static cstr FindExecutable(cstr name) {
+    char buffer[MAX_PATH];
+    DWORD n = SearchPathA(NULL, name, ".exe", sizeof(buffer), buffer, NULL);
+    if (!n || n >= sizeof(buffer)) return nullptr;
+    return TPrint(String{ n, buffer }).data;
+}
+
+static void ReplaceProcess(cstr path, Array<cstr> args) {
+    // NOTE: windows has no exec, _execv starts a new process and ends this one, which makes the
+    // console think we are done. So we wait for the new one and exit with its result.
+    List<cstr> argv {}; argv.allocator = NCZ_TEMP;
+    Push(&argv, path);
+    for (usize i = 1; i < args.count; ++i) Push(&argv, args[i]);
+    exit(RunCommandSync(argv) ? 0 : 1);
+}
+#endif//NCZ_NO_CC
+
+bool RenameFile(cstr old_path, cstr new_path) {
+    // TODO: make these logs trace or verbose
+    LogEx(Log_Level::TRACE, Log_Type::INFO, "[rename] ", old_path, " -> ", new_path);
+    ForgetFileInfo(old_path);
+    ForgetFileInfo(new_path);
+     if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
+        // LogError("Could not rename "_str, old_path, ": "_str, os_get_error());
+        // return false;
+        
+        char buf[256];
+        memset(buf, 0, sizeof(buf));
+        FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                       NULL, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), 
+                       buf, (sizeof(buf) / sizeof(char)), NULL);
+        
+        String str { strlen(buf), buf };
+
+        if (str[str.count-1] == '\n') str.count -= 1;
+        LogEx(Log_Level::NORMAL, Log_Type::ERRO, "Could not rename ", old_path, ": ", str);
+        return false;
+    }
+    return true;
+}
+
+static String GetErrorString() {
+    auto errorCode = GetLastError();
+    
+    // Returns a string in temporary storage.
+    wchar_t *lpMsgBuf;
+    bool success = FormatMessageW(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER |
+           FORMAT_MESSAGE_FROM_SYSTEM  |
+           FORMAT_MESSAGE_IGNORE_INSERTS,
+        nullptr, errorCode,
+        MAKELANGID(LANG_NEUTRAL,SUBLANG_DEFAULT), // Default language
+        (wchar_t*)&lpMsgBuf, 0, nullptr
+    );
+    if (!success) return ""_str;
+    NCZ_DEFER(LocalFree(lpMsgBuf));
+
+    
+    // result := Utf8.wide_to_utf8_new(lpMsgBuf,, Basic.temp);
+    auto queryResult = WideCharToMultiByte(CP_UTF8, 0,
+                                            lpMsgBuf, -1,
+                                            nullptr, 0,
+                                            nullptr, nullptr);
+    if (queryResult <= 0) return ""_str;
+
+    String name;
+    auto nameBytes = static_cast<char*>(Allocate(queryResult));
+    auto result    = WideCharToMultiByte(CP_UTF8, 0, lpMsgBuf, -1, nameBytes, queryResult, nullptr, nullptr);
+    if (result <= 0) return ""_str;
+    NCZ_ASSERT(result <= queryResult);
+    
+    name.data  = nameBytes;
+    name.count = result-1; // Returned length DOES include null character if we passed in a null-terminated string!
+    
+    usize trimmedCount = name.count;
+    for (usize i = name.count; i >= 0; --i) {
+        if (name.data[i] == '\r' || name.data[i] == '\n') trimmedCount -= 1;
+        else break;
+    }
+    
+    // Chop off the newline so that we can format this standardly. Argh.
+    return {trimmedCount, name.data};
+}
+
+static bool CommitTempFile(cstr tempPath, cstr path, bool durable) {
+    ForgetFileInfo(path);
+    DWORD flags = MOVEFILE_REPLACE_EXISTING | (durable ? MOVEFILE_WRITE_THROUGH : 0);
+    if (MoveFileExA(tempPath, path, flags)) return true;
+    // NOTE: a running executable (like a script that reloads itself) can not be replaced,
+    // but it can be moved out of the way
+    if (GetLastError() == ERROR_ACCESS_DENIED) {
+        cstr old = TPrint(path, ".old").data;
+        if (MoveFileExA(path, old, MOVEFILE_REPLACE_EXISTING) && MoveFileExA(tempPath, path, flags)) return true;
+    }
+    LogError("Could not rename ", tempPath, " to ", path, ": ", GetErrorString());
+    return false;
+}
+
+Result<Array<cstr>> ReadFolder(cstr parent) {
+    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+    List<cstr> children {};
+    
+    // cstr search_path = Concat(parent, "\\*"); // Append wildcard to parent path
+    cstr search_path = TPrint(parent, "\\*"_str).data;
+    WIN32_FIND_DATA ffd;
+    HANDLE hFind = FindFirstFile(search_path, &ffd);
+    if (INVALID_HANDLE_VALUE == hFind) {
+        LogError("Could not open folder ", parent, ": ", GetErrorString());
+        return {};
+    }
+    NCZ_DEFER(FindClose(hFind));
+
+    do Push(&children, CopyCstr(ffd.cFileName));
+    while (FindNextFile(hFind, &ffd) != 0);
+
+    if (GetLastError() != ERROR_NO_MORE_FILES) {
+        LogError("Could not read folder ", parent, ": ", GetErrorString());
+        return {};
+    }
+
+    return children;
+}
+
+static bool StatFiles(Array<cstr> paths, File_Info *infos) {
+    for (usize i = 0; i < paths.count; ++i) {
+        cstr path = paths.data[i];
+        infos[i]  = {};
+        WIN32_FILE_ATTRIBUTE_DATA wfad;
+        if (!GetFileAttributesEx(path, GetFileExInfoStandard, &wfad)) {
+            auto error = GetLastError();
+            // NOTE: a missing file is a perfectly good answer
+            if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) continue;
+            LogError("Could not get attributes of ", path, ": ", GetErrorString());
+            return false;
+        }
+        
+        // FILETIME counts 100ns intervals since 1601
+        u64 time = (static_cast<u64>(wfad.ftLastWriteTime.dwHighDateTime) << 32) | wfad.ftLastWriteTime.dwLowDateTime;
+        infos[i].exists = true;
+        infos[i].size   = (static_cast<u64>(wfad.nFileSizeHigh) << 32) | wfad.nFileSizeLow;
+        infos[i].mtime  = (time - 116444736000000000ull) * 100;
+        if (wfad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            infos[i].type = File_Type::FOLDER;
+        else if (wfad.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            infos[i].type = File_Type::LINK;
+        else
+            infos[i].type = File_Type::FILE;
+    }
+    return true;
+}
+
+struct Walker {
+    Walk_Options options = {};
+    usize        rootLen = 0;
+};
+
+// NOTE: FindFirstFile already gives us the attributes of every entry, so no extra stat calls are
+// needed here either. Windows does not get the threaded walk, the order is always depth first.
+static bool WalkFolderAt(Walk_Worker *worker, String_Builder *path) {
+    auto walker = worker->walker;
+    usize base  = path->count;
+    Print(path, NCZ_PATH_SEP "*");
+    Push(path, '\0');
+    
+    WIN32_FIND_DATA ffd;
+    HANDLE hFind = FindFirstFile(path->data, &ffd);
+    if (INVALID_HANDLE_VALUE == hFind) {
+        path->count = base; Push(path, '\0');
+        LogError("Could not open folder ", path->data, ": ", GetErrorString());
+        return false;
+    }
+    NCZ_DEFER(FindClose(hFind));
+    
+    do {
+        if (strcmp(".", ffd.cFileName) == 0 || strcmp("..", ffd.cFileName) == 0) continue;
+        path->count = base;
+        Print(path, NCZ_PATH_SEP, ffd.cFileName);
+        Push(path, '\0');
+        path->count -= 1;
+        
+        File_Type type = File_Type::FILE;
+        if      (ffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) type = File_Type::LINK;
+        else if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)     type = File_Type::FOLDER;
+        
+        bool report = false;
+        String relativePath { path->count - walker->rootLen, path->data + walker->rootLen };
+        if (!FilterWalkEntry(&walker->options, relativePath, &report)) continue;
+        if (report) Push(&worker->entries, { CopyString({path->count, path->data}), type });
+        if (type == File_Type::FOLDER && !WalkFolderAt(worker, path)) return false;
+    } while (FindNextFile(hFind, &ffd) != 0);
+    
+    if (GetLastError() != ERROR_NO_MORE_FILES) {
+        path->count = base; Push(path, '\0');
+        LogError("Could not read folder ", path->data, ": ", GetErrorString());
+        return false;
+    }
+    
+    path->count = base;
+    return true;
+}
+
+Result<Array<Walk_Entry>> WalkFolder(cstr root, Walk_Options options) {
+    Walker walker {};
+    walker.options = options;
+    
+    Walk_Worker worker {};
+    worker.walker = &walker;
+    worker.entries.allocator = { PoolAllocatorProc, &worker.pool };
+    {
+        NCZ_PUSH_STATE(context.allocator, (Allocator{ PoolAllocatorProc, &worker.pool }));
+        String_Builder path {};
+        Write(&path, root);
+        while (path.count > 1 && IsPathSep(path.data[path.count-1])) --path.count;
+        walker.rootLen = path.count + 1;
+        worker.ok = WalkFolderAt(&worker, &path);
+    }
+    return CollectWalkEntries(&worker, 1);
+}
+
+#else // POSIX
+// Stack Trace
+void LogStackTrace(usize skip) {
+#if defined(__GLIBC__) || defined(__APPLE__)
+    void *frames[64];
+    int count = backtrace(frames, sizeof(frames)/sizeof(frames[0]));
+    char **symbols = backtrace_symbols(frames, count);
+    if (symbols == nullptr) return;
+    NCZ_DEFER(free(symbols));
+    
+    String_Builder sb{};
+    sb.allocator = NCZ_TEMP;
+    Write(&sb, "Stack Trace:\n"_str);
+    for (int i = static_cast<int>(skip); i < count; ++i) Print(&sb, symbols[i], "\n");
+    LogEx(Log_Level::TRACE, Log_Type::INFO, sb);
+#else
+    (void) skip;
+#endif
+}
+
+// Multiprocessing
+// NOTE: wait4 is waitpid that also tells how much memory the child used at most
+static void RecordProcessExit(Process proc, int wstatus, struct rusage *usage) {
+#ifdef __APPLE__
+    u64 peakRss = static_cast<u64>(usage->ru_maxrss);        // bytes
+#else
+    u64 peakRss = static_cast<u64>(usage->ru_maxrss) * 1024; // kilobytes
+#endif
+    if (WIFEXITED(wstatus))   RecordProcessEnd(proc, WEXITSTATUS(wstatus), peakRss);
+    if (WIFSIGNALED(wstatus)) RecordProcessEnd(proc, -WTERMSIG(wstatus), peakRss);
+}
+
+bool Wait(Process proc) {
+    for (;;) {
+        int wstatus = 0;
+        struct rusage usage {};
+        if (wait4(static_cast<pid_t>(proc), &wstatus, 0, &usage) < 0) {
+            LogError("could not wait on command "_str, proc, strerror(errno));
+            return false;
+        }
+        RecordProcessExit(proc, wstatus, &usage);
+
+        if (WIFEXITED(wstatus)) {
+            int exit_status = WEXITSTATUS(wstatus);
+            if (exit_status != 0) {
+                LogError("command exited with exit code ", exit_status);
+                return false;
+            }
+
+            break;
+        }
+
+        if (WIFSIGNALED(wstatus)) {
+            LogError("command process was terminated by ", strsignal(WTERMSIG(wstatus)));
+            return false;
+        }
+    }
+    return true;
+}
+
+// NOTE: waitpid(-1) would also reap children that are not ours to reap (like the game that
+// build.cpp --watch --restart keeps running), so we poll the ones we were given instead.
+// Commands take milliseconds at the very least, checking every few hundred microseconds is plenty.
+bool WaitAny(Array<Process> procs, usize *index) {
+    *index = procs.count;
+    if (!procs.count) return false;
+    for (u64 sleep = 50000;; sleep = sleep < 2000000 ? 2 * sleep : sleep) {
+        for (usize i = 0; i < procs.count; ++i) {
+            int wstatus = 0;
+            struct rusage usage {};
+            pid_t pid = wait4(static_cast<pid_t>(procs[i]), &wstatus, WNOHANG, &usage);
+            if (pid == 0 || (pid < 0 && errno == EINTR)) continue;
+            *index = i;
+            if (pid < 0) {
+                LogError("could not wait on command ", procs[i], ": ", strerror(errno));
+                return false;
+            }
+            RecordProcessExit(procs[i], wstatus, &usage);
+            if (WIFSIGNALED(wstatus)) {
+                LogError("command process was terminated by ", strsignal(WTERMSIG(wstatus)));
+                return false;
+            }
+            if (WEXITSTATUS(wstatus) != 0) {
+                LogError("command exited with exit code ", WEXITSTATUS(wstatus));
+                return false;
+            }
             return true;
-        } else {
-            error_string.count = FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, error_id, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&error_string.data, 0, NULL) - 1;
-            LogError(NCZ_HERE, " ", "Could not open file ", output_path, ": (", error_id, ") ", error_string);
-            LocalFree(error_string.data);
+        }
+        SleepNs(sleep);
+    }
+}
+
+bool SetEnvironment(cstr name, cstr value) {
+    if ((value ? setenv(name, value, 1) : unsetenv(name)) < 0) {
+        LogError("Could not set ", name, ": ", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool Kill(Process proc) {
+    if (kill(static_cast<pid_t>(proc), SIGTERM) < 0 && errno != ESRCH) {
+        LogError("could not kill process ", proc, ": ", strerror(errno));
+        return false;
+    }
+    int wstatus = 0;
+    struct rusage usage {};
+    while (wait4(static_cast<pid_t>(proc), &wstatus, 0, &usage) < 0) {
+        if (errno == EINTR) continue;
+        LogError("could not wait on killed process ", proc, ": ", strerror(errno));
+        return false;
+    }
+    RecordProcessExit(proc, wstatus, &usage);
+    return true;
+}
+
+Result<Process> RunCommandAsync(Array<cstr> args, bool trace, cstr outputPath) {
+    pid_t cpid = fork();
+    if (cpid < 0) {
+        LogError("Could not fork child process: ", strerror(errno));
+        return {};
+    }
+    
+    if (cpid == 0) {
+        List<cstr> cmd {};
+        String_Builder sb {};
+        
+        for (auto it : args) {
+            Push(&cmd, it);
+            if (!strchr(it, ' ')) {
+                Write(&sb, it);
+            } else {
+                Push(&sb, '\"');
+                Write(&sb, it);
+                Push(&sb, '\"');
+            }
+            Push(&sb, ' ');
+        }
+        Push(&cmd, (cstr) nullptr);
+        
+        if (trace) Log(sb.data);
+        if (outputPath) {
+            int fd = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0 || dup2(fd, STDERR_FILENO) < 0) {
+                LogError("Could not redirect the output to ", outputPath, ": ", strerror(errno));
+                exit(1);
+            }
+            close(fd);
+        }
+    
+        if (execvp(cmd.data[0], (char * const*) cmd.data) < 0) {
+            LogError("Could not exec child process: ", strerror(errno));
+            exit(1);
+        }
+        NCZ_ASSERT(0 && "unreachable");
+    }
+    
+    RecordJobStart(static_cast<Process>(cpid), args);
+    return {static_cast<unsigned long>(cpid)};
+}
+
+// Time
+u64 GetTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<u64>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void SleepNs(u64 ns) {
+    struct timespec ts { static_cast<time_t>(ns / 1000000000ull), static_cast<long>(ns % 1000000000ull) };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {}
+}
+
+// Threads
+struct Thread_Start { Thread_Proc proc; void *data; };
+static void *ThreadTrampoline(void *parameter) {
+    auto start = *static_cast<Thread_Start*>(parameter);
+    Dispose(parameter, crtAllocator);
+    start.proc(start.data);
+    return nullptr;
+}
+
+Result<Thread> StartThread(Thread_Proc proc, void *data) {
+    auto start = static_cast<Thread_Start*>(Allocate(sizeof(Thread_Start), crtAllocator));
+    *start = { proc, data };
+    pthread_t thread;
+    int error = pthread_create(&thread, nullptr, ThreadTrampoline, start);
+    if (error) {
+        LogError("Could not create thread: ", strerror(error));
+        Dispose(start, crtAllocator);
+        return {};
+    }
+    return (u64)thread;
+}
+
+bool JoinThread(Thread thread) {
+    int error = pthread_join((pthread_t)thread, nullptr);
+    if (error) {
+        LogError("Could not join thread: ", strerror(error));
+        return false;
+    }
+    return true;
+}
+
+u32 GetProcessorCount() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? static_cast<u32>(n) : 1;
+}
+
+// Synchronization
+#ifdef __linux__
+void FutexWait(u32 *address, u32 expected) {
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+void FutexWakeOne(u32 *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+void FutexWakeAll(u32 *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 0x7fffffff, nullptr, nullptr, 0);
+}
+#else
+// NOTE: there is no public futex outside of linux, a short nap does the job too
+void FutexWait(u32 *address, u32 expected) {
+    if (__atomic_load_n(address, __ATOMIC_ACQUIRE) == expected) SleepNs(100000);
+}
+void FutexWakeOne(u32 *) {}
+void FutexWakeAll(u32 *) {}
+#endif//__linux__
+
+// Benchmarks
+#ifdef __linux__
+bool OpenPerfCounters(Perf_Counters *counters) {
+    *counters = {};
+    u64 configs[] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    s32 leader = -1;
+    for (usize i = 0; i < 4; ++i) {
+        perf_event_attr attr {};
+        attr.size           = sizeof(attr);
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.config         = configs[i];
+        attr.exclude_kernel = 1; // all that perf_event_paranoid 2 allows, and the kernel is not what we measure
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // NOTE: pid 0 and cpu -1 is this thread on whatever processor it runs
+        counters->fds[i] = static_cast<s32>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+        if (counters->fds[i] >= 0 && leader < 0) leader = counters->fds[i];
+    }
+    return leader >= 0;
+}
+
+void ClosePerfCounters(Perf_Counters *counters) {
+    for (s32 fd : counters->fds) if (fd >= 0) close(fd);
+    *counters = {};
+}
+
+// NOTE: the group is read in one go: how many there are, how long the group was enabled and
+// how long it actually counted (less when more counters were asked for than the processor has,
+// then they take turns, Subtract scales them up), then the counts in the order they were opened
+Perf_Sample ReadPerfCounters(Perf_Counters *counters) {
+    Perf_Sample sample { GetTimeNs(), 0, 0, 0, 0, 0, 0 };
+    s32 leader = -1;
+    for (s32 fd : counters->fds) if (fd >= 0) { leader = fd; break; }
+    if (leader < 0) return sample;
+    u64 data[3 + 4];
+    if (read(leader, data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(u64))) return sample;
+    sample.enabled = data[1];
+    sample.running = data[2];
+    u64 *fields[] = { &sample.cycles, &sample.instructions, &sample.cacheMisses, &sample.branchMisses };
+    for (usize i = 0, n = 0; i < 4 && n < data[0]; ++i) {
+        if (counters->fds[i] >= 0) *fields[i] = data[3 + n++];
+    }
+    return sample;
+}
+#else
+bool OpenPerfCounters(Perf_Counters *counters) { *counters = {}; return false; }
+void ClosePerfCounters(Perf_Counters *) {}
+Perf_Sample ReadPerfCounters(Perf_Counters *) { return { GetTimeNs(), 0, 0, 0, 0, 0, 0 }; }
+#endif//__linux__
+
+// Sockets
+static Result<int> OpenSocket(int family, cstr address) {
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LogError("Could not create a socket for ", address, ": ", strerror(errno));
+        return {};
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC); // the compilers a worker runs have no business with its sockets
+#ifdef SO_NOSIGPIPE
+    int noSigpipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+    // NOTE: a message goes out in a few sends, without this the last one waits for the ack of the first
+    int one = 1;
+    if (family != AF_UNIX) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+Result<Socket> ListenSocket(cstr address) {
+    sockaddr_storage addr; socklen_t size;
+    if (!ResolveSocketAddress(address, true, &addr, &size)) return {};
+    auto [fd, ok] = OpenSocket(addr.ss_family, address);
+    if (!ok) return {};
+    int one = 1;
+    if (addr.ss_family == AF_UNIX) unlink(reinterpret_cast<sockaddr_un*>(&addr)->sun_path);
+    else setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), size) < 0 || listen(fd, SOMAXCONN) < 0) {
+        LogError("Could not listen on ", address, ": ", strerror(errno));
+        close(fd);
+        return {};
+    }
+    return static_cast<Socket>(fd);
+}
+
+Result<Socket> AcceptSocket(Socket listener) {
+    int fd;
+    while ((fd = accept(static_cast<int>(listener), nullptr, nullptr)) < 0 && errno == EINTR) {}
+    if (fd < 0) {
+        LogError("Could not accept a connection: ", strerror(errno));
+        return {};
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int noSigpipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // fails on unix sockets, which is fine
+    return static_cast<Socket>(fd);
+}
+
+Result<Socket> ConnectSocket(cstr address) {
+    sockaddr_storage addr; socklen_t size;
+    if (!ResolveSocketAddress(address, false, &addr, &size)) return {};
+    auto [fd, ok] = OpenSocket(addr.ss_family, address);
+    if (!ok) return {};
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), size) < 0) {
+        LogError("Could not connect to ", address, ": ", strerror(errno));
+        close(fd);
+        return {};
+    }
+    return static_cast<Socket>(fd);
+}
+
+bool SendAll(Socket socket, String data) {
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL; // a worker that went away is an error, not a reason to die of SIGPIPE
+#else
+    int flags = 0;            // SO_NOSIGPIPE is set on the socket instead
+#endif
+    for (usize sent = 0; sent < data.count;) {
+        ssize_t n = send(static_cast<int>(socket), data.data + sent, data.count - sent, flags);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LogError("Could not send: ", strerror(errno));
+            return false;
+        }
+        sent += static_cast<usize>(n);
+    }
+    return true;
+}
+
+bool ReceiveAll(Socket socket, String buffer) {
+    for (usize received = 0; received < buffer.count;) {
+        ssize_t n = recv(static_cast<int>(socket), buffer.data + received, buffer.count - received, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LogError("Could not receive: ", strerror(errno));
+            return false;
+        }
+        if (n == 0) {
+            LogError("The connection was closed ", buffer.count - received, " bytes early");
+            return false;
+        }
+        received += static_cast<usize>(n);
+    }
+    return true;
+}
+
+void CloseSocket(Socket socket) { close(static_cast<int>(socket)); }
+
+// Working with files
+static File_Type FileTypeFromMode(u32 mode) {
+    switch (mode & S_IFMT) {
+    case S_IFDIR:  return File_Type::FOLDER;
+    case S_IFREG:  return File_Type::FILE;
+    case S_IFLNK:  return File_Type::LINK;
+    default:       return File_Type::OTHER;
+    }
+}
+
+// Stats name relative to the open folder folderFd, following links just like stat() would
+static bool StatFileAt(int folderFd, cstr name, cstr path, File_Info *info) {
+    *info = {};
+#if defined(__linux__) && defined(STATX_TYPE)
+    // NOTE: statx lets us ask for only the fields we care about, which saves the
+    // kernel some work on file systems where the rest is expensive to compute
+    struct statx stx;
+    if (statx(folderFd, name, 0, STATX_TYPE | STATX_MTIME | STATX_SIZE, &stx) < 0) {
+        if (errno == ENOENT || errno == ENOTDIR) return true;
+        LogError("Could not stat ", path, ": ", strerror(errno));
+        return false;
+    }
+    info->type  = FileTypeFromMode(stx.stx_mode);
+    info->size  = stx.stx_size;
+    info->mtime = static_cast<u64>(stx.stx_mtime.tv_sec) * 1000000000ull + stx.stx_mtime.tv_nsec;
+#else
+    struct stat statbuf;
+    if (fstatat(folderFd, name, &statbuf, 0) < 0) {
+        if (errno == ENOENT || errno == ENOTDIR) return true;
+        LogError("Could not stat ", path, ": ", strerror(errno));
+        return false;
+    }
+    #ifdef __APPLE__
+    auto mtime = statbuf.st_mtimespec;
+    #else
+    auto mtime = statbuf.st_mtim;
+    #endif
+    info->type  = FileTypeFromMode(statbuf.st_mode);
+    info->size  = statbuf.st_size;
+    info->mtime = static_cast<u64>(mtime.tv_sec) * 1000000000ull + mtime.tv_nsec;
+#endif
+    info->exists = true;
+    return true;
+}
+
+static bool StatFiles(Array<cstr> paths, File_Info *infos) {
+    // Consecutive paths in the same folder share one open folder handle, so the
+    // kernel only has to resolve the folder part of the path once per batch.
+    char folder[4096] = {};
+    int  folderFd     = AT_FDCWD;
+    NCZ_DEFER(if (folderFd != AT_FDCWD) close(folderFd));
+    
+    for (usize i = 0; i < paths.count; ++i) {
+        cstr path  = paths.data[i];
+        cstr slash = strrchr(path, '/');
+        usize len  = slash ? static_cast<usize>(slash - path) : 0;
+        
+        if (len == 0 || len >= sizeof(folder)) {
+            // no folder part (or a ridiculously long one), just stat the whole path
+            if (!StatFileAt(AT_FDCWD, path, path, &infos[i])) return false;
+            continue;
+        }
+        
+        if (folderFd == AT_FDCWD || strncmp(folder, path, len) != 0 || folder[len] != '\0') {
+            if (folderFd != AT_FDCWD) close(folderFd);
+            memcpy(folder, path, len);
+            folder[len] = '\0';
+            folderFd = open(folder, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (folderFd < 0) {
+                folderFd = AT_FDCWD;
+                folder[0] = '\0';
+                // the folder does not exist so neither does the file, anything else we report
+                if (errno != ENOENT && errno != ENOTDIR) {
+                    LogError("Could not open folder of ", path, ": ", strerror(errno));
+                    return false;
+                }
+                infos[i] = {};
+                continue;
+            }
+        }
+        
+        if (!StatFileAt(folderFd, slash + 1, path, &infos[i])) return false;
+    }
+    return true;
+}
+
+struct Walker {
+    Walk_Options    options  = {};
+    usize           rootLen  = 0;
+    u32             threads  = 1;
+    
+    // everything below is shared between the threads and guarded by lock,
+    // except idle which other threads peek at to decide if they should share work
+    pthread_mutex_t lock     = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t  wake     = PTHREAD_COND_INITIALIZER;
+    List<String>    pending  = {};
+    u32             idle     = 0;
+    bool            done     = false;
+    bool            failed   = false;
+};
+
+struct Walk_Child { cstr name; File_Type type; };
+
+static File_Type FileTypeFromDirent(u8 type) {
+    switch (type) {
+    case DT_DIR: return File_Type::FOLDER;
+    case DT_REG: return File_Type::FILE;
+    case DT_LNK: return File_Type::LINK;
+    default:     return File_Type::OTHER;
+    }
+}
+
+// Reads the names and types of everything in the folder fd into the worker's pool
+// NOTE: noinline, its 32 KB buffer would otherwise be in every frame of the recursive WalkFolderAt
+__attribute__((noinline)) static bool ReadWalkChildren(int fd, cstr path, List<Walk_Child> *children, bool *needsStat) {
+#ifdef __linux__
+    // NOTE: glibc's readdir does the same thing with a smaller buffer and an allocation per folder
+    struct Linux_Dirent64 {
+        u64  d_ino;
+        s64  d_off;
+        u16  d_reclen;
+        u8   d_type;
+        char d_name[1];
+    };
+    alignas(8) char buffer[32 * 1024];
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            LogError("Could not read folder ", path, ": ", strerror(errno));
+            return false;
+        }
+        if (n == 0) break;
+        for (long offset = 0; offset < n;) {
+            auto ent = reinterpret_cast<Linux_Dirent64*>(buffer + offset);
+            offset  += ent->d_reclen;
+            if (strcmp(".", ent->d_name) == 0 || strcmp("..", ent->d_name) == 0) continue;
+            if (ent->d_type == DT_UNKNOWN) *needsStat = true;
+            Push(children, { CopyCstr(ent->d_name), FileTypeFromDirent(ent->d_type) });
+        }
+    }
+#else
+    int copy = dup(fd);
+    DIR *dir = copy < 0 ? nullptr : fdopendir(copy);
+    if (dir == nullptr) {
+        if (copy >= 0) close(copy);
+        LogError("Could not open folder ", path, ": ", strerror(errno));
+        return false;
+    }
+    NCZ_DEFER(closedir(dir));
+    
+    errno = 0;
+    for (struct dirent *ent = readdir(dir); ent != nullptr; ent = readdir(dir)) {
+        if (strcmp(".", ent->d_name) == 0 || strcmp("..", ent->d_name) == 0) continue;
+        if (ent->d_type == DT_UNKNOWN) *needsStat = true;
+        Push(children, { CopyCstr(ent->d_name), FileTypeFromDirent(ent->d_type) });
+    }
+    if (errno != 0) {
+        LogError("Could not read folder ", path, ": ", strerror(errno));
+        return false;
+    }
+#endif//__linux__
+    return true;
+}
+
+// Walks the folder fd (which it closes), path holds the folder's path and is restored on return
+static bool WalkFolderAt(Walk_Worker *worker, int fd, String_Builder *path) {
+    NCZ_DEFER(close(fd));
+    auto walker = worker->walker;
+    
+    List<Walk_Child> children {};
+    bool needsStat = false;
+    if (!ReadWalkChildren(fd, path->data, &children, &needsStat)) return false;
+    
+    usize base = path->count;
+    for (auto child : children) {
+        if (__atomic_load_n(&walker->failed, __ATOMIC_RELAXED)) return false;
+        
+        path->count = base;
+        Print(path, NCZ_PATH_SEP, child.name);
+        Push(path, '\0');
+        path->count -= 1;
+        
+        if (needsStat && child.type == File_Type::OTHER) {
+            // some file systems don't fill in d_type, so we have to ask
+            struct stat statbuf;
+            if (fstatat(fd, child.name, &statbuf, AT_SYMLINK_NOFOLLOW) < 0) {
+                LogError("Could not stat ", path->data, ": ", strerror(errno));
+                return false;
+            }
+            child.type = FileTypeFromMode(statbuf.st_mode);
+        }
+        
+        bool report = false;
+        String relativePath { path->count - walker->rootLen, path->data + walker->rootLen };
+        if (!FilterWalkEntry(&walker->options, relativePath, &report)) continue;
+        if (report) Push(&worker->entries, { CopyString({path->count, path->data}), child.type });
+        if (child.type != File_Type::FOLDER) continue;
+        
+        if (walker->threads > 1 && __atomic_load_n(&walker->idle, __ATOMIC_RELAXED) > 0) {
+            // someone is bored, let them have this folder
+            String copy = CopyString({path->count, path->data});
+            pthread_mutex_lock(&walker->lock);
+                Push(&walker->pending, copy);
+                pthread_cond_signal(&walker->wake);
+            pthread_mutex_unlock(&walker->lock);
+            continue;
+        }
+        
+        int childFd = openat(fd, child.name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+        if (childFd < 0) {
+            LogError("Could not open folder ", path->data, ": ", strerror(errno));
             return false;
         }
+        if (!WalkFolderAt(worker, childFd, path)) return false;
     }
-    
-    FILETIME output_path_time;
-    bSuccess = GetFileTime(output_path_fd, NULL, NULL, &output_path_time);
-    CloseHandle(output_path_fd);
-    CHECK(bSuccess, "Could not get time information for ", output_path);
-    
-    for (auto input_path : input_paths) {
-        HANDLE input_path_fd = CreateFile(input_path, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, NULL);
-        CHECK(input_path_fd != INVALID_HANDLE_VALUE, "Could not open file ", input_path);
-        FILETIME input_path_time;
-        bSuccess = GetFileTime(input_path_fd, NULL, NULL, &input_path_time);
-        CloseHandle(input_path_fd);
-        CHECK(bSuccess, "Could not get time information for ", input_path);
-    
-        // NOTE: if even a single input_path is fresher than output_path that's 100% rebuild
-        if (CompareFileTime(&input_path_time, &output_path_time) == 1) return true;
-    };
-    
-    return false;
-    #undef CHECK
+    path->count = base;
+    path->data[base] = '\0';
+    return true;
 }
 
-static String GetErrorString() {
-    auto errorCode = GetLastError();
+static void RunWalkWorker(void *data) {
+    auto worker = static_cast<Walk_Worker*>(data);
+    auto walker = worker->walker;
+    NCZ_PUSH_STATE(context.allocator, (Allocator{ PoolAllocatorProc, &worker->pool }));
+    String_Builder path {};
     
-    // Returns a string in temporary storage.
-    wchar_t *lpMsgBuf;
-    bool success = FormatMessageW(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER |
-           FORMAT_MESSAGE_FROM_SYSTEM  |
-           FORMAT_MESSAGE_IGNORE_INSERTS,
-        nullptr, errorCode,
-        MAKELANGID(LANG_NEUTRAL,SUBLANG_DEFAULT), // Default language
-        (wchar_t*)&lpMsgBuf, 0, nullptr
-    );
-    if (!success) return ""_str;
-    NCZ_DEFER(LocalFree(lpMsgBuf));
+    pthread_mutex_lock(&walker->lock);
+    for (;;) {
+        bool failed = __atomic_load_n(&walker->failed, __ATOMIC_RELAXED);
+        if (walker->pending.count && !failed) {
+            String folder = walker->pending[walker->pending.count-1];
+            walker->pending.count -= 1;
+            pthread_mutex_unlock(&walker->lock);
+                path.count = 0;
+                Extend(&path, folder);
+                Push(&path, '\0');
+                path.count -= 1;
+                
+                int fd = open(path.data, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if (fd < 0) LogError("Could not open folder ", path.data, ": ", strerror(errno));
+                if (fd < 0 || !WalkFolderAt(worker, fd, &path)) {
+                    worker->ok = false;
+                    __atomic_store_n(&walker->failed, true, __ATOMIC_RELAXED);
+                }
+            pthread_mutex_lock(&walker->lock);
+            continue;
+        }
+        if (walker->done) break;
+        
+        u32 idle = __atomic_add_fetch(&walker->idle, 1, __ATOMIC_RELAXED);
+        if (idle == walker->threads || failed) {
+            // nobody is working and there is no work left, so nobody can make more
+            walker->done = true;
+            pthread_cond_broadcast(&walker->wake);
+            break;
+        }
+        pthread_cond_wait(&walker->wake, &walker->lock);
+        __atomic_sub_fetch(&walker->idle, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&walker->lock);
+}
 
+Result<Array<Walk_Entry>> WalkFolder(cstr root, Walk_Options options) {
+    Walker walker {};
+    walker.options = options;
+    walker.threads = options.threads ? options.threads : 1;
+    walker.pending.allocator = crtAllocator;
+    NCZ_DEFER(if (walker.pending.data) Dispose(walker.pending.data, crtAllocator));
     
-    // result := Utf8.wide_to_utf8_new(lpMsgBuf,, Basic.temp);
-    auto queryResult = WideCharToMultiByte(CP_UTF8, 0,
-                                            lpMsgBuf, -1,
-                                            nullptr, 0,
-                                            nullptr, nullptr);
-    if (queryResult <= 0) return ""_str;
-
-    String name;
-    auto nameBytes = static_cast<char*>(Allocate(queryResult));
-    auto result    = WideCharToMultiByte(CP_UTF8, 0, lpMsgBuf, -1, nameBytes, queryResult, nullptr, nullptr);
-    if (result <= 0) return ""_str;
-    NCZ_ASSERT(result <= queryResult);
+    String rootPath { strlen(root), const_cast<char*>(root) };
+    while (rootPath.count > 1 && IsPathSep(rootPath.data[rootPath.count-1])) --rootPath.count;
+    walker.rootLen = rootPath.count + 1;
+    Push(&walker.pending, rootPath);
     
-    name.data  = nameBytes;
-    name.count = result-1; // Returned length DOES include null character if we passed in a null-terminated string!
+    auto workers = static_cast<Walk_Worker*>(Allocate(walker.threads * sizeof(Walk_Worker), crtAllocator));
+    NCZ_DEFER(Dispose(workers, crtAllocator));
+    auto threads = static_cast<Result<Thread>*>(Allocate(walker.threads * sizeof(Result<Thread>), crtAllocator));
+    NCZ_DEFER(Dispose(threads, crtAllocator));
     
-    usize trimmedCount = name.count;
-    for (usize i = name.count; i >= 0; --i) {
-        if (name.data[i] == '\r' || name.data[i] == '\n') trimmedCount -= 1;
-        else break;
+    for (u32 i = 0; i < walker.threads; ++i) {
+        workers[i] = {};
+        workers[i].walker = &walker;
+        workers[i].entries.allocator = { PoolAllocatorProc, &workers[i].pool };
+    }
+    // the calling thread is worker 0, which is the only one if we can't start any more
+    for (u32 i = 1; i < walker.threads; ++i) {
+        threads[i] = StartThread(RunWalkWorker, &workers[i]);
+        if (!threads[i].ok) {
+            pthread_mutex_lock(&walker.lock);
+                walker.threads -= 1;
+            pthread_mutex_unlock(&walker.lock);
+        }
     }
+    RunWalkWorker(&workers[0]);
+    for (u32 i = 1; i < options.threads; ++i) if (threads[i].ok) JoinThread(threads[i].value);
     
-    // Chop off the newline so that we can format this standardly. Argh.
-    return {trimmedCount, name.data};
+    return CollectWalkEntries(workers, options.threads ? options.threads : 1);
 }
 
-Result<Array<cstr>> ReadFolder(cstr parent) {
-    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
-    List<cstr> children {};
-    
-    // cstr search_path = Concat(parent, "\\*"); // Append wildcard to parent path
-    cstr search_path = TPrint(parent, "\\*"_str).data;
-    WIN32_FIND_DATA ffd;
-    HANDLE hFind = FindFirstFile(search_path, &ffd);
-    if (INVALID_HANDLE_VALUE == hFind) {
-        LogError("Could not open folder ", parent, ": ", GetErrorString());
-        return {};
+#ifdef __linux__
+static bool AddInotifyWatch(File_Watcher *watcher, cstr folder) {
+    constexpr u32 mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    int wd = inotify_add_watch(watcher->handle, folder, mask);
+    if (wd < 0) {
+        LogError("Could not watch ", folder, ": ", strerror(errno));
+        return false;
     }
-    NCZ_DEFER(FindClose(hFind));
-
-    do Push(&children, CopyCstr(ffd.cFileName));
-    while (FindNextFile(hFind, &ffd) != 0);
+    
+    NCZ_PUSH_STATE(context.allocator, crtAllocator);
+    while (watcher->folders.count <= static_cast<usize>(wd)) Push(&watcher->folders, (cstr) nullptr);
+    if (!watcher->folders[wd]) watcher->folders[wd] = CopyCstr(folder);
+    return true;
+}
 
-    if (GetLastError() != ERROR_NO_MORE_FILES) {
-        LogError("Could not read folder ", parent, ": ", GetErrorString());
-        return {};
+// NOTE: inotify is not recursive, every folder needs its own watch. With changes, path is a folder
+// that just showed up, whatever is already in it was made before its watch and has no events, so
+// it is reported as changed here.
+static bool AddInotifyWatches(File_Watcher *watcher, cstr path, List<cstr> *changes = nullptr) {
+    Allocator allocator = context.allocator;
+    NCZ_SAVE_STATE(context.temporaryStorage.mark);
+    NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
+    // NOTE: the watch goes first, so a file made during the walk is in it or has an event
+    if (!AddInotifyWatch(watcher, path)) return false;
+    auto [entries, ok] = WalkFolder(path);
+    if (!ok) return false;
+    for (auto entry : entries) {
+        if (entry.type == File_Type::FOLDER && !AddInotifyWatch(watcher, entry.path.data)) return false;
+        if (changes) {
+            ForgetFileInfo(entry.path.data);
+            NCZ_PUSH_STATE(context.allocator, allocator);
+            PushUnique(changes, entry.path.data);
+        }
     }
-
-    return children;
+    return true;
 }
 
-Result<File_Type> GetFileType(cstr path) {
-    WIN32_FILE_ATTRIBUTE_DATA wfad;
-    if (!GetFileAttributesEx(path, GetFileExInfoStandard, &wfad)) {
-        LogError("Could not get attributes of ", path, ": ", GetErrorString());
-        return {};
+bool WatchFolder(File_Watcher *watcher, cstr path) {
+    if (watcher->handle < 0) {
+        watcher->handle = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (watcher->handle < 0) {
+            LogError("Could not create inotify instance: ", strerror(errno));
+            return false;
+        }
     }
-
-    if (wfad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-        return File_Type::FOLDER;
-    else if (wfad.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
-        return File_Type::LINK;
-    else
-        return File_Type::FILE;
+    {
+        NCZ_PUSH_STATE(context.allocator, crtAllocator);
+        Push(&watcher->roots, CopyCstr(path));
+    }
+    return AddInotifyWatches(watcher, path);
 }
 
-#else // POSIX
-// Multiprocessing
-bool Wait(Process proc) {
+// Reads whatever events are queued up, returns false on errors
+static bool ReadInotifyEvents(File_Watcher *watcher, List<cstr> *changes) {
+    alignas(struct inotify_event) char buffer[16 * 1024];
     for (;;) {
-        int wstatus = 0;
-        if (waitpid(proc, &wstatus, 0) < 0) {
-            LogError("could not wait on command "_str, proc, strerror(errno));
+        ssize_t n = read(watcher->handle, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return true;
+        if (n < 0) {
+            LogError("Could not read file changes: ", strerror(errno));
             return false;
         }
-
-        if (WIFEXITED(wstatus)) {
-            int exit_status = WEXITSTATUS(wstatus);
-            if (exit_status != 0) {
-                LogError("command exited with exit code ", exit_status);
-                return false;
+        
+        for (ssize_t offset = 0; offset < n;) {
+            auto event = reinterpret_cast<struct inotify_event*>(buffer + offset);
+            offset    += sizeof(struct inotify_event) + event->len;
+            
+            if (event->mask & IN_Q_OVERFLOW) {
+                // we missed some events, so all we can say is that anything might have changed
+                ClearFileInfoCache();
+                for (cstr root : watcher->roots) PushUnique(changes, root);
+                continue;
             }
+            if (event->wd < 0 || static_cast<usize>(event->wd) >= watcher->folders.count) continue;
+            cstr folder = watcher->folders[event->wd];
+            if (!folder || !event->len) continue;
+            
+            char path[4096];
+            snprintf(path, sizeof(path), "%s" NCZ_PATH_SEP "%s", folder, event->name);
+            ForgetFileInfo(path);
+            PushUnique(changes, path);
+            // a new folder showed up, so we have to watch it and everything already in it
+            bool newFolder = (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO));
+            if (newFolder && !AddInotifyWatches(watcher, path, changes)) return false;
+        }
+    }
+}
 
-            break;
+Result<Array<cstr>> WaitForChanges(File_Watcher *watcher, u64 debounceMs) {
+    List<cstr> changes {};
+    struct pollfd pfd { static_cast<int>(watcher->handle), POLLIN, 0 };
+    for (;;) {
+        int ready = poll(&pfd, 1, changes.count ? static_cast<int>(debounceMs) : -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) {
+            LogError("Could not wait for file changes: ", strerror(errno));
+            return {};
         }
+        // nothing happened for debounceMs after the last change, the burst is over
+        if (ready == 0) break;
+        if (!ReadInotifyEvents(watcher, &changes)) return {};
+    }
+    return changes;
+}
+#endif//__linux__
 
-        if (WIFSIGNALED(wstatus)) {
-            LogError("command process was terminated by ", strsignal(WTERMSIG(wstatus)));
+static s64 OpenFileHandle(cstr path, bool write, cstr replaces) {
+    struct stat old;
+    bool keepMode = write && replaces && stat(replaces, &old) == 0;
+    int fd = write ? open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, keepMode ? old.st_mode & 07777 : 0644)
+                   : open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LogError("Could not open ", path, ": ", strerror(errno));
+        return -1;
+    }
+    // NOTE: open masks the mode with the umask, the file it replaces had its mode set already
+    if (keepMode && fchmod(fd, old.st_mode & 07777) != 0) {
+        LogError("Could not give ", path, " the mode of ", replaces, ": ", strerror(errno));
+        close(fd);
+        remove(path);
+        return -1;
+    }
+    return fd;
+}
+
+static void CloseFileHandle(s64 handle) { close(static_cast<int>(handle)); }
+
+static u64 CurrentProcessId() { return static_cast<u64>(getpid()); }
+
+static bool WriteToHandle(s64 handle, cstr path, const char *data, usize size) {
+    while (size > 0) {
+        ssize_t n = write(static_cast<int>(handle), data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LogError("Could not write data to ", path, ": ", strerror(errno));
             return false;
         }
+        data += n;
+        size -= static_cast<usize>(n);
     }
     return true;
 }
 
-Result<Process> RunCommandAsync(Array<cstr> args, bool trace) {
-    pid_t cpid = fork();
-    if (cpid < 0) {
-        LogError("Could not fork child process: ", strerror(errno));
+static bool WriteToHandle(s64 handle, cstr path, Array<String> pieces) {
+    // NOTE: writev takes a limited number of pieces per call and, like write, may write less than
+    // it was given (linux stops at 2 GB), so we go in batches and continue where it stopped
+    constexpr const usize BATCH = 64;
+    iovec batch[BATCH];
+    usize next = 0, offset = 0; // the first piece that is not written completely, and how much of it is
+    while (next < pieces.count) {
+        int count = 0;
+        for (usize i = next; i < pieces.count && count < (int)BATCH; ++i) {
+            usize skip = i == next ? offset : 0;
+            if (pieces.data[i].count == skip) continue;
+            batch[count].iov_base = pieces.data[i].data + skip;
+            batch[count].iov_len  = pieces.data[i].count - skip;
+            count += 1;
+        }
+        if (!count) break;
+        
+        ssize_t n = writev(static_cast<int>(handle), batch, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LogError("Could not write data to ", path, ": ", strerror(errno));
+            return false;
+        }
+        usize left = static_cast<usize>(n);
+        while (next < pieces.count && left >= pieces.data[next].count - offset) {
+            left  -= pieces.data[next].count - offset;
+            offset = 0;
+            next  += 1;
+        }
+        offset += left;
+    }
+    return true;
+}
+
+static bool SyncFileHandle(s64 handle, cstr path) {
+    #ifdef __APPLE__
+    // NOTE: fsync on macos only hands the data to the drive, which may keep it in its cache
+    while (fcntl(static_cast<int>(handle), F_FULLFSYNC) < 0) {
+    #else
+    while (fdatasync(static_cast<int>(handle)) < 0) {
+    #endif//__APPLE__
+        if (errno == EINTR) continue;
+        LogError("Could not flush ", path, " to the disk: ", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool CommitTempFile(cstr tempPath, cstr path, bool durable) {
+    if (!RenameFile(tempPath, path)) return false;
+    if (!durable) return true;
+    
+    // NOTE: the rename is an update of the folder, it is only on the disk once the folder is
+    cstr  slash  = strrchr(path, '/');
+    usize length = slash ? (slash == path ? 1 : static_cast<usize>(slash - path)) : 0;
+    cstr  folder = length ? TPrint(String{ length, const_cast<char*>(path) }).data : ".";
+    int fd = open(folder, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        LogError("Could not open folder ", folder, ": ", strerror(errno));
+        return false;
+    }
+    NCZ_DEFER(close(fd));
+    while (fsync(fd) < 0) {
+        if (errno == EINTR) continue;
+        LogError("Could not flush folder ", folder, " to the disk: ", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static Result<usize> ReadFromHandle(s64 handle, cstr path, char *data, usize size) {
+    for (;;) {
+        ssize_t n = read(static_cast<int>(handle), data, size);
+        if (n >= 0) return static_cast<usize>(n);
+        if (errno == EINTR) continue;
+        LogError("Could not read file ", path, ": ", strerror(errno));
+        return {};
+    }
+}
+
+static Result<bool> CopyHandleFast(s64 from, s64 to, u64 *copied) {
+#ifdef __linux__
+    // NOTE: copy_file_range can share extents on file systems that support it, sendfile works
+    // across file systems. Both only refuse up front, so falling back is only needed before the
+    // first byte was copied.
+    int in = static_cast<int>(from), out = static_cast<int>(to);
+    bool useSendfile = false;
+    for (;;) {
+        ssize_t n = useSendfile ? sendfile(out, in, nullptr, 1 << 30)
+                                : copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0);
+        if (n > 0) { *copied += static_cast<u64>(n); continue; }
+        if (n == 0) return true;
+        if (errno == EINTR) continue;
+        if (*copied == 0 && !useSendfile && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+            useSendfile = true;
+            continue;
+        }
+        if (*copied == 0) return false;
+        LogError("Could not copy file data: ", strerror(errno));
         return {};
     }
+#else
+    (void) from; (void) to; (void) copied;
+    return false;
+#endif//__linux__
+}
+
+#ifdef NCZ_IO_URING
+// A minimal io_uring made with the raw system calls, so there is no liburing to link against
+struct Ring {
+    int           fd         = -1;
+    u32           entries    = 0;
+    u32          *sqTail     = nullptr;
+    u32           sqMask     = 0;
+    u32          *sqArray    = nullptr;
+    io_uring_sqe *sqes       = nullptr;
+    u32          *cqHead     = nullptr;
+    u32          *cqTail     = nullptr;
+    u32           cqMask     = 0;
+    io_uring_cqe *cqes       = nullptr;
+    void         *sqRing     = nullptr;
+    usize         sqRingSize = 0;
+    void         *cqRing     = nullptr;
+    usize         cqRingSize = 0;
+    usize         sqesSize   = 0;
+};
+
+static void CloseRing(Ring *ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing && ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+    if (ring->sqRing) munmap(ring->sqRing, ring->sqRingSize);
+    if (ring->fd >= 0) close(ring->fd);
+    *ring = {};
+}
+
+static void *MapRing(Ring *ring, usize size, u64 offset) {
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, offset);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+static bool OpenRing(Ring *ring, u32 entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return false;
+    }
+    ring->entries    = params.sq_entries;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cqRingSize = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+    ring->sqesSize   = params.sq_entries * sizeof(io_uring_sqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cqRingSize > ring->sqRingSize) ring->sqRingSize = ring->cqRingSize;
     
-    if (cpid == 0) {
-        List<cstr> cmd {};
-        String_Builder sb {};
-        
-        for (auto it : args) {
-            Push(&cmd, it);
-            if (!strchr(it, ' ')) {
-                Write(&sb, it);
-            } else {
-                Push(&sb, '\"');
-                Write(&sb, it);
-                Push(&sb, '\"');
+    ring->sqRing = MapRing(ring, ring->sqRingSize, IORING_OFF_SQ_RING);
+    ring->cqRing = single ? ring->sqRing : MapRing(ring, ring->cqRingSize, IORING_OFF_CQ_RING);
+    ring->sqes   = static_cast<io_uring_sqe*>(MapRing(ring, ring->sqesSize, IORING_OFF_SQES));
+    if (!ring->sqRing || !ring->cqRing || !ring->sqes) {
+        CloseRing(ring);
+        return false;
+    }
+    auto sq = static_cast<u8*>(ring->sqRing), cq = static_cast<u8*>(ring->cqRing);
+    ring->sqTail  = reinterpret_cast<u32*>(sq + params.sq_off.tail);
+    ring->sqMask  = *reinterpret_cast<u32*>(sq + params.sq_off.ring_mask);
+    ring->sqArray = reinterpret_cast<u32*>(sq + params.sq_off.array);
+    ring->cqHead  = reinterpret_cast<u32*>(cq + params.cq_off.head);
+    ring->cqTail  = reinterpret_cast<u32*>(cq + params.cq_off.tail);
+    ring->cqMask  = *reinterpret_cast<u32*>(cq + params.cq_off.ring_mask);
+    ring->cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    
+    // NOTE: the operations we need came with linux 5.6, so did the probe, older kernels fail it
+    constexpr const u32 MAX_OPS = 256;
+    alignas(io_uring_probe) u8 buffer[sizeof(io_uring_probe) + MAX_OPS * sizeof(io_uring_probe_op)] = {};
+    auto probe = reinterpret_cast<io_uring_probe*>(buffer);
+    bool supported = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, MAX_OPS) >= 0;
+    const u8 ops[] = { IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+    for (u8 op : ops) {
+        supported = supported && op < probe->ops_len && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    }
+    if (!supported) CloseRing(ring);
+    return supported;
+}
+
+// Runs one phase over count items: prepare fills in the entry for item i, or returns false if i has
+// nothing to do in this phase, and complete gets the result of every item that was submitted. The
+// ring is kept full, and the same io_uring_enter submits new entries and waits for completions.
+template <typename P, typename C>
+static bool RunRingPhase(Ring *ring, usize count, P prepare, C complete) {
+    usize next     = 0;
+    u32   queued   = 0; // in the submission queue, not yet taken by the kernel
+    u32   inFlight = 0; // taken by the kernel, not yet completed
+    u32   tail     = *ring->sqTail;
+    while (next < count || queued || inFlight) {
+        while (next < count && queued + inFlight < ring->entries) {
+            auto sqe = &ring->sqes[tail & ring->sqMask];
+            memset(sqe, 0, sizeof(*sqe));
+            if (prepare(sqe, next)) {
+                sqe->user_data = next;
+                ring->sqArray[tail & ring->sqMask] = tail & ring->sqMask;
+                tail   += 1;
+                queued += 1;
             }
-            Push(&sb, ' ');
+            next += 1;
         }
-        Push(&cmd, (cstr) nullptr);
+        if (!queued && !inFlight) break;
+        __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
         
-        if (trace) Log(sb.data);
-    
-        if (execvp(cmd.data[0], (char * const*) cmd.data) < 0) {
-            LogError("Could not exec child process: ", strerror(errno));
-            exit(1);
+        // NOTE: once everything is queued we wait for all of it, before that only for half of
+        // the ring, so there is room to queue more while the rest is still busy
+        u32 wait = queued + inFlight;
+        if (next < count) wait = wait / 2 ? wait / 2 : 1;
+        long n = syscall(__NR_io_uring_enter, ring->fd, queued, wait, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LogError("Could not submit to io_uring: ", strerror(errno));
+            return false;
         }
-        NCZ_ASSERT(0 && "unreachable");
+        if (n > 0) {
+            queued   -= static_cast<u32>(n);
+            inFlight += static_cast<u32>(n);
+        }
+        
+        u32 head = *ring->cqHead;
+        u32 end  = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != end; ++head) {
+            auto cqe = &ring->cqes[head & ring->cqMask];
+            complete(static_cast<usize>(cqe->user_data), cqe->res);
+            inFlight -= 1;
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+#ifndef NCZ_RING_MIN_FILES
+#define NCZ_RING_MIN_FILES 8
+#endif//NCZ_RING_MIN_FILES
+
+#ifndef NCZ_RING_ENTRIES
+#define NCZ_RING_ENTRIES 256
+#endif//NCZ_RING_ENTRIES
+
+static bool ReadFilesWithRing(Array<File_Request> requests, bool *ok) {
+    // NOTE: setting up a ring costs a few system calls of its own
+    if (requests.count < NCZ_RING_MIN_FILES) return false;
+    u32 entries = 1;
+    while (entries < NCZ_RING_ENTRIES && entries < requests.count) entries *= 2;
+    Ring ring {};
+    if (!OpenRing(&ring, entries)) return false;
+    NCZ_DEFER(CloseRing(&ring));
+    
+    struct Ring_File {
+        struct statx stx;
+        int          fd;
+        usize        done; // bytes read so far
+    };
+    auto files = static_cast<Ring_File*>(Allocate(requests.count * sizeof(Ring_File), crtAllocator));
+    for (usize i = 0; i < requests.count; ++i) files[i].fd = -1, files[i].done = 0;
+    
+    *ok = true;
+    auto fail = [&](usize i, cstr what, s32 error) {
+        LogError("Could not ", what, " ", requests.data[i].path, ": ", strerror(-error));
+        requests.data[i].ok = *ok = false;
+    };
+    auto pointer = [](const void *p) { return static_cast<u64>(reinterpret_cast<usize>(p)); };
+    
+    bool ran = RunRingPhase(&ring, requests.count,
+        [&](io_uring_sqe *sqe, usize i) {
+            sqe->opcode      = IORING_OP_STATX;
+            sqe->fd          = AT_FDCWD;
+            sqe->addr        = pointer(requests.data[i].path);
+            sqe->len         = STATX_TYPE | STATX_MTIME | STATX_SIZE;
+            sqe->off         = pointer(&files[i].stx);
+            return true;
+        },
+        [&](usize i, s32 result) {
+            auto request = &requests.data[i];
+            if (result == -ENOENT || result == -ENOTDIR) return;
+            if (result < 0) return fail(i, "stat", result);
+            auto &stx = files[i].stx;
+            request->info.exists = true;
+            request->info.type   = FileTypeFromMode(stx.stx_mode);
+            request->info.size   = stx.stx_size;
+            request->info.mtime  = static_cast<u64>(stx.stx_mtime.tv_sec) * 1000000000ull + stx.stx_mtime.tv_nsec;
+            // NOTE: completions are handled on this thread, so this may use the context allocator
+            PrepareFileData(request);
+        });
+    
+    ran = ran && RunRingPhase(&ring, requests.count,
+        [&](io_uring_sqe *sqe, usize i) {
+            if (!requests.data[i].data.count) return false;
+            sqe->opcode     = IORING_OP_OPENAT;
+            sqe->fd         = AT_FDCWD;
+            sqe->addr       = pointer(requests.data[i].path);
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            return true;
+        },
+        [&](usize i, s32 result) {
+            if (result < 0) return fail(i, "open", result);
+            files[i].fd = result;
+        });
+    
+    // NOTE: reads may come back short, those go around again for the rest
+    for (bool more = true; ran && more;) {
+        more = false;
+        ran  = RunRingPhase(&ring, requests.count,
+            [&](io_uring_sqe *sqe, usize i) {
+                auto data = requests.data[i].data;
+                if (files[i].fd < 0 || files[i].done == data.count || !requests.data[i].ok) return false;
+                usize left  = data.count - files[i].done;
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd     = files[i].fd;
+                sqe->addr   = pointer(data.data + files[i].done);
+                sqe->len    = left > (1u << 30) ? (1u << 30) : static_cast<u32>(left);
+                sqe->off    = files[i].done;
+                return true;
+            },
+            [&](usize i, s32 result) {
+                auto request = &requests.data[i];
+                if (result == -EINTR || result == -EAGAIN) { more = true; return; }
+                if (result < 0) return fail(i, "read", result);
+                // the file got shorter since we looked at it
+                if (result == 0) request->data.count = files[i].done;
+                files[i].done += static_cast<usize>(result);
+                if (files[i].done < request->data.count) more = true;
+            });
     }
     
-    return {static_cast<unsigned long>(cpid)};
+    ran = RunRingPhase(&ring, requests.count,
+        [&](io_uring_sqe *sqe, usize i) {
+            if (files[i].fd < 0) return false;
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd     = files[i].fd;
+            return true;
+        },
+        [&](usize, s32) {}) && ran;
+    
+    if (!ran) {
+        // NOTE: the kernel may still be writing into files for the entries that were in flight,
+        // so we leak it instead of freeing it under its feet. This only happens if io_uring_enter
+        // itself broke, which it does not.
+        for (auto &request : requests) request.ok = false;
+        *ok = false;
+        return true;
+    }
+    Dispose(files, crtAllocator);
+    return true;
 }
+#endif//NCZ_IO_URING
 
-// Working with files
-bool NeedsUpdate(cstr outputPath, Array<cstr> inputPaths) {
-     struct stat statbuf {};
+Result<String> MapFile(cstr path, bool copyOnWrite) {
+    s64 file = OpenFileHandle(path, false);
+    if (file == -1) return {};
+    NCZ_DEFER(CloseFileHandle(file)); // the mapping keeps its own reference to the file
     
-    if (stat(outputPath, &statbuf) < 0) {
-        // NOTE: if output does not exist it 100% must be rebuilt
-        if (errno == ENOENT) return true;
-        LogError("Could not stat ", outputPath, ": ", strerror(errno));
-        return false;
+    struct stat st;
+    if (fstat(static_cast<int>(file), &st) < 0) {
+        LogError("Could not stat ", path, ": ", strerror(errno));
+        return {};
     }
+    if (!st.st_size) return String{};
     
-    int ouptutPathTime = statbuf.st_mtime;
+    usize size = static_cast<usize>(st.st_size);
+    int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *data = mmap(nullptr, size, protection, MAP_PRIVATE, static_cast<int>(file), 0);
+    if (data == MAP_FAILED) {
+        LogError("Could not map ", path, ": ", strerror(errno));
+        return {};
+    }
+    // NOTE: only hints, it is fine if the kernel ignores them
+    madvise(data, size, MADV_SEQUENTIAL);
+    madvise(data, size, MADV_WILLNEED);
+    return String{ size, static_cast<char*>(data) };
+}
 
-    for (size_t i = 0; i < inputPaths.count; ++i) {
-        cstr input_path = inputPaths[i];
-        if (stat(input_path, &statbuf) < 0) {
-            // NOTE: non-existing input is an error cause it is needed for building in the first place
-            LogError("Could not stat ", input_path, ": ", strerror(errno));
-            return false;
-        }
-        int inputPathTime = statbuf.st_mtime;
-        // NOTE: if even a single input_path is fresher than outputPath that's 100% rebuild
-        if (inputPathTime > ouptutPathTime) return true;
+void Unmap(String mapped) {
+    if (mapped.data && munmap(mapped.data, mapped.count) < 0) {
+        LogError("Could not unmap ", static_cast<void*>(mapped.data), ": ", strerror(errno));
     }
+}
 
-    return false;
+static cstr FindExecutable(cstr name) {
+    cstr paths = getenv("PATH");
+    for (cstr start = paths; start;) {
+        cstr  end    = strchr(start, ':');
+        usize length = end ? static_cast<usize>(end - start) : strlen(start);
+        // an empty entry is the current folder
+        String folder = length ? String{ length, const_cast<char*>(start) } : "."_str;
+        cstr candidate = TPrint(folder, "/", name).data;
+        if (access(candidate, X_OK) == 0) return candidate;
+        start = end ? end + 1 : nullptr;
+    }
+    return nullptr;
+}
+
+cstr GetProgramPath(cstr argv0) {
+#ifdef __linux__
+    char buffer[4096];
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+    if (length > 0 && length < static_cast<ssize_t>(sizeof(buffer))) return SPrint(String{ static_cast<usize>(length), buffer }).data;
+#endif//__linux__
+    if (strchr(argv0, '/')) return argv0;
+    cstr found = FindExecutable(argv0);
+    return found ? SPrint(found).data : argv0;
+}
+
+#ifndef NCZ_NO_CC
+static void ReplaceProcess(cstr path, Array<cstr> args) {
+    List<cstr> argv {}; argv.allocator = NCZ_TEMP;
+    for (cstr arg : args) Push(&argv, arg);
+    Push(&argv, static_cast<cstr>(nullptr));
+    fflush(stdout);
+    fflush(stderr);
+    execv(path, const_cast<char* const*>(argv.data));
+    LogError("Could not run ", path, ": ", strerror(errno));
 }
+#endif//NCZ_NO_CC
 
 bool RenameFile(cstr oldPath, cstr newPath) {
+    ForgetFileInfo(oldPath);
+    ForgetFileInfo(newPath);
     if (rename(oldPath, newPath) < 0) {
         LogError("Could not rename ", oldPath, " to ", newPath, ": ", strerror(errno));
         return false;
@@ -1095,71 +5826,23 @@ Result<Array<cstr>> ReadFolder(cstr parent) {
     return children;
 }
 
-Result<File_Type> GetFileType(cstr path) {
-    struct stat statbuf;
-    if (stat(path, &statbuf) < 0) {
-        LogError("Could not get stat of ", path, ": ", strerror(errno));
-        return {};
-    }
-
-    switch (statbuf.st_mode & S_IFMT) {
-    case S_IFDIR:  return File_Type::FOLDER;
-    case S_IFREG:  return File_Type::FILE;
-    case S_IFLNK:  return File_Type::LINK;
-    default:       return File_Type::OTHER;
-    }
-}
-
-
 #endif//WIN32/POSIX
 
-// POSIX
-// #define NCZ_PATH_SEP '/'
-
-// WIN32
-#define NCZ_PATH_SEP "\\"
-
-template <typename F> static
-bool Visit(cstr file, F visitProc, String_Builder *fullPath, u64 *basePathLen) {
-    if ((strcmp(".", file) == 0) || (strcmp("..", file) == 0)) return true;
-    fullPath->count = *basePathLen;
-    Print(fullPath, NCZ_PATH_SEP, file, "\0"_str);
-    
-    auto [type, ok] = GetFileType(fullPath->data);
-    if (!ok) return false;
-    ok = visitProc(String{fullPath->count-1, fullPath->data}, type);
-    if (!ok) return false;
-    
-    if (type == File_Type::FOLDER) {
-        auto [children, ok] = ReadFolder(fullPath->data);
-        if (!ok) return false;
-        (*fullPath)[fullPath->count-1] = NCZ_PATH_SEP[0]; // replace null terminator to make it a proper folder
-        NCZ_PUSH_STATE(*basePathLen, fullPath->count); // hell yeah.....
-        for (cstr c: children) if (!Visit(c, visitProc, fullPath, basePathLen)) return false;
-    }
-    
-    return true;
-}
-
 // F is a function/closure of type (String path, File_Type type) -> bool
 // While path is a String, path.data is a null terminated cstr for convenience.
 // This function Allocates all paths with temporary storage so if you want to keep
 // a path you are visiting you need to use CopyString or CopyCstr
 template <typename F>
 bool TraverseFolder(cstr path, F visitProc) {
-    Array<cstr> files;
-    String_Builder fullPath {};
+    Array<Walk_Entry> entries;
     {
         NCZ_PUSH_STATE(context.allocator, NCZ_TEMP);
-        auto result = ReadFolder(path);
+        auto result = WalkFolder(path);
         if (!result.ok) return false;
-        files = result.value;
-        Write(&fullPath, path);
+        entries = result.value;
     }
     
-    u64 basePathLen = fullPath.count;
-    for (cstr f: files) if (!Visit(f, visitProc, &fullPath, &basePathLen)) return false;
-    
+    for (auto entry : entries) if (!visitProc(entry.path, entry.type)) return false;
     return true;
 }
 
@@ -136,6 +136,8 @@
 // Use QUADS instead of TRIANGLES for drawing when possible
 // Some lines-based shapes could still use lines
 #define SUPPORT_QUADS_DRAW_MODE         1
+// Use SSE and AVX2 for the batched collision checks, without it they check one shape at a time
+#define SUPPORT_SIMD_COLLISIONS         1
 
 
 //------------------------------------------------------------------------------------
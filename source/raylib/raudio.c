@@ -738,7 +738,11 @@ Wave LoadWave(const char *fileName)
     // Loading wave from memory data
     if (fileData != NULL) wave = LoadWaveFromMemory(GetFileExtension(fileName), fileData, dataSize);
 
+#if defined(RAUDIO_STANDALONE)
     RL_FREE(fileData);
+#else
+    UnloadFileData(fileData);
+#endif
 
     return wave;
 }
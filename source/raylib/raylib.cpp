@@ -1,3 +1,5 @@
+#ifndef RAYLIB_CPP_
+#define RAYLIB_CPP_
 namespace rl {
     #include "raylib.h"
 }
@@ -24,6 +26,87 @@ namespace ncz {
         NCZ_PUSH_STATE(context.logger.label, "raylib");
         LogEx(Log_Level::TRACE, type, buf);
     }
+    
+#ifdef PLATFORM_WEB
+    // NCZ_NO_OS leaves the clock to us, raylib.js has the browser's
+    u64 GetTimeNs() { return static_cast<u64>(rl::GetTime() * 1000000000.0); }
+#endif//PLATFORM_WEB
+
+    // "12.34"
+    static String FormatMs(u64 ns) {
+        u64 hundredths = (ns + 5000) / 10000;
+        return TPrint(hundredths / 100, hundredths % 100 < 10 ? ".0" : ".", hundredths % 100);
+    }
+
+    // A flame graph of the frame that EndProfileFrame collected last: time goes to the right, the
+    // zones inside a zone go below it, and every thread gets its rows below the one before. Under
+    // it are the zones that took the most time, with and without the zones inside them.
+    void DrawProfileOverlay(rl::Rectangle area) {
+        auto frame = GetProfileFrame();
+        if (!frame) return;
+        NCZ_SAVE_STATE(context.temporaryStorage.mark);
+        const int FONT = 10, ROW = 14, LIST = 8;
+        rl::DrawRectangleRec(area, { 0, 0, 0, 190 });
+        auto header = TPrint("frame ", frame->index, ": ", FormatMs(frame->end - frame->start), " ms",
+                             frame->dropped ? TPrint(", ", frame->dropped, " zones dropped").data : "");
+        rl::DrawSomeText(header.data, area.x + 4, area.y + 4, FONT, rl::RAYWHITE);
+        
+        float top    = area.y + 4 + ROW;
+        float bottom = area.y + area.height - (LIST + 1) * ROW;
+        float scale  = area.width / static_cast<float>(frame->end - frame->start);
+        u32 thread = 0, base = 0, rows = 0;
+        for (auto &zone : frame->zones) {
+            if (zone.thread != thread) { thread = zone.thread; base = rows; }
+            if (base + zone.depth + 1 > rows) rows = base + zone.depth + 1;
+            float y = top + (base + zone.depth) * ROW;
+            if (y + ROW > bottom || zone.end <= frame->start) continue;
+            // NOTE: a zone that started in the frame before is cut off at the left edge
+            u64 start = zone.start > frame->start ? zone.start - frame->start : 0;
+            float x = area.x + start * scale;
+            float width = (zone.end - frame->start - start) * scale;
+            if (width < 1) width = 1;
+            u64 hash = reinterpret_cast<u64>(zone.name) * 0x9E3779B97F4A7C15ull;
+            rl::DrawRectangleRec({ x, y, width, ROW - 1.0f }, rl::ColorFromHSV(static_cast<float>(hash >> 40 & 0xffff) * 360.0f / 65536.0f, 0.55f, 0.85f));
+            if (rl::MeasureText(zone.name, FONT) + 4 < width) rl::DrawSomeText(zone.name, x + 2, y + 2, FONT, rl::BLACK);
+        }
+        
+        float columns[4] = { area.x + 4, area.x + 4 + 24 * FONT, area.x + 4 + 32 * FONT, area.x + 4 + 40 * FONT };
+        cstr titles[4] = { "zone", "total ms", "self ms", "count" };
+        for (int c = 0; c < 4; ++c) rl::DrawSomeText(titles[c], columns[c], bottom, FONT, rl::LIGHTGRAY);
+        for (usize i = 0; i < frame->totals.count && i < LIST; ++i) {
+            auto &total = frame->totals.data[i];
+            float y = bottom + (i + 1) * ROW;
+            rl::DrawSomeText(total.name, columns[0], y, FONT, rl::RAYWHITE);
+            rl::DrawSomeText(FormatMs(total.ns).data, columns[1], y, FONT, rl::RAYWHITE);
+            rl::DrawSomeText(FormatMs(total.self).data, columns[2], y, FONT, rl::RAYWHITE);
+            rl::DrawSomeText(TPrint(static_cast<u64>(total.count)).data, columns[3], y, FONT, rl::RAYWHITE);
+        }
+    }
+    
+#ifndef NCZ_NO_OS
+    // raylib's LoadFileData reads every asset into a heap copy, these map them into memory instead.
+    // The mappings are copy on write because some of raylib's loaders parse their data in place.
+    // UnloadFileData only gets a pointer back, so we remember how big every mapping was.
+    static List<String> raylibMappedFiles { 0, nullptr, 0, crtAllocator };
+    unsigned char *RaylibLoadFileDataAdapter(cstr fileName, unsigned int *bytesRead) {
+        *bytesRead = 0;
+        auto [data, ok] = MapFile(fileName, true);
+        if (!ok || !data.count) return nullptr;
+        Push(&raylibMappedFiles, data);
+        *bytesRead = static_cast<unsigned int>(data.count);
+        return reinterpret_cast<unsigned char*>(data.data);
+    }
+    void RaylibUnloadFileDataAdapter(unsigned char *data) {
+        for (String &mapped : raylibMappedFiles) {
+            if (mapped.data != reinterpret_cast<char*>(data)) continue;
+            Unmap(mapped);
+            mapped = raylibMappedFiles[raylibMappedFiles.count - 1];
+            raylibMappedFiles.count -= 1;
+            return;
+        }
+        free(data); // loaded before the adapter was installed (RL_FREE is free by default)
+    }
+#endif//NCZ_NO_OS
 }
 
 // a lot of the procedures in raylib are actually cross platform
@@ -32,17 +115,20 @@ namespace ncz {
 // paste the implementation from the c library below, or you will
 // have to implement it in javascript if its not possible.
 #ifdef  PLATFORM_WEB
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif//__wasm_simd128__
 extern "C" {
 void raylib_js_set_entry(void (*entry)(void));
 bool CheckCollisionCircleRec(rl::Vector2 center, float radius, rl::Rectangle rec)
 {
     bool collision = false;
 
-    int recCenterX = (int)(rec.x + rec.width/2.0f);
-    int recCenterY = (int)(rec.y + rec.height/2.0f);
+    float recCenterX = rec.x + rec.width/2.0f;
+    float recCenterY = rec.y + rec.height/2.0f;
 
-    float dx = fabsf(center.x - (float)recCenterX);
-    float dy = fabsf(center.y - (float)recCenterY);
+    float dx = fabsf(center.x - recCenterX);
+    float dy = fabsf(center.y - recCenterY);
 
     if (dx > (rec.width/2.0f + radius)) { return false; }
     if (dy > (rec.height/2.0f + radius)) { return false; }
@@ -57,6 +143,189 @@ bool CheckCollisionCircleRec(rl::Vector2 center, float radius, rl::Rectangle rec
 
     return collision;
 }
+bool CheckCollisionRecs(rl::Rectangle rec1, rl::Rectangle rec2)
+{
+    bool collision = false;
+
+    if ((rec1.x < (rec2.x + rec2.width) && (rec1.x + rec1.width) > rec2.x) &&
+        (rec1.y < (rec2.y + rec2.height) && (rec1.y + rec1.height) > rec2.y)) collision = true;
+
+    return collision;
+}
+bool CheckCollisionCircles(rl::Vector2 center1, float radius1, rl::Vector2 center2, float radius2)
+{
+    bool collision = false;
+
+    float dx = center2.x - center1.x;      // X distance between centers
+    float dy = center2.y - center1.y;      // Y distance between centers
+
+    float distance = sqrtf(dx*dx + dy*dy); // Distance between centers
+
+    if (distance <= (radius1 + radius2)) collision = true;
+
+    return collision;
+}
+
+// The batched collision checks of rshapes.c with SIMD128 instead of SSE and AVX2, the shapes left
+// over (and every one without -msimd128) go through the functions that check one
+#define BATCH_MASK_WORDS(count) (((count) + 31)/32)
+#ifdef __wasm_simd128__
+static inline void LoadRecs4(const rl::Rectangle *recs, v128_t *x, v128_t *y, v128_t *width, v128_t *height)
+{
+    v128_t r0 = wasm_v128_load(&recs[0]), r1 = wasm_v128_load(&recs[1]);
+    v128_t r2 = wasm_v128_load(&recs[2]), r3 = wasm_v128_load(&recs[3]);
+    v128_t xy01 = wasm_i32x4_shuffle(r0, r1, 0, 4, 1, 5), xy23 = wasm_i32x4_shuffle(r2, r3, 0, 4, 1, 5);
+    v128_t wh01 = wasm_i32x4_shuffle(r0, r1, 2, 6, 3, 7), wh23 = wasm_i32x4_shuffle(r2, r3, 2, 6, 3, 7);
+    *x      = wasm_i32x4_shuffle(xy01, xy23, 0, 1, 4, 5);
+    *y      = wasm_i32x4_shuffle(xy01, xy23, 2, 3, 6, 7);
+    *width  = wasm_i32x4_shuffle(wh01, wh23, 0, 1, 4, 5);
+    *height = wasm_i32x4_shuffle(wh01, wh23, 2, 3, 6, 7);
+}
+static inline void LoadVectors4(const rl::Vector2 *vectors, v128_t *x, v128_t *y)
+{
+    v128_t v01 = wasm_v128_load(&vectors[0]), v23 = wasm_v128_load(&vectors[2]);
+    *x = wasm_i32x4_shuffle(v01, v23, 0, 2, 4, 6);
+    *y = wasm_i32x4_shuffle(v01, v23, 1, 3, 5, 7);
+}
+static inline int StoreBatchMask(unsigned int *mask, int index, v128_t collision)
+{
+    unsigned int lanes = wasm_i32x4_bitmask(collision);
+    mask[index/32] |= lanes << (index%32);
+    return __builtin_popcount(lanes);
+}
+#endif//__wasm_simd128__
+
+int CheckCollisionRecsBatch(rl::Rectangle rec, const rl::Rectangle *recs, int count, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#ifdef __wasm_simd128__
+    v128_t left = wasm_f32x4_splat(rec.x), right = wasm_f32x4_splat(rec.x + rec.width);
+    v128_t top = wasm_f32x4_splat(rec.y), bottom = wasm_f32x4_splat(rec.y + rec.height);
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t x, y, width, height;
+        LoadRecs4(recs + i, &x, &y, &width, &height);
+        v128_t collisionX = wasm_v128_and(wasm_f32x4_lt(left, wasm_f32x4_add(x, width)), wasm_f32x4_gt(right, x));
+        v128_t collisionY = wasm_v128_and(wasm_f32x4_lt(top, wasm_f32x4_add(y, height)), wasm_f32x4_gt(bottom, y));
+        hits += StoreBatchMask(mask, i, wasm_v128_and(collisionX, collisionY));
+    }
+#endif//__wasm_simd128__
+    for (; i < count; i++)
+    {
+        if (CheckCollisionRecs(rec, recs[i])) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+int CheckCollisionCirclesBatch(rl::Vector2 center, float radius, const rl::Vector2 *centers, const float *radii, int count, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#ifdef __wasm_simd128__
+    v128_t centerX = wasm_f32x4_splat(center.x), centerY = wasm_f32x4_splat(center.y), radius1 = wasm_f32x4_splat(radius);
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t x, y;
+        LoadVectors4(centers + i, &x, &y);
+        v128_t dx = wasm_f32x4_sub(x, centerX);
+        v128_t dy = wasm_f32x4_sub(y, centerY);
+        v128_t distance = wasm_f32x4_sqrt(wasm_f32x4_add(wasm_f32x4_mul(dx, dx), wasm_f32x4_mul(dy, dy)));
+        hits += StoreBatchMask(mask, i, wasm_f32x4_le(distance, wasm_f32x4_add(radius1, wasm_v128_load(radii + i))));
+    }
+#endif//__wasm_simd128__
+    for (; i < count; i++)
+    {
+        if (CheckCollisionCircles(center, radius, centers[i], radii[i])) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+int CheckCollisionCircleRecBatch(const rl::Vector2 *centers, float radius, int count, rl::Rectangle rec, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#ifdef __wasm_simd128__
+    v128_t halfWidth = wasm_f32x4_splat(rec.width/2.0f), halfHeight = wasm_f32x4_splat(rec.height/2.0f);
+    v128_t recCenterX = wasm_f32x4_splat(rec.x + rec.width/2.0f), recCenterY = wasm_f32x4_splat(rec.y + rec.height/2.0f);
+    v128_t limitX = wasm_f32x4_splat(rec.width/2.0f + radius), limitY = wasm_f32x4_splat(rec.height/2.0f + radius);
+    v128_t radiusSq = wasm_f32x4_splat(radius*radius);
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t x, y;
+        LoadVectors4(centers + i, &x, &y);
+        v128_t dx = wasm_f32x4_abs(wasm_f32x4_sub(x, recCenterX));
+        v128_t dy = wasm_f32x4_abs(wasm_f32x4_sub(y, recCenterY));
+        v128_t outside = wasm_v128_or(wasm_f32x4_gt(dx, limitX), wasm_f32x4_gt(dy, limitY));
+        v128_t cornerX = wasm_f32x4_sub(dx, halfWidth), cornerY = wasm_f32x4_sub(dy, halfHeight);
+        v128_t cornerDistanceSq = wasm_f32x4_add(wasm_f32x4_mul(cornerX, cornerX), wasm_f32x4_mul(cornerY, cornerY));
+        v128_t inside = wasm_v128_or(wasm_v128_or(wasm_f32x4_le(dx, halfWidth), wasm_f32x4_le(dy, halfHeight)), wasm_f32x4_le(cornerDistanceSq, radiusSq));
+        hits += StoreBatchMask(mask, i, wasm_v128_andnot(inside, outside));
+    }
+#endif//__wasm_simd128__
+    for (; i < count; i++)
+    {
+        if (CheckCollisionCircleRec(centers[i], radius, rec)) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+int CheckCollisionPointRecBatch(const rl::Vector2 *points, int count, rl::Rectangle rec, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#ifdef __wasm_simd128__
+    v128_t left = wasm_f32x4_splat(rec.x), right = wasm_f32x4_splat(rec.x + rec.width);
+    v128_t top = wasm_f32x4_splat(rec.y), bottom = wasm_f32x4_splat(rec.y + rec.height);
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t x, y;
+        LoadVectors4(points + i, &x, &y);
+        v128_t collisionX = wasm_v128_and(wasm_f32x4_ge(x, left), wasm_f32x4_lt(x, right));
+        v128_t collisionY = wasm_v128_and(wasm_f32x4_ge(y, top), wasm_f32x4_lt(y, bottom));
+        hits += StoreBatchMask(mask, i, wasm_v128_and(collisionX, collisionY));
+    }
+#endif//__wasm_simd128__
+    // NOTE: CheckCollisionPointRec is raylib.js', a call into javascript for each of the ones left over
+    for (; i < count; i++)
+    {
+        if (rl::CheckCollisionPointRec(points[i], rec)) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+int CheckCollisionRecsBatchAll(const rl::Rectangle *recs1, int count1, const rl::Rectangle *recs2, int count2, unsigned int *mask)
+{
+    int hits = 0;
+    for (int i = 0; i < count1; i++) hits += CheckCollisionRecsBatch(recs1[i], recs2, count2, mask + i*BATCH_MASK_WORDS(count2));
+    return hits;
+}
+int CheckCollisionCirclesBatchAll(const rl::Vector2 *centers1, const float *radii1, int count1, const rl::Vector2 *centers2, const float *radii2, int count2, unsigned int *mask)
+{
+    int hits = 0;
+    for (int i = 0; i < count1; i++) hits += CheckCollisionCirclesBatch(centers1[i], radii1[i], centers2, radii2, count2, mask + i*BATCH_MASK_WORDS(count2));
+    return hits;
+}
+int CheckCollisionCircleRecBatchAll(const rl::Vector2 *centers, float radius, int count, const rl::Rectangle *recs, int recCount, unsigned int *mask)
+{
+    int hits = 0;
+    for (int i = 0; i < recCount; i++) hits += CheckCollisionCircleRecBatch(centers, radius, count, recs[i], mask + i*BATCH_MASK_WORDS(count));
+    return hits;
+}
+int CheckCollisionPointRecBatchAll(const rl::Vector2 *points, int count, const rl::Rectangle *recs, int recCount, unsigned int *mask)
+{
+    int hits = 0;
+    for (int i = 0; i < recCount; i++) hits += CheckCollisionPointRecBatch(points, count, recs[i], mask + i*BATCH_MASK_WORDS(count));
+    return hits;
+}
 // Get a Color from HSV values
 // Implementation reference: https://en.wikipedia.org/wiki/HSL_and_HSV#Alternative_HSV_conversion
 // NOTE: Color->HSV->Color conversion will not yield exactly the same color due to rounding errors
@@ -94,3 +363,4 @@ rl::Color ColorFromHSV(float hue, float saturation, float value)
 }
 }
 #endif//PLATFORM_WEB
+#endif//RAYLIB_CPP_
@@ -506,6 +506,14 @@ typedef struct FilePathList {
     char **paths;                   // Filepaths entries
 } FilePathList;
 
+// Headless stats, what rlgl asked of the null OpenGL of PLATFORM_HEADLESS
+typedef struct HeadlessStats {
+    unsigned int frames;            // Frames presented (SwapScreenBuffer() calls)
+    unsigned int drawCalls;         // Draw calls (glDrawArrays(), glDrawElements() and their instanced versions)
+    unsigned long long vertices;    // Vertices drawn (indices for indexed draws, times the instances)
+    unsigned long long bufferBytes; // Bytes uploaded to vertex and index buffers
+} HeadlessStats;
+
 //----------------------------------------------------------------------------------
 // Enumerators Definition
 //----------------------------------------------------------------------------------
@@ -919,6 +927,7 @@ typedef enum {
 // WARNING: These callbacks are intended for advance users
 typedef void (*TraceLogCallback)(int logLevel, const char *text, void* args);  // Logging: Redirect trace log messages
 typedef unsigned char *(*LoadFileDataCallback)(const char *fileName, unsigned int *bytesRead);      // FileIO: Load binary data
+typedef void (*UnloadFileDataCallback)(unsigned char *data);                                        // FileIO: Unload binary data
 typedef bool (*SaveFileDataCallback)(const char *fileName, void *data, unsigned int bytesToWrite);  // FileIO: Save binary data
 typedef char *(*LoadFileTextCallback)(const char *fileName);            // FileIO: Load text data
 typedef bool (*SaveFileTextCallback)(const char *fileName, char *text); // FileIO: Save text data
@@ -993,6 +1002,16 @@ RLAPI void SwapScreenBuffer(void);                                // Swap back b
 RLAPI void PollInputEvents(void);                                 // Register all input events
 RLAPI void WaitTime(double seconds);                              // Wait for some time (halt program execution)
 
+#if defined(PLATFORM_HEADLESS)
+// Headless platform functions: there is no window, OpenGL calls are counted but not executed,
+// and the input is whatever these set
+RLAPI void SetHeadlessFrameTime(double seconds);                  // Set a fixed time per frame (GetTime() moves by it every frame, nothing waits), 0 for the real clock
+RLAPI void SetHeadlessKey(int key, bool down);                    // Set a key down or up, from the next PollInputEvents() on
+RLAPI void SetHeadlessMouseButton(int button, bool down);         // Set a mouse button down or up, from the next PollInputEvents() on
+RLAPI void SetHeadlessMousePosition(int x, int y);                // Set the mouse position, from the next PollInputEvents() on
+RLAPI HeadlessStats GetHeadlessStats(void);                       // Get what the null OpenGL was asked to do so far
+#endif
+
 // Cursor-related functions
 RLAPI void ShowTheCursor(void);                                      // Shows cursor
 RLAPI void HideCursor(void);                                      // Hides cursor
@@ -1070,6 +1089,7 @@ RLAPI void OpenURL(const char *url);                              // Open URL wi
 // WARNING: Callbacks setup is intended for advance users
 RLAPI void SetTraceLogCallback(TraceLogCallback callback);         // Set custom trace log
 RLAPI void SetLoadFileDataCallback(LoadFileDataCallback callback); // Set custom file binary data loader
+RLAPI void SetUnloadFileDataCallback(UnloadFileDataCallback callback); // Set custom file binary data unloader (for data from the custom loader)
 RLAPI void SetSaveFileDataCallback(SaveFileDataCallback callback); // Set custom file binary data saver
 RLAPI void SetLoadFileTextCallback(LoadFileTextCallback callback); // Set custom file text data loader
 RLAPI void SetSaveFileTextCallback(SaveFileTextCallback callback); // Set custom file text data saver
@@ -1237,6 +1257,19 @@ RLAPI bool CheckCollisionLines(Vector2 startPos1, Vector2 endPos1, Vector2 start
 RLAPI bool CheckCollisionPointLine(Vector2 point, Vector2 p1, Vector2 p2, int threshold);                // Check if point belongs to line created between two points [p1] and [p2] with defined margin in pixels [threshold]
 RLAPI Rectangle GetCollisionRec(Rectangle rec1, Rectangle rec2);                                         // Get collision rectangle for two rectangles collision
 
+// Batched shapes collision detection functions
+// NOTE: Bit i of mask (mask[i/32] & (1u << i%32)) is set when the one shape collides with the i-th of count,
+// mask needs (count + 31)/32 words. The All versions have a row of mask like that for every shape of the other array.
+// They return how many collisions there are.
+RLAPI int CheckCollisionRecsBatch(Rectangle rec, const Rectangle *recs, int count, unsigned int *mask);  // Check collision between a rectangle and many
+RLAPI int CheckCollisionCirclesBatch(Vector2 center, float radius, const Vector2 *centers, const float *radii, int count, unsigned int *mask); // Check collision between a circle and many
+RLAPI int CheckCollisionCircleRecBatch(const Vector2 *centers, float radius, int count, Rectangle rec, unsigned int *mask); // Check collision between many circles and a rectangle
+RLAPI int CheckCollisionPointRecBatch(const Vector2 *points, int count, Rectangle rec, unsigned int *mask); // Check if many points are inside a rectangle
+RLAPI int CheckCollisionRecsBatchAll(const Rectangle *recs1, int count1, const Rectangle *recs2, int count2, unsigned int *mask); // Check collision between every rectangle of two arrays, a row per recs1
+RLAPI int CheckCollisionCirclesBatchAll(const Vector2 *centers1, const float *radii1, int count1, const Vector2 *centers2, const float *radii2, int count2, unsigned int *mask); // Check collision between every circle of two arrays, a row per centers1
+RLAPI int CheckCollisionCircleRecBatchAll(const Vector2 *centers, float radius, int count, const Rectangle *recs, int recCount, unsigned int *mask); // Check collision between every circle and rectangle, a row per rectangle
+RLAPI int CheckCollisionPointRecBatchAll(const Vector2 *points, int count, const Rectangle *recs, int recCount, unsigned int *mask); // Check if every point is inside every rectangle, a row per rectangle
+
 //------------------------------------------------------------------------------------
 // Texture Loading and Drawing Functions (Module: textures)
 //------------------------------------------------------------------------------------
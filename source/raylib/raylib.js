@@ -152,6 +152,10 @@ class RaylibJs {
         return this.ctx.canvas.height;
     }
 
+    GetTime() {
+        return performance.now() / 1000;
+    }
+
     GetFrameTime() {
         // TODO: This is a stopgap solution to prevent sudden jumps in dt when the user switches to a differen tab.
         // We need a proper handling of Target FPS here.
@@ -10,6 +10,7 @@
 *       - PLATFORM_ANDROID: Android (ARM, ARM64)
 *       - PLATFORM_DRM:     Linux native mode, including Raspberry Pi 4 with V3D fkms driver
 *       - PLATFORM_WEB:     HTML5 with WebAssembly
+*       - PLATFORM_HEADLESS: No display at all (benchmarks, CI and replay tests)
 *
 *   CONFIGURATION:
 *       #define PLATFORM_DESKTOP
@@ -28,6 +29,10 @@
 *           Windowing and input system configured for HTML5 (run on browser), code converted from C to asm.js
 *           using emscripten compiler. OpenGL ES 2.0 required for direct translation to WebGL equivalent code.
 *
+*       #define PLATFORM_HEADLESS
+*           No window and no graphic device: rlgl loads a null OpenGL 3.3 that only counts draws and uploads,
+*           input is scripted with SetHeadlessKey() and friends, and SetHeadlessFrameTime() runs a fixed clock
+*
 *       #define SUPPORT_DEFAULT_FONT (default)
 *           Default font is loaded on window initialization to be available for the user to render simple text.
 *           NOTE: If enabled, uses external module functions to load default raylib font (module: text)
@@ -98,6 +103,10 @@
 *
 **********************************************************************************************/
 
+#if defined(PLATFORM_HEADLESS) && defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE             // Required for: CLOCK_MONOTONIC [Used in GetHeadlessClock()], before any system header
+#endif
+
 #include "raylib.h"                 // Declares module functions
 
 // Check if config flags have been externally provided on compilation line
@@ -491,11 +500,22 @@ typedef struct CoreData {
         double draw;                        // Time measure for frame draw
         double frame;                       // Time measure for one frame
         double target;                      // Desired time for one frame, if 0 not applied
-#if defined(PLATFORM_ANDROID) || defined(PLATFORM_DRM)
+#if defined(PLATFORM_ANDROID) || defined(PLATFORM_DRM) || defined(PLATFORM_HEADLESS)
         unsigned long long int base;        // Base time measure for hi-res timer
 #endif
         unsigned int frameCounter;          // Frame counter
     } Time;
+#if defined(PLATFORM_HEADLESS)
+    struct {
+        double frameTime;                   // Fixed time of one frame, if 0 the real clock is used
+        double time;                        // Fixed time clock, advanced by frameTime on every frame
+        char keyState[MAX_KEYBOARD_KEYS];   // Scripted keyboard state, applied on PollInputEvents()
+        char buttonState[MAX_MOUSE_BUTTONS];    // Scripted mouse buttons state, applied on PollInputEvents()
+        Vector2 mousePosition;              // Scripted mouse position, applied on PollInputEvents()
+        unsigned int lastId;                // Last object id handed out by the null OpenGL
+        HeadlessStats stats;                // What rlgl asked of the null OpenGL
+    } Headless;
+#endif
 } CoreData;
 
 //----------------------------------------------------------------------------------
@@ -677,6 +697,19 @@ static int FindNearestConnectorMode(const drmModeConnector *connector, uint widt
 
 #endif  // PLATFORM_DRM
 
+#if defined(PLATFORM_HEADLESS)
+#if !defined(GRAPHICS_API_OPENGL_33)
+    #error "PLATFORM_HEADLESS only provides a null OpenGL 3.3"
+#endif
+static unsigned long long int GetHeadlessClock(void);   // Get monotonic clock time in nanoseconds
+#if defined(_WIN32)
+// NOTE: Declared like Sleep() below, to avoid including windows.h (kernel32.lib linkage required)
+int __stdcall QueryPerformanceCounter(long long *count);          // Required for: GetHeadlessClock()
+int __stdcall QueryPerformanceFrequency(long long *frequency);    // Required for: GetHeadlessClock()
+#endif
+static void *HeadlessGetProcAddress(const char *name);  // Get a null OpenGL function, used to load rlgl extensions
+#endif
+
 #if defined(SUPPORT_EVENTS_AUTOMATION)
 static void LoadAutomationEvents(const char *fileName);     // Load automation events from file
 static void ExportAutomationEvents(const char *fileName);   // Export recorded automation events into a file
@@ -844,7 +877,7 @@ void InitWindow(int width, int height, const char *title)
         }
     }
 #endif
-#if defined(PLATFORM_DESKTOP) || defined(PLATFORM_WEB) || defined(PLATFORM_DRM)
+#if defined(PLATFORM_DESKTOP) || defined(PLATFORM_WEB) || defined(PLATFORM_DRM) || defined(PLATFORM_HEADLESS)
     // Initialize graphics device (display device and OpenGL context)
     // NOTE: returns true if window and graphic device has been initialized successfully
     CORE.Window.ready = InitGraphicsDevice(width, height);
@@ -945,7 +978,7 @@ void InitWindow(int width, int height, const char *title)
     CORE.Time.frameCounter = 0;
 #endif
 
-#endif        // PLATFORM_DESKTOP || PLATFORM_WEB || PLATFORM_DRM
+#endif        // PLATFORM_DESKTOP || PLATFORM_WEB || PLATFORM_DRM || PLATFORM_HEADLESS
 }
 
 // Close window and unload OpenGL context
@@ -1125,7 +1158,7 @@ bool WindowShouldClose(void)
     else return true;
 #endif
 
-#if defined(PLATFORM_ANDROID) || defined(PLATFORM_DRM)
+#if defined(PLATFORM_ANDROID) || defined(PLATFORM_DRM) || defined(PLATFORM_HEADLESS)
     if (CORE.Window.ready) return CORE.Window.shouldClose;
     else return true;
 #endif
@@ -3041,6 +3074,12 @@ double GetTime(void)
 
     time = (double)(nanoSeconds - CORE.Time.base)*1e-9;  // Elapsed time since InitTimer()
 #endif
+
+#if defined(PLATFORM_HEADLESS)
+    // NOTE: With a fixed frame time, time only moves on SwapScreenBuffer() and WaitTime()
+    if (CORE.Headless.frameTime > 0.0) time = CORE.Headless.time;
+    else time = (double)(GetHeadlessClock() - CORE.Time.base)*1e-9;  // Elapsed time since InitTimer()
+#endif
     return time;
 }
 
@@ -4878,10 +4917,30 @@ static bool InitGraphicsDevice(int width, int height)
     }
 #endif  // PLATFORM_ANDROID || PLATFORM_DRM
 
+#if defined(PLATFORM_HEADLESS)
+    // NOTE: There is no display, the requested screen size is the display and the framebuffer
+    if ((width == 0) || (height == 0))
+    {
+        CORE.Window.screen.width = 800;
+        CORE.Window.screen.height = 450;
+    }
+
+    CORE.Window.display.width = CORE.Window.screen.width;
+    CORE.Window.display.height = CORE.Window.screen.height;
+    SetupFramebuffer(CORE.Window.display.width, CORE.Window.display.height);
+    CORE.Window.currentFbo.width = CORE.Window.render.width;
+    CORE.Window.currentFbo.height = CORE.Window.render.height;
+
+    TRACELOG(LOG_INFO, "DISPLAY: Headless device initialized successfully");
+    TRACELOG(LOG_INFO, "    > Screen size:  %i x %i", CORE.Window.screen.width, CORE.Window.screen.height);
+#endif  // PLATFORM_HEADLESS
+
     // Load OpenGL extensions
     // NOTE: GL procedures address loader is required to load extensions
 #if defined(PLATFORM_DESKTOP) || defined(PLATFORM_WEB)
     rlLoadExtensions(glfwGetProcAddress);
+#elif defined(PLATFORM_HEADLESS)
+    rlLoadExtensions(HeadlessGetProcAddress);
 #else
     rlLoadExtensions(eglGetProcAddress);
 #endif
@@ -5030,6 +5089,10 @@ static void InitTimer(void)
     else TRACELOG(LOG_WARNING, "TIMER: Hi-resolution timer not available");
 #endif
 
+#if defined(PLATFORM_HEADLESS)
+    CORE.Time.base = GetHeadlessClock();
+#endif
+
     CORE.Time.previous = GetTime();     // Get time as double
 }
 
@@ -5040,6 +5103,15 @@ static void InitTimer(void)
 // Ref: http://www.geisswerks.com/ryan/FAQS/timing.html --> All about timing on Win32!
 void WaitTime(double seconds)
 {
+#if defined(PLATFORM_HEADLESS)
+    // NOTE: With a fixed frame time, waiting just moves the clock
+    if (CORE.Headless.frameTime > 0.0)
+    {
+        if (seconds > 0.0) CORE.Headless.time += seconds;
+        return;
+    }
+#endif
+
 #if defined(SUPPORT_BUSY_WAIT_LOOP) || defined(SUPPORT_PARTIALBUSY_WAIT_LOOP)
     double destinationTime = GetTime() + seconds;
 #endif
@@ -5115,6 +5187,11 @@ void SwapScreenBuffer(void)
 
 #endif  // PLATFORM_DRM
 #endif  // PLATFORM_ANDROID || PLATFORM_DRM
+
+#if defined(PLATFORM_HEADLESS)
+    CORE.Headless.stats.frames++;
+    if (CORE.Headless.frameTime > 0.0) CORE.Headless.time += CORE.Headless.frameTime;
+#endif
 }
 
 // Register all input events
@@ -5167,6 +5244,36 @@ void PollInputEvents(void)
     }
 #endif
 
+#if defined(PLATFORM_HEADLESS)
+    // Register scripted keys states
+    for (int i = 0; i < MAX_KEYBOARD_KEYS; i++)
+    {
+        CORE.Input.Keyboard.previousKeyState[i] = CORE.Input.Keyboard.currentKeyState[i];
+        CORE.Input.Keyboard.currentKeyState[i] = CORE.Headless.keyState[i];
+
+        if (CORE.Input.Keyboard.currentKeyState[i] && !CORE.Input.Keyboard.previousKeyState[i] &&
+            (CORE.Input.Keyboard.keyPressedQueueCount < MAX_KEY_PRESSED_QUEUE))
+        {
+            CORE.Input.Keyboard.keyPressedQueue[CORE.Input.Keyboard.keyPressedQueueCount] = i;
+            CORE.Input.Keyboard.keyPressedQueueCount++;
+        }
+    }
+
+    // Check exit key
+    if ((CORE.Input.Keyboard.exitKey > 0) && (CORE.Input.Keyboard.exitKey < MAX_KEYBOARD_KEYS) &&
+        CORE.Input.Keyboard.currentKeyState[CORE.Input.Keyboard.exitKey]) CORE.Window.shouldClose = true;
+
+    // Register scripted mouse states
+    for (int i = 0; i < MAX_MOUSE_BUTTONS; i++)
+    {
+        CORE.Input.Mouse.previousButtonState[i] = CORE.Input.Mouse.currentButtonState[i];
+        CORE.Input.Mouse.currentButtonState[i] = CORE.Headless.buttonState[i];
+    }
+
+    CORE.Input.Mouse.previousPosition = CORE.Input.Mouse.currentPosition;
+    CORE.Input.Mouse.currentPosition = CORE.Headless.mousePosition;
+#endif
+
 #if defined(PLATFORM_DESKTOP) || defined(PLATFORM_WEB)
     // Keyboard/Mouse input polling (automatically managed by GLFW3 through callback)
 
@@ -7113,6 +7220,307 @@ static int FindNearestConnectorMode(const drmModeConnector *connector, uint widt
 }
 #endif
 
+#if defined(PLATFORM_HEADLESS)
+// Set a fixed time for every frame, 0 to follow the real clock
+// NOTE: With a fixed frame time GetTime() and GetFrameTime() only depend on the frames
+// presented and WaitTime() does not wait, so the game runs as fast as it can and replays exactly
+void SetHeadlessFrameTime(double seconds)
+{
+    if (seconds < 0.0) seconds = 0.0;
+    if ((seconds > 0.0) && (CORE.Headless.frameTime <= 0.0)) CORE.Headless.time = GetTime();
+
+    CORE.Headless.frameTime = seconds;
+}
+
+// Set a key down or up, seen by the game from the next PollInputEvents()
+void SetHeadlessKey(int key, bool down)
+{
+    if ((key > 0) && (key < MAX_KEYBOARD_KEYS)) CORE.Headless.keyState[key] = down;
+}
+
+// Set a mouse button down or up, seen by the game from the next PollInputEvents()
+void SetHeadlessMouseButton(int button, bool down)
+{
+    if ((button >= 0) && (button < MAX_MOUSE_BUTTONS)) CORE.Headless.buttonState[button] = down;
+}
+
+// Set the mouse position, seen by the game from the next PollInputEvents()
+void SetHeadlessMousePosition(int x, int y)
+{
+    CORE.Headless.mousePosition = (Vector2){ (float)x, (float)y };
+}
+
+// Get what rlgl asked of the null OpenGL since InitWindow()
+HeadlessStats GetHeadlessStats(void)
+{
+    return CORE.Headless.stats;
+}
+
+// Get monotonic clock time in nanoseconds
+static unsigned long long int GetHeadlessClock(void)
+{
+#if defined(_WIN32)
+    // NOTE: timespec_get() follows the wall clock, which can jump, the performance counter does not
+    static long long int frequency = 0;
+    long long int count = 0;
+    if (frequency == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&count);
+    return (unsigned long long int)(count/frequency)*1000000000LLU + (unsigned long long int)(count%frequency)*1000000000LLU/frequency;
+#else
+    struct timespec now = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long int)now.tv_sec*1000000000LLU + (unsigned long long int)now.tv_nsec;
+#endif
+}
+
+// Null OpenGL: every function raylib calls does nothing, except the ones handing out
+// objects and state rlgl checks, and the draws and uploads, which are counted
+static const GLubyte *GLAD_API_PTR HeadlessGlGetString(GLenum name) { return (const GLubyte *)((name == GL_VERSION)? "3.3 raylib headless" : "raylib headless"); }
+static const GLubyte *GLAD_API_PTR HeadlessGlGetStringi(GLenum name, GLuint index) { return (const GLubyte *)"GL_RAYLIB_headless"; }
+static GLenum GLAD_API_PTR HeadlessGlGetError(void) { return GL_NO_ERROR; }
+static void GLAD_API_PTR HeadlessGlGetIntegerv(GLenum name, GLint *data) { *data = (name == GL_NUM_EXTENSIONS)? 1 : 0; }
+static void GLAD_API_PTR HeadlessGlGetInteger64v(GLenum name, GLint64 *data) { *data = 0; }
+static void GLAD_API_PTR HeadlessGlGetFloatv(GLenum name, GLfloat *data) { *data = 0.0f; }
+static void GLAD_API_PTR HeadlessGlGenObjects(GLsizei count, GLuint *ids) { for (int i = 0; i < count; i++) ids[i] = ++CORE.Headless.lastId; }
+static GLuint GLAD_API_PTR HeadlessGlCreateShader(GLenum type) { return ++CORE.Headless.lastId; }
+static GLuint GLAD_API_PTR HeadlessGlCreateProgram(void) { return ++CORE.Headless.lastId; }
+static void GLAD_API_PTR HeadlessGlGetObjectiv(GLuint id, GLenum name, GLint *data) { *data = ((name == GL_COMPILE_STATUS) || (name == GL_LINK_STATUS))? GL_TRUE : 0; }
+static void GLAD_API_PTR HeadlessGlGetInfoLog(GLuint id, GLsizei size, GLsizei *length, GLchar *log) { if (length != NULL) *length = 0; if (size > 0) log[0] = '\0'; }
+static GLint GLAD_API_PTR HeadlessGlGetLocation(GLuint program, const GLchar *name) { return 0; }
+static GLenum GLAD_API_PTR HeadlessGlCheckFramebufferStatus(GLenum target) { return GL_FRAMEBUFFER_COMPLETE; }
+static void *GLAD_API_PTR HeadlessGlMapBuffer(GLenum target, GLenum access) { return NULL; }
+static GLboolean GLAD_API_PTR HeadlessGlUnmapBuffer(GLenum target) { return GL_TRUE; }
+
+static void GLAD_API_PTR HeadlessGlReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels)
+{
+    // NOTE: rlReadScreenPixels() is the only reader, always RGBA and unsigned bytes
+    if ((format == GL_RGBA) && (type == GL_UNSIGNED_BYTE)) memset(pixels, 0, (size_t)width*height*4);
+}
+
+static void GLAD_API_PTR HeadlessGlBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    if (data != NULL) CORE.Headless.stats.bufferBytes += (unsigned long long int)size;
+}
+
+static void GLAD_API_PTR HeadlessGlBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    CORE.Headless.stats.bufferBytes += (unsigned long long int)size;
+}
+
+static void GLAD_API_PTR HeadlessGlDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    CORE.Headless.stats.drawCalls++;
+    CORE.Headless.stats.vertices += (unsigned long long int)count;
+}
+
+static void GLAD_API_PTR HeadlessGlDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+    CORE.Headless.stats.drawCalls++;
+    CORE.Headless.stats.vertices += (unsigned long long int)count*instances;
+}
+
+static void GLAD_API_PTR HeadlessGlDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    CORE.Headless.stats.drawCalls++;
+    CORE.Headless.stats.vertices += (unsigned long long int)count;
+}
+
+static void GLAD_API_PTR HeadlessGlDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances)
+{
+    CORE.Headless.stats.drawCalls++;
+    CORE.Headless.stats.vertices += (unsigned long long int)count*instances;
+}
+
+// State, binds, uniforms and uploads rlgl does not read back: nothing to do, but every one has
+// its own prototype, so it is called exactly like the real one
+static void GLAD_API_PTR HeadlessGlActiveTexture(GLenum texture) { }
+static void GLAD_API_PTR HeadlessGlAttachShader(GLuint program, GLuint shader) { }
+static void GLAD_API_PTR HeadlessGlBindAttribLocation(GLuint program, GLuint index, const GLchar *name) { }
+static void GLAD_API_PTR HeadlessGlBindBuffer(GLenum target, GLuint buffer) { }
+static void GLAD_API_PTR HeadlessGlBindFramebuffer(GLenum target, GLuint framebuffer) { }
+static void GLAD_API_PTR HeadlessGlBindRenderbuffer(GLenum target, GLuint renderbuffer) { }
+static void GLAD_API_PTR HeadlessGlBindTexture(GLenum target, GLuint texture) { }
+static void GLAD_API_PTR HeadlessGlBindVertexArray(GLuint array) { }
+static void GLAD_API_PTR HeadlessGlBlendEquation(GLenum mode) { }
+static void GLAD_API_PTR HeadlessGlBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) { }
+static void GLAD_API_PTR HeadlessGlBlendFunc(GLenum sfactor, GLenum dfactor) { }
+static void GLAD_API_PTR HeadlessGlBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha) { }
+static void GLAD_API_PTR HeadlessGlClear(GLbitfield mask) { }
+static void GLAD_API_PTR HeadlessGlClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { }
+static void GLAD_API_PTR HeadlessGlClearDepth(GLdouble depth) { }
+static void GLAD_API_PTR HeadlessGlCompileShader(GLuint shader) { }
+static void GLAD_API_PTR HeadlessGlCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data) { }
+static void GLAD_API_PTR HeadlessGlCullFace(GLenum mode) { }
+static void GLAD_API_PTR HeadlessGlDeleteBuffers(GLsizei n, const GLuint *buffers) { }
+static void GLAD_API_PTR HeadlessGlDeleteFramebuffers(GLsizei n, const GLuint *framebuffers) { }
+static void GLAD_API_PTR HeadlessGlDeleteProgram(GLuint program) { }
+static void GLAD_API_PTR HeadlessGlDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers) { }
+static void GLAD_API_PTR HeadlessGlDeleteShader(GLuint shader) { }
+static void GLAD_API_PTR HeadlessGlDeleteTextures(GLsizei n, const GLuint *textures) { }
+static void GLAD_API_PTR HeadlessGlDeleteVertexArrays(GLsizei n, const GLuint *arrays) { }
+static void GLAD_API_PTR HeadlessGlDepthFunc(GLenum func) { }
+static void GLAD_API_PTR HeadlessGlDepthMask(GLboolean flag) { }
+static void GLAD_API_PTR HeadlessGlDetachShader(GLuint program, GLuint shader) { }
+static void GLAD_API_PTR HeadlessGlDisable(GLenum cap) { }
+static void GLAD_API_PTR HeadlessGlDisableVertexAttribArray(GLuint index) { }
+static void GLAD_API_PTR HeadlessGlDrawBuffers(GLsizei n, const GLenum *bufs) { }
+static void GLAD_API_PTR HeadlessGlEnable(GLenum cap) { }
+static void GLAD_API_PTR HeadlessGlEnableVertexAttribArray(GLuint index) { }
+static void GLAD_API_PTR HeadlessGlFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) { }
+static void GLAD_API_PTR HeadlessGlFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) { }
+static void GLAD_API_PTR HeadlessGlFrontFace(GLenum mode) { }
+static void GLAD_API_PTR HeadlessGlGenerateMipmap(GLenum target) { }
+static void GLAD_API_PTR HeadlessGlGetFramebufferAttachmentParameteriv(GLenum target, GLenum attachment, GLenum pname, GLint *params) { }
+static void GLAD_API_PTR HeadlessGlGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void *pixels) { }
+static void GLAD_API_PTR HeadlessGlLineWidth(GLfloat width) { }
+static void GLAD_API_PTR HeadlessGlLinkProgram(GLuint program) { }
+static void GLAD_API_PTR HeadlessGlPixelStorei(GLenum pname, GLint param) { }
+static void GLAD_API_PTR HeadlessGlPolygonMode(GLenum face, GLenum mode) { }
+static void GLAD_API_PTR HeadlessGlRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) { }
+static void GLAD_API_PTR HeadlessGlScissor(GLint x, GLint y, GLsizei width, GLsizei height) { }
+static void GLAD_API_PTR HeadlessGlShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length) { }
+static void GLAD_API_PTR HeadlessGlTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) { }
+static void GLAD_API_PTR HeadlessGlTexParameterf(GLenum target, GLenum pname, GLfloat param) { }
+static void GLAD_API_PTR HeadlessGlTexParameteri(GLenum target, GLenum pname, GLint param) { }
+static void GLAD_API_PTR HeadlessGlTexParameteriv(GLenum target, GLenum pname, const GLint *params) { }
+static void GLAD_API_PTR HeadlessGlTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) { }
+static void GLAD_API_PTR HeadlessGlUniform1fv(GLint location, GLsizei count, const GLfloat *value) { }
+static void GLAD_API_PTR HeadlessGlUniform1i(GLint location, GLint v0) { }
+static void GLAD_API_PTR HeadlessGlUniform1iv(GLint location, GLsizei count, const GLint *value) { }
+static void GLAD_API_PTR HeadlessGlUniform2fv(GLint location, GLsizei count, const GLfloat *value) { }
+static void GLAD_API_PTR HeadlessGlUniform2iv(GLint location, GLsizei count, const GLint *value) { }
+static void GLAD_API_PTR HeadlessGlUniform3fv(GLint location, GLsizei count, const GLfloat *value) { }
+static void GLAD_API_PTR HeadlessGlUniform3iv(GLint location, GLsizei count, const GLint *value) { }
+static void GLAD_API_PTR HeadlessGlUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { }
+static void GLAD_API_PTR HeadlessGlUniform4fv(GLint location, GLsizei count, const GLfloat *value) { }
+static void GLAD_API_PTR HeadlessGlUniform4iv(GLint location, GLsizei count, const GLint *value) { }
+static void GLAD_API_PTR HeadlessGlUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) { }
+static void GLAD_API_PTR HeadlessGlUseProgram(GLuint program) { }
+static void GLAD_API_PTR HeadlessGlVertexAttrib1fv(GLuint index, const GLfloat *v) { }
+static void GLAD_API_PTR HeadlessGlVertexAttrib2fv(GLuint index, const GLfloat *v) { }
+static void GLAD_API_PTR HeadlessGlVertexAttrib3fv(GLuint index, const GLfloat *v) { }
+static void GLAD_API_PTR HeadlessGlVertexAttrib4fv(GLuint index, const GLfloat *v) { }
+static void GLAD_API_PTR HeadlessGlVertexAttribDivisor(GLuint index, GLuint divisor) { }
+static void GLAD_API_PTR HeadlessGlVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) { }
+static void GLAD_API_PTR HeadlessGlViewport(GLint x, GLint y, GLsizei width, GLsizei height) { }
+
+// Get a null OpenGL function, used to load rlgl extensions
+// NOTE: The table has every function raylib calls, the others are NULL, the same as a driver
+// without them, so a call to one that raylib starts to use crashes right there instead of
+// returning garbage; rlgl checks the optional ones (debug output) before using them
+static void *HeadlessGetProcAddress(const char *name)
+{
+    static const struct { const char *name; void *proc; } procs[] = {
+        { "glGetString", (void *)HeadlessGlGetString },
+        { "glGetStringi", (void *)HeadlessGlGetStringi },
+        { "glGetError", (void *)HeadlessGlGetError },
+        { "glGetIntegerv", (void *)HeadlessGlGetIntegerv },
+        { "glGetInteger64v", (void *)HeadlessGlGetInteger64v },
+        { "glGetFloatv", (void *)HeadlessGlGetFloatv },
+        { "glGenTextures", (void *)HeadlessGlGenObjects },
+        { "glGenBuffers", (void *)HeadlessGlGenObjects },
+        { "glGenVertexArrays", (void *)HeadlessGlGenObjects },
+        { "glGenFramebuffers", (void *)HeadlessGlGenObjects },
+        { "glGenRenderbuffers", (void *)HeadlessGlGenObjects },
+        { "glCreateShader", (void *)HeadlessGlCreateShader },
+        { "glCreateProgram", (void *)HeadlessGlCreateProgram },
+        { "glGetShaderiv", (void *)HeadlessGlGetObjectiv },
+        { "glGetProgramiv", (void *)HeadlessGlGetObjectiv },
+        { "glGetShaderInfoLog", (void *)HeadlessGlGetInfoLog },
+        { "glGetProgramInfoLog", (void *)HeadlessGlGetInfoLog },
+        { "glGetUniformLocation", (void *)HeadlessGlGetLocation },
+        { "glGetAttribLocation", (void *)HeadlessGlGetLocation },
+        { "glCheckFramebufferStatus", (void *)HeadlessGlCheckFramebufferStatus },
+        { "glMapBuffer", (void *)HeadlessGlMapBuffer },
+        { "glUnmapBuffer", (void *)HeadlessGlUnmapBuffer },
+        { "glReadPixels", (void *)HeadlessGlReadPixels },
+        { "glBufferData", (void *)HeadlessGlBufferData },
+        { "glBufferSubData", (void *)HeadlessGlBufferSubData },
+        { "glDrawArrays", (void *)HeadlessGlDrawArrays },
+        { "glDrawArraysInstanced", (void *)HeadlessGlDrawArraysInstanced },
+        { "glDrawElements", (void *)HeadlessGlDrawElements },
+        { "glDrawElementsInstanced", (void *)HeadlessGlDrawElementsInstanced },
+        { "glActiveTexture", (void *)HeadlessGlActiveTexture },
+        { "glAttachShader", (void *)HeadlessGlAttachShader },
+        { "glBindAttribLocation", (void *)HeadlessGlBindAttribLocation },
+        { "glBindBuffer", (void *)HeadlessGlBindBuffer },
+        { "glBindFramebuffer", (void *)HeadlessGlBindFramebuffer },
+        { "glBindRenderbuffer", (void *)HeadlessGlBindRenderbuffer },
+        { "glBindTexture", (void *)HeadlessGlBindTexture },
+        { "glBindVertexArray", (void *)HeadlessGlBindVertexArray },
+        { "glBlendEquation", (void *)HeadlessGlBlendEquation },
+        { "glBlendEquationSeparate", (void *)HeadlessGlBlendEquationSeparate },
+        { "glBlendFunc", (void *)HeadlessGlBlendFunc },
+        { "glBlendFuncSeparate", (void *)HeadlessGlBlendFuncSeparate },
+        { "glClear", (void *)HeadlessGlClear },
+        { "glClearColor", (void *)HeadlessGlClearColor },
+        { "glClearDepth", (void *)HeadlessGlClearDepth },
+        { "glCompileShader", (void *)HeadlessGlCompileShader },
+        { "glCompressedTexImage2D", (void *)HeadlessGlCompressedTexImage2D },
+        { "glCullFace", (void *)HeadlessGlCullFace },
+        { "glDeleteBuffers", (void *)HeadlessGlDeleteBuffers },
+        { "glDeleteFramebuffers", (void *)HeadlessGlDeleteFramebuffers },
+        { "glDeleteProgram", (void *)HeadlessGlDeleteProgram },
+        { "glDeleteRenderbuffers", (void *)HeadlessGlDeleteRenderbuffers },
+        { "glDeleteShader", (void *)HeadlessGlDeleteShader },
+        { "glDeleteTextures", (void *)HeadlessGlDeleteTextures },
+        { "glDeleteVertexArrays", (void *)HeadlessGlDeleteVertexArrays },
+        { "glDepthFunc", (void *)HeadlessGlDepthFunc },
+        { "glDepthMask", (void *)HeadlessGlDepthMask },
+        { "glDetachShader", (void *)HeadlessGlDetachShader },
+        { "glDisable", (void *)HeadlessGlDisable },
+        { "glDisableVertexAttribArray", (void *)HeadlessGlDisableVertexAttribArray },
+        { "glDrawBuffers", (void *)HeadlessGlDrawBuffers },
+        { "glEnable", (void *)HeadlessGlEnable },
+        { "glEnableVertexAttribArray", (void *)HeadlessGlEnableVertexAttribArray },
+        { "glFramebufferRenderbuffer", (void *)HeadlessGlFramebufferRenderbuffer },
+        { "glFramebufferTexture2D", (void *)HeadlessGlFramebufferTexture2D },
+        { "glFrontFace", (void *)HeadlessGlFrontFace },
+        { "glGenerateMipmap", (void *)HeadlessGlGenerateMipmap },
+        { "glGetFramebufferAttachmentParameteriv", (void *)HeadlessGlGetFramebufferAttachmentParameteriv },
+        { "glGetTexImage", (void *)HeadlessGlGetTexImage },
+        { "glLineWidth", (void *)HeadlessGlLineWidth },
+        { "glLinkProgram", (void *)HeadlessGlLinkProgram },
+        { "glPixelStorei", (void *)HeadlessGlPixelStorei },
+        { "glPolygonMode", (void *)HeadlessGlPolygonMode },
+        { "glRenderbufferStorage", (void *)HeadlessGlRenderbufferStorage },
+        { "glScissor", (void *)HeadlessGlScissor },
+        { "glShaderSource", (void *)HeadlessGlShaderSource },
+        { "glTexImage2D", (void *)HeadlessGlTexImage2D },
+        { "glTexParameterf", (void *)HeadlessGlTexParameterf },
+        { "glTexParameteri", (void *)HeadlessGlTexParameteri },
+        { "glTexParameteriv", (void *)HeadlessGlTexParameteriv },
+        { "glTexSubImage2D", (void *)HeadlessGlTexSubImage2D },
+        { "glUniform1fv", (void *)HeadlessGlUniform1fv },
+        { "glUniform1i", (void *)HeadlessGlUniform1i },
+        { "glUniform1iv", (void *)HeadlessGlUniform1iv },
+        { "glUniform2fv", (void *)HeadlessGlUniform2fv },
+        { "glUniform2iv", (void *)HeadlessGlUniform2iv },
+        { "glUniform3fv", (void *)HeadlessGlUniform3fv },
+        { "glUniform3iv", (void *)HeadlessGlUniform3iv },
+        { "glUniform4f", (void *)HeadlessGlUniform4f },
+        { "glUniform4fv", (void *)HeadlessGlUniform4fv },
+        { "glUniform4iv", (void *)HeadlessGlUniform4iv },
+        { "glUniformMatrix4fv", (void *)HeadlessGlUniformMatrix4fv },
+        { "glUseProgram", (void *)HeadlessGlUseProgram },
+        { "glVertexAttrib1fv", (void *)HeadlessGlVertexAttrib1fv },
+        { "glVertexAttrib2fv", (void *)HeadlessGlVertexAttrib2fv },
+        { "glVertexAttrib3fv", (void *)HeadlessGlVertexAttrib3fv },
+        { "glVertexAttrib4fv", (void *)HeadlessGlVertexAttrib4fv },
+        { "glVertexAttribDivisor", (void *)HeadlessGlVertexAttribDivisor },
+        { "glVertexAttribPointer", (void *)HeadlessGlVertexAttribPointer },
+        { "glViewport", (void *)HeadlessGlViewport },
+    };
+
+    for (int i = 0; i < (int)(sizeof(procs)/sizeof(procs[0])); i++)
+    {
+        if (strcmp(name, procs[i].name) == 0) return procs[i].proc;
+    }
+
+    return NULL;
+}
+#endif  // PLATFORM_HEADLESS
+
 #if defined(SUPPORT_EVENTS_AUTOMATION)
 // NOTE: Loading happens over AutomationEvent *events
 // TODO: This system should probably be redesigned
@@ -22,6 +22,9 @@
 *       #define SUPPORT_QUADS_DRAW_MODE
 *           Use QUADS instead of TRIANGLES for drawing when possible. Lines-based shapes still use LINES
 *
+*       #define SUPPORT_SIMD_COLLISIONS
+*           Batched collision checks use SSE, and AVX2 when the cpu supports it, on x86
+*
 *
 *   LICENSE: zlib/libpng
 *
@@ -58,6 +61,16 @@
 #include <math.h>       // Required for: sinf(), asinf(), cosf(), acosf(), sqrtf(), fabsf()
 #include <float.h>      // Required for: FLT_EPSILON
 #include <stdlib.h>     // Required for: RL_FREE
+#include <string.h>     // Required for: memset()
+
+// SIMD paths of the batched collision checks: SSE on every x86-64, AVX2 when the cpu has it
+#if defined(SUPPORT_SIMD_COLLISIONS) && defined(__GNUC__) && defined(__SSE2__)
+    #define RSHAPES_SIMD_X86
+    #include <immintrin.h>  // Required for: SSE and AVX2 intrinsics
+    #if defined(_WIN32)
+        #include <cpuid.h>      // Required for: __get_cpuid(), __get_cpuid_count()
+    #endif
+#endif
 
 //----------------------------------------------------------------------------------
 // Defines and Macros
@@ -1862,11 +1875,11 @@ bool CheckCollisionCircleRec(Vector2 center, float radius, Rectangle rec)
 {
     bool collision = false;
 
-    int recCenterX = (int)(rec.x + rec.width/2.0f);
-    int recCenterY = (int)(rec.y + rec.height/2.0f);
+    float recCenterX = rec.x + rec.width/2.0f;
+    float recCenterY = rec.y + rec.height/2.0f;
 
-    float dx = fabsf(center.x - (float)recCenterX);
-    float dy = fabsf(center.y - (float)recCenterY);
+    float dx = fabsf(center.x - recCenterX);
+    float dy = fabsf(center.y - recCenterY);
 
     if (dx > (rec.width/2.0f + radius)) { return false; }
     if (dy > (rec.height/2.0f + radius)) { return false; }
@@ -1956,6 +1969,355 @@ Rectangle GetCollisionRec(Rectangle rec1, Rectangle rec2)
     return overlap;
 }
 
+//----------------------------------------------------------------------------------
+// Module Functions Definition - Batched collision checks
+//----------------------------------------------------------------------------------
+// NOTE: They check one shape against many and set a bit of mask for every one it collides with,
+// the SIMD paths check 4 (SSE) or 8 (AVX2) at once and the ones left over go through the functions
+// above, which are also what they are all compared against: without SUPPORT_SIMD_COLLISIONS they
+// are the scalar reference. Every lane does the same float operations as those functions, so the
+// masks are exactly the same.
+
+#define BATCH_MASK_WORDS(count) (((count) + 31)/32)
+
+#if defined(RSHAPES_SIMD_X86)
+#define RSHAPES_AVX2 __attribute__((target("avx2")))
+
+// Check if the cpu has AVX2, raylib itself is built for plain x86-64 (SSE2)
+static bool CpuHasAvx2(void)
+{
+#if defined(__AVX2__)
+    return true;
+#elif defined(_WIN32)
+    // NOTE: __builtin_cpu_supports() needs compiler-rt, which is not linked for msvc targets, so
+    // ask the cpu, and the os, which has to save the ymm registers, directly, once
+    static int hasAvx2 = -1;
+    if (hasAvx2 < 0)
+    {
+        unsigned int a = 0, b = 0, c = 0, d = 0, xcr0 = 0, high = 0;
+        hasAvx2 = 0;
+        if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_OSXSAVE) && (c & bit_AVX))
+        {
+            __asm__ ("xgetbv" : "=a"(xcr0), "=d"(high) : "c"(0));
+            if (((xcr0 & 6) == 6) && __get_cpuid_count(7, 0, &a, &b, &c, &d)) hasAvx2 = (b & bit_AVX2) != 0;
+        }
+    }
+    return hasAvx2;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Load 4 rectangles as their x, y, width and height
+static inline void LoadRecs4(const Rectangle *recs, __m128 *x, __m128 *y, __m128 *width, __m128 *height)
+{
+    __m128 r0 = _mm_loadu_ps(&recs[0].x);
+    __m128 r1 = _mm_loadu_ps(&recs[1].x);
+    __m128 r2 = _mm_loadu_ps(&recs[2].x);
+    __m128 r3 = _mm_loadu_ps(&recs[3].x);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    *x = r0; *y = r1; *width = r2; *height = r3;
+}
+
+// Load 4 vectors as their x and y
+static inline void LoadVectors4(const Vector2 *vectors, __m128 *x, __m128 *y)
+{
+    __m128 v01 = _mm_loadu_ps(&vectors[0].x);
+    __m128 v23 = _mm_loadu_ps(&vectors[2].x);
+    *x = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0));
+    *y = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// Set the bits of lanes that collided, 4 or 8 lanes never straddle two words of mask
+static inline int StoreBatchMask(unsigned int *mask, int index, unsigned int lanes)
+{
+    mask[index/32] |= lanes << (index%32);
+    return __builtin_popcount(lanes);
+}
+
+// The SIMD paths below check as many shapes as fill whole registers and return how many that was
+
+static int CheckCollisionRecsSSE(Rectangle rec, const Rectangle *recs, int count, unsigned int *mask, int *hits)
+{
+    __m128 left = _mm_set1_ps(rec.x), right = _mm_set1_ps(rec.x + rec.width);
+    __m128 top = _mm_set1_ps(rec.y), bottom = _mm_set1_ps(rec.y + rec.height);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, width, height;
+        LoadRecs4(recs + i, &x, &y, &width, &height);
+        __m128 collisionX = _mm_and_ps(_mm_cmplt_ps(left, _mm_add_ps(x, width)), _mm_cmpgt_ps(right, x));
+        __m128 collisionY = _mm_and_ps(_mm_cmplt_ps(top, _mm_add_ps(y, height)), _mm_cmpgt_ps(bottom, y));
+        *hits += StoreBatchMask(mask, i, _mm_movemask_ps(_mm_and_ps(collisionX, collisionY)));
+    }
+
+    return i;
+}
+
+RSHAPES_AVX2 static int CheckCollisionRecsAVX2(Rectangle rec, const Rectangle *recs, int count, unsigned int *mask, int *hits)
+{
+    __m256 left = _mm256_set1_ps(rec.x), right = _mm256_set1_ps(rec.x + rec.width);
+    __m256 top = _mm256_set1_ps(rec.y), bottom = _mm256_set1_ps(rec.y + rec.height);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 x0, y0, width0, height0, x1, y1, width1, height1;
+        LoadRecs4(recs + i, &x0, &y0, &width0, &height0);
+        LoadRecs4(recs + i + 4, &x1, &y1, &width1, &height1);
+        __m256 x = _mm256_set_m128(x1, x0), y = _mm256_set_m128(y1, y0);
+        __m256 width = _mm256_set_m128(width1, width0), height = _mm256_set_m128(height1, height0);
+        __m256 collisionX = _mm256_and_ps(_mm256_cmp_ps(left, _mm256_add_ps(x, width), _CMP_LT_OQ), _mm256_cmp_ps(right, x, _CMP_GT_OQ));
+        __m256 collisionY = _mm256_and_ps(_mm256_cmp_ps(top, _mm256_add_ps(y, height), _CMP_LT_OQ), _mm256_cmp_ps(bottom, y, _CMP_GT_OQ));
+        *hits += StoreBatchMask(mask, i, _mm256_movemask_ps(_mm256_and_ps(collisionX, collisionY)));
+    }
+
+    return i;
+}
+
+static int CheckCollisionCirclesSSE(Vector2 center, float radius, const Vector2 *centers, const float *radii, int count, unsigned int *mask, int *hits)
+{
+    __m128 centerX = _mm_set1_ps(center.x), centerY = _mm_set1_ps(center.y), radius1 = _mm_set1_ps(radius);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x, y;
+        LoadVectors4(centers + i, &x, &y);
+        __m128 dx = _mm_sub_ps(x, centerX);
+        __m128 dy = _mm_sub_ps(y, centerY);
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 collision = _mm_cmple_ps(distance, _mm_add_ps(radius1, _mm_loadu_ps(radii + i)));
+        *hits += StoreBatchMask(mask, i, _mm_movemask_ps(collision));
+    }
+
+    return i;
+}
+
+RSHAPES_AVX2 static int CheckCollisionCirclesAVX2(Vector2 center, float radius, const Vector2 *centers, const float *radii, int count, unsigned int *mask, int *hits)
+{
+    __m256 centerX = _mm256_set1_ps(center.x), centerY = _mm256_set1_ps(center.y), radius1 = _mm256_set1_ps(radius);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 x0, y0, x1, y1;
+        LoadVectors4(centers + i, &x0, &y0);
+        LoadVectors4(centers + i + 4, &x1, &y1);
+        __m256 dx = _mm256_sub_ps(_mm256_set_m128(x1, x0), centerX);
+        __m256 dy = _mm256_sub_ps(_mm256_set_m128(y1, y0), centerY);
+        __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        __m256 collision = _mm256_cmp_ps(distance, _mm256_add_ps(radius1, _mm256_loadu_ps(radii + i)), _CMP_LE_OQ);
+        *hits += StoreBatchMask(mask, i, _mm256_movemask_ps(collision));
+    }
+
+    return i;
+}
+
+static int CheckCollisionCircleRecSSE(const Vector2 *centers, float radius, int count, Rectangle rec, unsigned int *mask, int *hits)
+{
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 halfWidth = _mm_set1_ps(rec.width/2.0f), halfHeight = _mm_set1_ps(rec.height/2.0f);
+    __m128 recCenterX = _mm_set1_ps(rec.x + rec.width/2.0f), recCenterY = _mm_set1_ps(rec.y + rec.height/2.0f);
+    __m128 limitX = _mm_set1_ps(rec.width/2.0f + radius), limitY = _mm_set1_ps(rec.height/2.0f + radius);
+    __m128 radiusSq = _mm_set1_ps(radius*radius);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x, y;
+        LoadVectors4(centers + i, &x, &y);
+        __m128 dx = _mm_andnot_ps(sign, _mm_sub_ps(x, recCenterX));
+        __m128 dy = _mm_andnot_ps(sign, _mm_sub_ps(y, recCenterY));
+        __m128 outside = _mm_or_ps(_mm_cmpgt_ps(dx, limitX), _mm_cmpgt_ps(dy, limitY));
+        __m128 cornerX = _mm_sub_ps(dx, halfWidth), cornerY = _mm_sub_ps(dy, halfHeight);
+        __m128 cornerDistanceSq = _mm_add_ps(_mm_mul_ps(cornerX, cornerX), _mm_mul_ps(cornerY, cornerY));
+        __m128 inside = _mm_or_ps(_mm_or_ps(_mm_cmple_ps(dx, halfWidth), _mm_cmple_ps(dy, halfHeight)), _mm_cmple_ps(cornerDistanceSq, radiusSq));
+        *hits += StoreBatchMask(mask, i, _mm_movemask_ps(_mm_andnot_ps(outside, inside)));
+    }
+
+    return i;
+}
+
+RSHAPES_AVX2 static int CheckCollisionCircleRecAVX2(const Vector2 *centers, float radius, int count, Rectangle rec, unsigned int *mask, int *hits)
+{
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 halfWidth = _mm256_set1_ps(rec.width/2.0f), halfHeight = _mm256_set1_ps(rec.height/2.0f);
+    __m256 recCenterX = _mm256_set1_ps(rec.x + rec.width/2.0f), recCenterY = _mm256_set1_ps(rec.y + rec.height/2.0f);
+    __m256 limitX = _mm256_set1_ps(rec.width/2.0f + radius), limitY = _mm256_set1_ps(rec.height/2.0f + radius);
+    __m256 radiusSq = _mm256_set1_ps(radius*radius);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 x0, y0, x1, y1;
+        LoadVectors4(centers + i, &x0, &y0);
+        LoadVectors4(centers + i + 4, &x1, &y1);
+        __m256 dx = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_set_m128(x1, x0), recCenterX));
+        __m256 dy = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_set_m128(y1, y0), recCenterY));
+        __m256 outside = _mm256_or_ps(_mm256_cmp_ps(dx, limitX, _CMP_GT_OQ), _mm256_cmp_ps(dy, limitY, _CMP_GT_OQ));
+        __m256 cornerX = _mm256_sub_ps(dx, halfWidth), cornerY = _mm256_sub_ps(dy, halfHeight);
+        __m256 cornerDistanceSq = _mm256_add_ps(_mm256_mul_ps(cornerX, cornerX), _mm256_mul_ps(cornerY, cornerY));
+        __m256 inside = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(dx, halfWidth, _CMP_LE_OQ), _mm256_cmp_ps(dy, halfHeight, _CMP_LE_OQ)),
+                                     _mm256_cmp_ps(cornerDistanceSq, radiusSq, _CMP_LE_OQ));
+        *hits += StoreBatchMask(mask, i, _mm256_movemask_ps(_mm256_andnot_ps(outside, inside)));
+    }
+
+    return i;
+}
+
+static int CheckCollisionPointRecSSE(const Vector2 *points, int count, Rectangle rec, unsigned int *mask, int *hits)
+{
+    __m128 left = _mm_set1_ps(rec.x), right = _mm_set1_ps(rec.x + rec.width);
+    __m128 top = _mm_set1_ps(rec.y), bottom = _mm_set1_ps(rec.y + rec.height);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x, y;
+        LoadVectors4(points + i, &x, &y);
+        __m128 collisionX = _mm_and_ps(_mm_cmpge_ps(x, left), _mm_cmplt_ps(x, right));
+        __m128 collisionY = _mm_and_ps(_mm_cmpge_ps(y, top), _mm_cmplt_ps(y, bottom));
+        *hits += StoreBatchMask(mask, i, _mm_movemask_ps(_mm_and_ps(collisionX, collisionY)));
+    }
+
+    return i;
+}
+
+RSHAPES_AVX2 static int CheckCollisionPointRecAVX2(const Vector2 *points, int count, Rectangle rec, unsigned int *mask, int *hits)
+{
+    __m256 left = _mm256_set1_ps(rec.x), right = _mm256_set1_ps(rec.x + rec.width);
+    __m256 top = _mm256_set1_ps(rec.y), bottom = _mm256_set1_ps(rec.y + rec.height);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 x0, y0, x1, y1;
+        LoadVectors4(points + i, &x0, &y0);
+        LoadVectors4(points + i + 4, &x1, &y1);
+        __m256 x = _mm256_set_m128(x1, x0), y = _mm256_set_m128(y1, y0);
+        __m256 collisionX = _mm256_and_ps(_mm256_cmp_ps(x, left, _CMP_GE_OQ), _mm256_cmp_ps(x, right, _CMP_LT_OQ));
+        __m256 collisionY = _mm256_and_ps(_mm256_cmp_ps(y, top, _CMP_GE_OQ), _mm256_cmp_ps(y, bottom, _CMP_LT_OQ));
+        *hits += StoreBatchMask(mask, i, _mm256_movemask_ps(_mm256_and_ps(collisionX, collisionY)));
+    }
+
+    return i;
+}
+#endif  // RSHAPES_SIMD_X86
+
+// Check collision between one rectangle and many
+int CheckCollisionRecsBatch(Rectangle rec, const Rectangle *recs, int count, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#if defined(RSHAPES_SIMD_X86)
+    i = CpuHasAvx2()? CheckCollisionRecsAVX2(rec, recs, count, mask, &hits) : CheckCollisionRecsSSE(rec, recs, count, mask, &hits);
+#endif
+    for (; i < count; i++)
+    {
+        if (CheckCollisionRecs(rec, recs[i])) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+
+// Check collision between one circle and many
+int CheckCollisionCirclesBatch(Vector2 center, float radius, const Vector2 *centers, const float *radii, int count, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#if defined(RSHAPES_SIMD_X86)
+    i = CpuHasAvx2()? CheckCollisionCirclesAVX2(center, radius, centers, radii, count, mask, &hits) : CheckCollisionCirclesSSE(center, radius, centers, radii, count, mask, &hits);
+#endif
+    for (; i < count; i++)
+    {
+        if (CheckCollisionCircles(center, radius, centers[i], radii[i])) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+
+// Check collision between many circles of the same radius and one rectangle
+int CheckCollisionCircleRecBatch(const Vector2 *centers, float radius, int count, Rectangle rec, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#if defined(RSHAPES_SIMD_X86)
+    i = CpuHasAvx2()? CheckCollisionCircleRecAVX2(centers, radius, count, rec, mask, &hits) : CheckCollisionCircleRecSSE(centers, radius, count, rec, mask, &hits);
+#endif
+    for (; i < count; i++)
+    {
+        if (CheckCollisionCircleRec(centers[i], radius, rec)) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+
+// Check if many points are inside one rectangle
+int CheckCollisionPointRecBatch(const Vector2 *points, int count, Rectangle rec, unsigned int *mask)
+{
+    int hits = 0;
+    int i = 0;
+
+    memset(mask, 0, BATCH_MASK_WORDS(count)*sizeof(unsigned int));
+#if defined(RSHAPES_SIMD_X86)
+    i = CpuHasAvx2()? CheckCollisionPointRecAVX2(points, count, rec, mask, &hits) : CheckCollisionPointRecSSE(points, count, rec, mask, &hits);
+#endif
+    for (; i < count; i++)
+    {
+        if (CheckCollisionPointRec(points[i], rec)) { mask[i/32] |= 1u << (i%32); hits++; }
+    }
+
+    return hits;
+}
+
+// Check collision between every rectangle of recs1 and every one of recs2, a row of mask for each of recs1
+int CheckCollisionRecsBatchAll(const Rectangle *recs1, int count1, const Rectangle *recs2, int count2, unsigned int *mask)
+{
+    int hits = 0;
+
+    for (int i = 0; i < count1; i++) hits += CheckCollisionRecsBatch(recs1[i], recs2, count2, mask + i*BATCH_MASK_WORDS(count2));
+
+    return hits;
+}
+
+// Check collision between every circle of the first ones and every one of the second, a row of mask for each of the first
+int CheckCollisionCirclesBatchAll(const Vector2 *centers1, const float *radii1, int count1, const Vector2 *centers2, const float *radii2, int count2, unsigned int *mask)
+{
+    int hits = 0;
+
+    for (int i = 0; i < count1; i++) hits += CheckCollisionCirclesBatch(centers1[i], radii1[i], centers2, radii2, count2, mask + i*BATCH_MASK_WORDS(count2));
+
+    return hits;
+}
+
+// Check collision between every circle and every rectangle, a row of mask for each rectangle
+int CheckCollisionCircleRecBatchAll(const Vector2 *centers, float radius, int count, const Rectangle *recs, int recCount, unsigned int *mask)
+{
+    int hits = 0;
+
+    for (int i = 0; i < recCount; i++) hits += CheckCollisionCircleRecBatch(centers, radius, count, recs[i], mask + i*BATCH_MASK_WORDS(count));
+
+    return hits;
+}
+
+// Check if every point is inside every rectangle, a row of mask for each rectangle
+int CheckCollisionPointRecBatchAll(const Vector2 *points, int count, const Rectangle *recs, int recCount, unsigned int *mask)
+{
+    int hits = 0;
+
+    for (int i = 0; i < recCount; i++) hits += CheckCollisionPointRecBatch(points, count, recs[i], mask + i*BATCH_MASK_WORDS(count));
+
+    return hits;
+}
+
 //----------------------------------------------------------------------------------
 // Module specific Functions Definition
 //----------------------------------------------------------------------------------
@@ -285,7 +285,7 @@ Image LoadAnImage(const char *fileName)
     // Loading image from memory data
     if (fileData != NULL) image = LoadImageFromMemory(GetFileExtension(fileName), fileData, dataSize);
 
-    RL_FREE(fileData);
+    UnloadFileData(fileData);
 
     return image;
 }
@@ -312,7 +312,7 @@ Image LoadImageRaw(const char *fileName, int width, int height, int format, int
         image.mipmaps = 1;
         image.format = format;
 
-        RL_FREE(fileData);
+        UnloadFileData(fileData);
     }
 
     return image;
@@ -419,7 +419,7 @@ Image LoadImageAnim(const char *fileName, int *frames)
             image.mipmaps = 1;
             image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
 
-            RL_FREE(fileData);
+            UnloadFileData(fileData);
             RL_FREE(delays);        // NOTE: Frames delays are discarded
         }
     }
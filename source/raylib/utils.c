@@ -63,6 +63,7 @@ static int logTypeLevel = LOG_INFO;                 // Minimum log type level
 
 static TraceLogCallback traceLog = NULL;            // TraceLog callback function pointer
 static LoadFileDataCallback loadFileData = NULL;    // LoadFileData callback function pointer
+static UnloadFileDataCallback unloadFileData = NULL; // UnloadFileData callback function pointer
 static SaveFileDataCallback saveFileData = NULL;    // SaveFileText callback function pointer
 static LoadFileTextCallback loadFileText = NULL;    // LoadFileText callback function pointer
 static SaveFileTextCallback saveFileText = NULL;    // SaveFileText callback function pointer
@@ -72,6 +73,7 @@ static SaveFileTextCallback saveFileText = NULL;    // SaveFileText callback fun
 //----------------------------------------------------------------------------------
 void SetTraceLogCallback(TraceLogCallback callback) { traceLog = callback; }              // Set custom trace log
 void SetLoadFileDataCallback(LoadFileDataCallback callback) { loadFileData = callback; }  // Set custom file data loader
+void SetUnloadFileDataCallback(UnloadFileDataCallback callback) { unloadFileData = callback; }  // Set custom file data unloader
 void SetSaveFileDataCallback(SaveFileDataCallback callback) { saveFileData = callback; }  // Set custom file data saver
 void SetLoadFileTextCallback(LoadFileTextCallback callback) { loadFileText = callback; }  // Set custom file text loader
 void SetSaveFileTextCallback(SaveFileTextCallback callback) { saveFileText = callback; }  // Set custom file text saver
@@ -235,6 +237,12 @@ unsigned char *LoadFileData(const char *fileName, int *dataSize)
 // Unload file data allocated by LoadFileData()
 void UnloadFileData(unsigned char *data)
 {
+    if (unloadFileData)
+    {
+        unloadFileData(data);
+        return;
+    }
+
     RL_FREE(data);
 }
 